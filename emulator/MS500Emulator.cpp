@@ -0,0 +1,1201 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+
+#include "debug.h"
+#include "CRC32.h"
+#include "LZ4Block.h"
+#include "MS500Emulator.h"
+
+/* wait for the rest of a packet once its header arrived */
+static const int EMU_PACKET_TIMEOUT_MS  = (2000);
+static const int EMU_POLL_INTERVAL_MS   = (200);
+
+/* uploader start message, UPLOADER_START_MESSAGE_SIZE bytes */
+static const unsigned char EMU_START_MESSAGE[] = "UPLOADER\r\n";
+
+static void tsAddUs(struct timespec* ts, long us)
+{
+    ts->tv_sec  += us / 1000000;
+    ts->tv_nsec += (us % 1000000) * 1000;
+    if ( ts->tv_nsec >= 1000000000 )
+    {
+        ts->tv_sec  += 1;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+static int tsCompare(const struct timespec* a, const struct timespec* b)
+{
+    if ( a->tv_sec != b->tv_sec )
+    {
+        return (a->tv_sec < b->tv_sec) ? -1 : 1;
+    }
+    if ( a->tv_nsec != b->tv_nsec )
+    {
+        return (a->tv_nsec < b->tv_nsec) ? -1 : 1;
+    }
+    return 0;
+}
+
+static long tsDiffMs(const struct timespec* end, const struct timespec* start)
+{
+    return (end->tv_sec - start->tv_sec) * 1000 + (end->tv_nsec - start->tv_nsec) / 1000000;
+}
+
+MS500Emulator::MS500Emulator(void)
+{
+    master    = -1;
+    slave     = -1;
+    linkName  = NULL;
+    running   = 0;
+    memset(slaveName, 0x00, sizeof(slaveName));
+
+    baseBaudrate    = 230400;
+    baudrate        = baseBaudrate;
+    maxBaudrate     = 0;
+    sectorLatencyUs = 0;
+    eraseLatencyUs  = 0;
+    efuseLatencyUs  = 0;
+    keepState       = 0;
+    romBootMs       = 0;
+    efuseBatch      = 1;
+    chunkFault      = 0;
+
+    uploaderRunning  = 0;
+    romBooting       = 0;
+    flash            = new unsigned char[EMU_FLASH_SIZE];
+    memset(flash, 0xFF, EMU_FLASH_SIZE);
+    memset(efuse, 0x00, sizeof(efuse));
+    memset(sdb, 0x00, sizeof(sdb));
+    sdbCount         = 0;
+    memset(&sdbStream, 0x00, sizeof(sdbStream));
+    sdbStreamOffset  = 0;
+    sdbStreamOpen    = 0;
+    chunks           = 0;
+    eraseBase        = 0;
+    eraseSize        = 0;
+    baudrateSwitched = 0;
+    previousBaudrate = baudrate;
+
+    clock_gettime(CLOCK_MONOTONIC, &rxClock);
+    busyClock        = rxClock;
+    baudrateDeadline = rxClock;
+    romBootDeadline  = rxClock;
+
+    devices = 0;
+    memset(&stats, 0x00, sizeof(stats));
+}
+
+MS500Emulator::~MS500Emulator(void)
+{
+    Close();
+
+    if ( flash != NULL )
+    {
+        delete[] flash;
+        flash = NULL;
+    }
+}
+
+int MS500Emulator::Open(const char* linkName)
+{
+    int ret = -1;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if ( master < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    if ( grantpt(master) < 0 || unlockpt(master) < 0 || ptsname_r(master, slaveName, sizeof(slaveName)) != 0 )
+    {
+        DBG_ERR("error!!!");
+        Close();
+        return -1;
+    }
+
+    slave = open(slaveName, O_RDWR | O_NOCTTY);
+    if ( slave < 0 )
+    {
+        DBG_ERR("%s open error", slaveName);
+        Close();
+        return -1;
+    }
+
+    /* raw until the downloader configures it, no echo of the packets back to the host */
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    ret = fcntl(master, F_GETFL);
+    fcntl(master, F_SETFL, ret | O_NONBLOCK);
+
+    if ( linkName != NULL )
+    {
+        unlink(linkName);
+        ret = symlink(slaveName, linkName);
+        if ( ret < 0 )
+        {
+            DBG_ERR("%s link error", linkName);
+            Close();
+            return -1;
+        }
+        this->linkName = new char[strlen(linkName) + 1] {0,};
+        strcpy(this->linkName, linkName);
+    }
+
+    return 0;
+}
+
+int MS500Emulator::Close(void)
+{
+    if ( linkName != NULL )
+    {
+        unlink(linkName);
+        delete[] linkName;
+        linkName = NULL;
+    }
+
+    if ( slave >= 0 )
+    {
+        close(slave);
+        slave = -1;
+    }
+
+    if ( master >= 0 )
+    {
+        close(master);
+        master = -1;
+    }
+
+    return 0;
+}
+
+const char* MS500Emulator::GetSlaveName(void)
+{
+    return slaveName;
+}
+
+void MS500Emulator::SetBaudrate(int baudrate)
+{
+    baseBaudrate     = (baudrate > 0) ? baudrate : 0;
+    this->baudrate   = baseBaudrate;
+    previousBaudrate = baseBaudrate;
+}
+
+void MS500Emulator::SetMaxBaudrate(int baudrate)
+{
+    maxBaudrate = (baudrate > 0) ? baudrate : 0;
+}
+
+void MS500Emulator::SetSectorLatencyUs(int latencyUs)
+{
+    sectorLatencyUs = (latencyUs > 0) ? latencyUs : 0;
+}
+
+void MS500Emulator::SetEraseLatencyUs(int latencyUs)
+{
+    eraseLatencyUs = (latencyUs > 0) ? latencyUs : 0;
+}
+
+void MS500Emulator::SetEfuseLatencyUs(int latencyUs)
+{
+    efuseLatencyUs = (latencyUs > 0) ? latencyUs : 0;
+}
+
+void MS500Emulator::SetRomBootMs(int bootMs)
+{
+    romBootMs = (bootMs > 0) ? bootMs : 0;
+}
+
+void MS500Emulator::SetEfuseBatch(int enable)
+{
+    efuseBatch = enable;
+}
+
+void MS500Emulator::SetChunkFault(int every)
+{
+    chunkFault = (every > 0) ? every : 0;
+}
+
+void MS500Emulator::SetKeepState(int keep)
+{
+    keepState = keep;
+}
+
+void MS500Emulator::Stop(void)
+{
+    running = 0;
+}
+
+void MS500Emulator::PrintStats(void)
+{
+    if ( devices <= 0 )
+    {
+        return;
+    }
+
+    long elapsedMs = tsDiffMs(&busyClock, &stats.start);
+    if ( tsCompare(&rxClock, &busyClock) > 0 )
+    {
+        elapsedMs = tsDiffMs(&rxClock, &stats.start);
+    }
+
+    fprintf(stdout, "[device #%d] %ld ms, rx %lu B(%lu B/s), tx %lu B, %u sectors, %u erase blocks, %u erase sectors, %u sdb, efuse w%u/r%u, crc error %u, nak %u\n",
+            devices, elapsedMs,
+            stats.rxBytes, (elapsedMs > 0) ? (stats.rxBytes * 1000 / elapsedMs) : 0,
+            stats.txBytes, stats.sectors, stats.eraseBlocks, stats.eraseSectors, stats.sdbPackets,
+            stats.efuseWrites, stats.efuseReads, stats.crcErrors, stats.naks);
+    if ( stats.sdbChunks > 0 )
+    {
+        fprintf(stdout, "[device #%d] %u sdb chunks\n", devices, stats.sdbChunks);
+    }
+    if ( stats.fillSectors > 0 )
+    {
+        fprintf(stdout, "[device #%d] %u fill sectors\n", devices, stats.fillSectors);
+    }
+    if ( stats.packedSectors > 0 )
+    {
+        fprintf(stdout, "[device #%d] lz4 %u sectors, %lu -> %lu B(%lu%%)\n",
+                devices, stats.packedSectors, stats.packedBytes, stats.inflatedBytes, stats.packedBytes * 100 / stats.inflatedBytes);
+    }
+    fflush(stdout);
+}
+
+/* 8N1: 10 bits per byte at the current rate */
+void MS500Emulator::addWireTime(struct timespec* clock, unsigned int len)
+{
+    if ( baudrate <= 0 )
+    {
+        return;
+    }
+    tsAddUs(clock, (long)((unsigned long long)len * 10 * 1000000 / baudrate));
+}
+
+/* a flash/eFuse job starts once its data is in and the previous job is done */
+void MS500Emulator::addBusyTime(int latencyUs)
+{
+    if ( tsCompare(&busyClock, &rxClock) < 0 )
+    {
+        busyClock = rxClock;
+    }
+    tsAddUs(&busyClock, latencyUs);
+}
+
+int MS500Emulator::readPacket(unsigned char* out, unsigned int outLen, int timeoutMs, int first)
+{
+    int ret = -1;
+    unsigned int readBytes = 0;
+
+    /* data already queued was sent back to back with the previous packet, else it starts now */
+    if ( first )
+    {
+        int queued = 0;
+        ioctl(master, FIONREAD, &queued);
+        if ( queued <= 0 )
+        {
+            struct pollfd pfd = { master, POLLIN, 0 };
+            ret = poll(&pfd, 1, timeoutMs);
+            if ( ret <= 0 )
+            {
+                return 0;
+            }
+
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if ( tsCompare(&rxClock, &now) < 0 )
+            {
+                rxClock = now;
+            }
+        }
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    tsAddUs(&deadline, (long)timeoutMs * 1000);
+
+    while ( readBytes < outLen )
+    {
+        ret = read(master, out + readBytes, outLen - readBytes);
+        if ( ret > 0 )
+        {
+            readBytes += ret;
+            continue;
+        }
+        if ( ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != EIO )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long remainMs = tsDiffMs(&deadline, &now);
+        if ( remainMs <= 0 || running == 0 )
+        {
+            DBG_ERR("timeout(%d/%d)", readBytes, outLen);
+            return -1;
+        }
+
+        struct pollfd pfd = { master, POLLIN, 0 };
+        poll(&pfd, 1, (int)remainMs);
+    }
+
+    addWireTime(&rxClock, outLen);
+    stats.rxBytes += outLen;
+
+    return readBytes;
+}
+
+/* hunt the sync byte, then the rest of the header. 0: nothing(yet) */
+int MS500Emulator::readHeader(cmdPacketHeader_t* out)
+{
+    int ret = -1;
+    unsigned char* header = (unsigned char*)out;
+
+    /* switched uploader rate not confirmed by a ping in time: back to the previous rate */
+    int timeoutMs = EMU_POLL_INTERVAL_MS;
+    if ( baudrateSwitched )
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long remainMs = tsDiffMs(&baudrateDeadline, &now);
+        if ( remainMs <= 0 )
+        {
+            fprintf(stdout, "baudrate %d not confirmed, back to %d\n", baudrate, previousBaudrate);
+            baudrate         = previousBaudrate;
+            baudrateSwitched = 0;
+            tcflush(master, TCIFLUSH);
+            return 0;
+        }
+        timeoutMs = (remainMs < timeoutMs) ? (int)remainMs : timeoutMs;
+    }
+
+    ret = readPacket(header, 1, timeoutMs, 1);
+    if ( ret <= 0 )
+    {
+        return ret;
+    }
+
+    if ( header[0] != 0x57 )
+    {
+        return 0;
+    }
+
+    ret = readPacket(header + 1, sizeof(cmdPacketHeader_t) - 1, EMU_PACKET_TIMEOUT_MS, 0);
+    if ( ret < 0 )
+    {
+        return -1;
+    }
+
+    return 1;
+}
+
+int MS500Emulator::writeResponse(const unsigned char* in, unsigned int inLen)
+{
+    int ret = -1;
+    unsigned int sentBytes = 0;
+
+    /* the response leaves after the job is done and takes its own wire time */
+    struct timespec when = rxClock;
+    if ( tsCompare(&when, &busyClock) < 0 )
+    {
+        when = busyClock;
+    }
+    addWireTime(&when, inLen);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &when, NULL);
+
+    while ( sentBytes < inLen )
+    {
+        ret = write(master, in + sentBytes, inLen - sentBytes);
+        if ( ret > 0 )
+        {
+            sentBytes += ret;
+            continue;
+        }
+        if ( ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+        struct pollfd pfd = { master, POLLOUT, 0 };
+        poll(&pfd, 1, EMU_POLL_INTERVAL_MS);
+    }
+
+    stats.txBytes += inLen;
+
+    return sentBytes;
+}
+
+int MS500Emulator::sendAck(unsigned char tag)
+{
+    response_t response = { 1, 0, { tag, 0 } };
+
+    return writeResponse((const unsigned char*)&response, sizeof(response));
+}
+
+int MS500Emulator::sendNak(unsigned char tag)
+{
+    response_t response = { 0, 1, { tag, 0 } };
+
+    stats.naks++;
+    return writeResponse((const unsigned char*)&response, sizeof(response));
+}
+
+/* a new uploader load is a new device in the socket */
+void MS500Emulator::resetDevice(void)
+{
+    PrintStats();
+
+    devices++;
+    memset(&stats, 0x00, sizeof(stats));
+    clock_gettime(CLOCK_MONOTONIC, &stats.start);
+    rxClock   = stats.start;
+    busyClock = stats.start;
+
+    uploaderRunning  = 0;
+    baudrate         = baseBaudrate;
+    previousBaudrate = baseBaudrate;
+    baudrateSwitched = 0;
+    eraseBase        = 0;
+    eraseSize        = 0;
+    sdbStreamOpen    = 0;
+
+    if ( keepState == 0 )
+    {
+        memset(efuse, 0x00, sizeof(efuse));
+        memset(flash, 0xFF, EMU_FLASH_SIZE);
+        memset(sdb, 0x00, sizeof(sdb));
+        sdbCount = 0;
+    }
+}
+
+/*
+ * no reset line reaches the emulator: the first SRAM header after an uploader session(or at
+ * start) powers a new device up, and its ROM drops everything until romBootMs later.
+ */
+int MS500Emulator::romDeaf(void)
+{
+    struct timespec now;
+
+    if ( romBootMs <= 0 )
+    {
+        return 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if ( romBooting == 0 )
+    {
+        romBooting      = 1;
+        uploaderRunning = 0;
+        romBootDeadline = now;
+        tsAddUs(&romBootDeadline, (long)romBootMs * 1000);
+    }
+
+    if ( tsCompare(&now, &romBootDeadline) < 0 )
+    {
+        tcflush(master, TCIFLUSH);
+        return 1;
+    }
+
+    return 0;
+}
+
+int MS500Emulator::handleSram(const cmdPacketHeader_t* header)
+{
+    int ret = -1;
+
+    resetDevice();
+
+    unsigned int uploaderSize = header->size[1];
+    unsigned int packetSize   = header->size[0];
+    if ( uploaderSize == 0 || uploaderSize > EMU_UPLOADER_MAX_SIZE
+      || packetSize != uploaderSize + sizeof(UPLOADER_BINARY_PREFIX) + sizeof(uploaderSize) )
+    {
+        DBG_ERR("uploader size %u/%u", packetSize, uploaderSize);
+        return sendNak(0);
+    }
+
+    ret = sendAck(0);
+    if ( ret < 0 )
+    {
+        return -1;
+    }
+
+    unsigned char* packet = new unsigned char[packetSize];
+    int timeoutMs = EMU_PACKET_TIMEOUT_MS + ((baudrate > 0) ? (int)((unsigned long long)packetSize * 10 * 1000 / baudrate) : 0);
+    ret = readPacket(packet, packetSize, timeoutMs, 1);
+    if ( ret <= 0 )
+    {
+        delete[] packet;
+        DBG_ERR("uploader timeout");
+        return -1;
+    }
+
+    unsigned int trailerSize = 0;
+    memcpy(&trailerSize, packet + uploaderSize + sizeof(UPLOADER_BINARY_PREFIX), sizeof(trailerSize));
+    if ( CRC32::CalcCRC32(packet, uploaderSize) != header->crc
+      || memcmp(packet + uploaderSize, UPLOADER_BINARY_PREFIX, sizeof(UPLOADER_BINARY_PREFIX)) != 0
+      || trailerSize != uploaderSize )
+    {
+        delete[] packet;
+        stats.crcErrors++;
+        DBG_ERR("uploader crc error");
+        return sendNak(0);
+    }
+    delete[] packet;
+
+    ret = sendAck(0);
+    if ( ret < 0 )
+    {
+        return -1;
+    }
+
+    /* DONE: the same header again, then the uploader boots and says hello */
+    cmdPacketHeader_t done;
+    ret = 0;
+    for ( int i = 0; ret == 0 && i < (EMU_PACKET_TIMEOUT_MS / EMU_POLL_INTERVAL_MS); i++ )
+    {
+        ret = readHeader(&done);
+    }
+    if ( ret <= 0 || done.type != PACKET_TYPE_SRAM || done.crc != header->crc )
+    {
+        DBG_ERR("uploader done error");
+        return -1;
+    }
+
+    uploaderRunning = 1;
+    romBooting      = 0;
+
+    ret = writeResponse(EMU_START_MESSAGE, UPLOADER_START_MESSAGE_SIZE);
+    if ( ret < 0 )
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+int MS500Emulator::handleEfuseWrite(const cmdPacketHeader_t* header)
+{
+    int ret = -1;
+
+    unsigned int type = header->param;
+    if ( uploaderRunning == 0 || type >= EFUSE_TYPE_MAX || header->size[0] != eFuseLength[type] )
+    {
+        DBG_ERR("efuse write %u, size %u", type, header->size[0]);
+        return sendNak(0);
+    }
+
+    unsigned char data[32] = {0,};
+    ret = readPacket(data, header->size[0], EMU_PACKET_TIMEOUT_MS, 0);
+    if ( ret <= 0 )
+    {
+        return -1;
+    }
+
+    if ( CRC32::CalcCRC32(data, header->size[0]) != header->crc )
+    {
+        stats.crcErrors++;
+        return sendNak(0);
+    }
+
+    /* the host sends the key byte swapped, fuses only ever go 0 -> 1 */
+    for ( unsigned int i = 0; i < header->size[0]; i++ )
+    {
+        efuse[type][i] |= data[header->size[0] - i - 1];
+    }
+    stats.efuseWrites++;
+
+    addBusyTime(efuseLatencyUs);
+
+    return sendAck(0);
+}
+
+int MS500Emulator::handleEfuseRead(const cmdPacketHeader_t* header)
+{
+    unsigned int type = header->param;
+    if ( uploaderRunning == 0 || type >= EFUSE_TYPE_MAX )
+    {
+        DBG_ERR("efuse read %u", type);
+        return sendNak(0);
+    }
+
+    stats.efuseReads++;
+
+    /* no ack, the value is the answer */
+    return writeResponse(efuse[type], eFuseLength[type]);
+}
+
+/* TLV writes in order, then the whole eFuse image and its crc behind the ack */
+int MS500Emulator::handleEfuseBatch(const cmdPacketHeader_t* header)
+{
+    int ret = -1;
+
+    if ( uploaderRunning == 0 || header->size[0] > EFUSE_BATCH_MAX_SIZE )
+    {
+        DBG_ERR("efuse batch, size %u", header->size[0]);
+        return sendNak(0);
+    }
+
+    unsigned char data[EFUSE_BATCH_MAX_SIZE] = {0,};
+    if ( header->size[0] != 0 )
+    {
+        ret = readPacket(data, header->size[0], EMU_PACKET_TIMEOUT_MS, 0);
+        if ( ret <= 0 )
+        {
+            return -1;
+        }
+
+        if ( CRC32::CalcCRC32(data, header->size[0]) != header->crc )
+        {
+            stats.crcErrors++;
+            return sendNak(0);
+        }
+    }
+
+    /* an older uploader drops the packet as unknown */
+    if ( efuseBatch == 0 )
+    {
+        return sendNak(0);
+    }
+
+    /* the whole list is checked before anything is burnt */
+    unsigned int offset = 0;
+    for ( unsigned int i = 0; i < header->param; i++ )
+    {
+        const eFuseTlv_t* tlv = (const eFuseTlv_t*)(data + offset);
+        if ( offset + sizeof(eFuseTlv_t) > header->size[0]
+          || tlv->type >= EFUSE_TYPE_MAX || tlv->length != eFuseLength[tlv->type]
+          || offset + sizeof(eFuseTlv_t) + tlv->length > header->size[0] )
+        {
+            DBG_ERR("efuse batch entry %u", i);
+            return sendNak(0);
+        }
+        offset += sizeof(eFuseTlv_t) + tlv->length;
+    }
+    if ( offset != header->size[0] )
+    {
+        DBG_ERR("efuse batch, %u bytes left", header->size[0] - offset);
+        return sendNak(0);
+    }
+
+    offset = 0;
+    for ( unsigned int i = 0; i < header->param; i++ )
+    {
+        const eFuseTlv_t*    tlv   = (const eFuseTlv_t*)(data + offset);
+        const unsigned char* value = data + offset + sizeof(eFuseTlv_t);
+
+        /* same byte order as PACKET_TYPE_EFUSE_WRITE */
+        for ( unsigned int j = 0; j < tlv->length; j++ )
+        {
+            efuse[tlv->type][j] |= value[tlv->length - j - 1];
+        }
+        stats.efuseWrites++;
+        addBusyTime(efuseLatencyUs);
+
+        offset += sizeof(eFuseTlv_t) + tlv->length;
+    }
+
+    /* ack + image + crc leave as one response */
+    unsigned char reply[sizeof(response_t) + EFUSE_IMAGE_SIZE + sizeof(unsigned int)] = {0,};
+    response_t*   response = (response_t*)reply;
+    unsigned char* image   = reply + sizeof(response_t);
+
+    response->ack = 1;
+    for ( int i = EFUSE_BOOT_SRC; i < EFUSE_TYPE_MAX; i++ )
+    {
+        memcpy(image + eFuseImageOffset((eEFUSETYPE)i), efuse[i], eFuseLength[i]);
+    }
+    unsigned int crc = CRC32::CalcCRC32(image, EFUSE_IMAGE_SIZE);
+    memcpy(image + EFUSE_IMAGE_SIZE, &crc, sizeof(crc));
+    stats.efuseReads++;
+
+    return writeResponse(reply, sizeof(reply));
+}
+
+int MS500Emulator::handleFlash(const cmdPacketHeader_t* header)
+{
+    int ret = -1;
+
+    unsigned char tag  = header->reserved[0];
+    unsigned int  addr = header->param;
+    unsigned int  size = header->size[0];
+    if ( uploaderRunning == 0 || size == 0 || size > FLASH_SECTOR_SIZE
+      || addr < FLASH_BASE_ADDR || (addr - FLASH_BASE_ADDR) + size > EMU_FLASH_SIZE
+      || (header->type == PACKET_TYPE_FLASH_FILL && size != sizeof(flashFill_t)) )
+    {
+        DBG_ERR("flash 0x%08X, size %u", addr, size);
+        return sendNak(tag);
+    }
+
+    unsigned char data[FLASH_SECTOR_SIZE];
+    unsigned char packed[FLASH_SECTOR_SIZE];
+    ret = readPacket((header->type == PACKET_TYPE_FLASH) ? data : packed, size, EMU_PACKET_TIMEOUT_MS, 0);
+    if ( ret <= 0 )
+    {
+        return -1;
+    }
+
+    /* expand the fill into the sector buffer */
+    if ( header->type == PACKET_TYPE_FLASH_FILL )
+    {
+        const flashFill_t* fill = (const flashFill_t*)packed;
+        if ( fill->length == 0 || fill->length > FLASH_SECTOR_SIZE || (addr - FLASH_BASE_ADDR) + fill->length > EMU_FLASH_SIZE )
+        {
+            DBG_ERR("flash 0x%08X fill length %u", addr, fill->length);
+            return sendNak(tag);
+        }
+        memset(data, fill->value, fill->length);
+        stats.fillSectors++;
+        size = fill->length;
+    }
+
+    /* inflate into the sector buffer, the decoded length is the sector length */
+    if ( header->type == PACKET_TYPE_FLASH_COMPRESSED )
+    {
+        ret = LZ4Block::Decompress(packed, size, data, sizeof(data));
+        if ( ret <= 0 || (addr - FLASH_BASE_ADDR) + ret > EMU_FLASH_SIZE )
+        {
+            stats.crcErrors++;
+            DBG_ERR("flash 0x%08X lz4 error", addr);
+            return sendNak(tag);
+        }
+        stats.packedSectors++;
+        stats.packedBytes   += size;
+        stats.inflatedBytes += ret;
+        size = ret;
+    }
+
+    if ( CRC32::CalcCRC32(data, size) != header->crc )
+    {
+        stats.crcErrors++;
+        DBG_ERR("flash 0x%08X crc error", addr);
+        return sendNak(tag);
+    }
+
+    /*
+     * delta flashing erases just this sector(timed at the block erase rate), otherwise a sector
+     * outside the erased range starts a new region: erase size[1](region size)
+     */
+    unsigned int offset = addr - FLASH_BASE_ADDR;
+    if ( (header->reserved[1] & FLASH_FLAG_SECTOR_ERASE) != 0 )
+    {
+        unsigned int sectorBase = offset - (offset % FLASH_SECTOR_SIZE);
+        memset(flash + sectorBase, 0xFF, FLASH_SECTOR_SIZE);
+        stats.eraseSectors++;
+        addBusyTime((int)((long long)eraseLatencyUs * FLASH_SECTOR_SIZE / EMU_ERASE_BLOCK_SIZE));
+    }
+    else
+    if ( offset < eraseBase || offset >= eraseBase + eraseSize )
+    {
+        unsigned int blocks = (header->size[1] + EMU_ERASE_BLOCK_SIZE - 1) / EMU_ERASE_BLOCK_SIZE;
+        eraseBase = offset - (offset % EMU_ERASE_BLOCK_SIZE);
+        eraseSize = blocks * EMU_ERASE_BLOCK_SIZE;
+        if ( eraseBase + eraseSize > EMU_FLASH_SIZE )
+        {
+            eraseSize = EMU_FLASH_SIZE - eraseBase;
+        }
+        memset(flash + eraseBase, 0xFF, eraseSize);
+        stats.eraseBlocks += blocks;
+        addBusyTime(eraseLatencyUs * blocks);
+    }
+
+    /* NOR program only clears bits, a sector written twice without erase fails verify */
+    ret = 0;
+    for ( unsigned int i = 0; i < size; i++ )
+    {
+        flash[offset + i] &= data[i];
+        if ( flash[offset + i] != data[i] )
+        {
+            ret = -1;
+        }
+    }
+    stats.sectors++;
+
+    addBusyTime(sectorLatencyUs);
+
+    if ( ret < 0 )
+    {
+        DBG_ERR("flash 0x%08X verify error", addr);
+        return sendNak(tag);
+    }
+
+    return sendAck(tag);
+}
+
+int MS500Emulator::handleFlashSdb(const cmdPacketHeader_t* header)
+{
+    int ret = -1;
+
+    unsigned int size = header->size[0];
+    if ( uploaderRunning == 0 || size < SDB_INFO_HEADER_SIZE || size > SDB_INFO_HEADER_SIZE + EMU_SDB_MAX_SIZE )
+    {
+        DBG_ERR("sdb size %u", size);
+        return sendNak(0);
+    }
+
+    unsigned char* packet = new unsigned char[size];
+    ret = readPacket(packet, size, EMU_PACKET_TIMEOUT_MS + ((baudrate > 0) ? (int)((unsigned long long)size * 10 * 1000 / baudrate) : 0), 0);
+    if ( ret <= 0 )
+    {
+        delete[] packet;
+        return -1;
+    }
+
+    SDBInfoFile_t* sdbinfo = (SDBInfoFile_t*)packet;
+    if ( sdbinfo->datasize != size - SDB_INFO_HEADER_SIZE
+      || (header->crc != 0 && CRC32::CalcCRC32(packet, size) != header->crc) )
+    {
+        delete[] packet;
+        stats.crcErrors++;
+        DBG_ERR("sdb data error");
+        return sendNak(0);
+    }
+
+    emuSdbEntry_t entry;
+    memcpy(entry.path, sdbinfo->path, sizeof(entry.path));
+    entry.datasize = sdbinfo->datasize;
+    entry.crc      = CRC32::CalcCRC32(packet + SDB_INFO_HEADER_SIZE, sdbinfo->datasize);
+    storeSdb(&entry);
+
+    stats.sdbPackets++;
+    addBusyTime(sectorLatencyUs * ((sdbinfo->datasize + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE));
+    delete[] packet;
+
+    return sendAck(0);
+}
+
+/* stored by path, a second load of the same path replaces it */
+void MS500Emulator::storeSdb(const emuSdbEntry_t* entry)
+{
+    int index = 0;
+    while ( index < sdbCount && strncmp((const char*)sdb[index].path, (const char*)entry->path, sizeof(sdb[index].path)) != 0 )
+    {
+        index++;
+    }
+    if ( index < EMU_SDB_ENTRY_MAX )
+    {
+        sdb[index] = *entry;
+        sdbCount = (index < sdbCount) ? sdbCount : (index + 1);
+    }
+}
+
+int MS500Emulator::handleSdbOpen(const cmdPacketHeader_t* header)
+{
+    int ret = -1;
+
+    sdbStreamOpen = 0;
+    if ( uploaderRunning == 0 || header->size[0] != SDB_INFO_HEADER_SIZE )
+    {
+        DBG_ERR("sdb open size %u", header->size[0]);
+        return sendNak(0);
+    }
+
+    unsigned char info[SDB_INFO_HEADER_SIZE];
+    ret = readPacket(info, sizeof(info), EMU_PACKET_TIMEOUT_MS, 0);
+    if ( ret <= 0 )
+    {
+        return -1;
+    }
+
+    const SDBInfoFile_t* sdbinfo = (const SDBInfoFile_t*)info;
+    if ( CRC32::CalcCRC32(info, sizeof(info)) != header->crc || sdbinfo->datasize != header->size[1] )
+    {
+        stats.crcErrors++;
+        DBG_ERR("sdb open error");
+        return sendNak(0);
+    }
+
+    memcpy(sdbStream.path, sdbinfo->path, sizeof(sdbStream.path));
+    sdbStream.datasize = sdbinfo->datasize;
+    sdbStream.crc      = 0;
+    sdbStreamOffset    = 0;
+    sdbStreamOpen      = 1;
+    stats.sdbPackets++;
+
+    if ( sdbStream.datasize == 0 )
+    {
+        storeSdb(&sdbStream);
+        sdbStreamOpen = 0;
+    }
+
+    return sendAck(0);
+}
+
+/* nothing but the running crc is kept, an entry has no size limit */
+int MS500Emulator::handleSdbChunk(const cmdPacketHeader_t* header)
+{
+    int ret = -1;
+
+    unsigned char tag  = header->reserved[0];
+    unsigned int  size = header->size[0];
+    if ( uploaderRunning == 0 || size == 0 || size > FLASH_SECTOR_SIZE )
+    {
+        DBG_ERR("sdb chunk 0x%08X, size %u", header->param, size);
+        return sendNak(tag);
+    }
+
+    unsigned char data[FLASH_SECTOR_SIZE];
+    ret = readPacket(data, size, EMU_PACKET_TIMEOUT_MS, 0);
+    if ( ret <= 0 )
+    {
+        return -1;
+    }
+    chunks++;
+
+    /* behind a NAKed chunk until it comes again */
+    if ( sdbStreamOpen == 0 || header->param != sdbStreamOffset || header->size[1] != sdbStream.datasize
+      || size > sdbStream.datasize - sdbStreamOffset )
+    {
+        return sendNak(tag);
+    }
+
+    if ( CRC32::CalcCRC32(data, size) != header->crc || (chunkFault > 0 && (chunks % chunkFault) == 0) )
+    {
+        stats.crcErrors++;
+        DBG_ERR("sdb chunk 0x%08X crc error", header->param);
+        return sendNak(tag);
+    }
+
+    sdbStream.crc    = CRC32::CalcCRC32(data, size, sdbStream.crc);
+    sdbStreamOffset += size;
+    stats.sdbChunks++;
+    addBusyTime(sectorLatencyUs);
+
+    if ( sdbStreamOffset == sdbStream.datasize )
+    {
+        storeSdb(&sdbStream);
+        sdbStreamOpen = 0;
+    }
+
+    return sendAck(tag);
+}
+
+int MS500Emulator::handleCrc(const cmdPacketHeader_t* header)
+{
+    int ret = -1;
+
+    unsigned char reply[sizeof(response_t) + FLASH_CRC_SECTOR_MAX * sizeof(unsigned int)] = {0,};
+    response_t*   response = (response_t*)reply;
+    unsigned int  crc[FLASH_CRC_SECTOR_MAX] = {0,};
+    unsigned int  crcCount = 1;
+
+    if ( uploaderRunning == 0 )
+    {
+        DBG_ERR("crc before the uploader");
+        return sendNak(0);
+    }
+
+    if ( header->reserved[0] == CRC_TARGET_FLASH || header->reserved[0] == CRC_TARGET_SECTORS )
+    {
+        unsigned int offset = header->param - FLASH_BASE_ADDR;
+        unsigned int length = header->size[1];
+        if ( header->param < FLASH_BASE_ADDR || offset > EMU_FLASH_SIZE || length > EMU_FLASH_SIZE - offset )
+        {
+            DBG_ERR("crc 0x%08X, size %u", header->param, length);
+            return sendNak(0);
+        }
+
+        if ( header->reserved[0] == CRC_TARGET_FLASH )
+        {
+            crc[0] = CRC32::CalcCRC32(flash + offset, length);
+        }
+        else
+        {
+            crcCount = (length + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+            if ( crcCount > FLASH_CRC_SECTOR_MAX )
+            {
+                DBG_ERR("crc 0x%08X, %u sectors", header->param, crcCount);
+                return sendNak(0);
+            }
+            for ( unsigned int i = 0; i < crcCount; i++ )
+            {
+                unsigned int base = i * FLASH_SECTOR_SIZE;
+                crc[i] = CRC32::CalcCRC32(flash + offset + base, (length - base < FLASH_SECTOR_SIZE) ? (length - base) : FLASH_SECTOR_SIZE);
+            }
+        }
+    }
+    else
+    if ( header->reserved[0] == CRC_TARGET_SDB && header->size[0] == SDB_INFO_HEADER_SIZE )
+    {
+        unsigned char info[SDB_INFO_HEADER_SIZE];
+        ret = readPacket(info, sizeof(info), EMU_PACKET_TIMEOUT_MS, 0);
+        if ( ret <= 0 )
+        {
+            return -1;
+        }
+        if ( CRC32::CalcCRC32(info, sizeof(info)) != header->crc )
+        {
+            stats.crcErrors++;
+            return sendNak(0);
+        }
+
+        const SDBInfoFile_t* sdbinfo = (const SDBInfoFile_t*)info;
+        int index = 0;
+        while ( index < sdbCount && strncmp((const char*)sdb[index].path, (const char*)sdbinfo->path, sizeof(sdb[index].path)) != 0 )
+        {
+            index++;
+        }
+        if ( index == sdbCount || sdb[index].datasize != sdbinfo->datasize )
+        {
+            return sendNak(0);
+        }
+        crc[0] = sdb[index].crc;
+    }
+    else
+    {
+        DBG_ERR("crc target %u", header->reserved[0]);
+        return sendNak(0);
+    }
+
+    response->ack = 1;
+    memcpy(reply + sizeof(response_t), crc, crcCount * sizeof(unsigned int));
+
+    return writeResponse(reply, sizeof(response_t) + crcCount * sizeof(unsigned int));
+}
+
+int MS500Emulator::handleBaudrate(const cmdPacketHeader_t* header)
+{
+    int ret = -1;
+
+    int newBaudrate = (int)header->param;
+    if ( uploaderRunning == 0 || newBaudrate <= 0 || (maxBaudrate > 0 && newBaudrate > maxBaudrate) )
+    {
+        DBG_ERR("baudrate %d refused", newBaudrate);
+        return sendNak(0);
+    }
+
+    /* ack at the current rate, then switch and wait for a ping at the new one */
+    ret = sendAck(0);
+    if ( ret < 0 )
+    {
+        return -1;
+    }
+
+    if ( baseBaudrate > 0 )
+    {
+        previousBaudrate = baudrate;
+        baudrate         = newBaudrate;
+    }
+    baudrateSwitched = 1;
+    clock_gettime(CLOCK_MONOTONIC, &baudrateDeadline);
+    tsAddUs(&baudrateDeadline, (long)BAUDRATE_FALLBACK_MS * 1000);
+
+    return 0;
+}
+
+int MS500Emulator::handlePing(const cmdPacketHeader_t* /* header */)
+{
+    if ( uploaderRunning == 0 )
+    {
+        return sendNak(0);
+    }
+
+    baudrateSwitched = 0;
+
+    return sendAck(0);
+}
+
+int MS500Emulator::Run(void)
+{
+    int ret = -1;
+    cmdPacketHeader_t header;
+
+    if ( master < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    running = 1;
+    while ( running )
+    {
+        ret = readHeader(&header);
+        if ( ret <= 0 )
+        {
+            continue;
+        }
+
+        switch ( header.type )
+        {
+            case PACKET_TYPE_SRAM:
+                if ( romDeaf() )
+                {
+                    break;
+                }
+                ret = handleSram(&header);
+                break;
+
+            case PACKET_TYPE_EFUSE_WRITE:
+                ret = handleEfuseWrite(&header);
+                break;
+
+            case PACKET_TYPE_EFUSE_READ:
+                ret = handleEfuseRead(&header);
+                break;
+
+            case PACKET_TYPE_EFUSE_BATCH:
+                ret = handleEfuseBatch(&header);
+                break;
+
+            case PACKET_TYPE_FLASH:
+            case PACKET_TYPE_FLASH_COMPRESSED:
+            case PACKET_TYPE_FLASH_FILL:
+                ret = handleFlash(&header);
+                break;
+
+            case PACKET_TYPE_FLASH_SDB:
+                ret = handleFlashSdb(&header);
+                break;
+
+            case PACKET_TYPE_SDB_OPEN:
+                ret = handleSdbOpen(&header);
+                break;
+
+            case PACKET_TYPE_SDB_CHUNK:
+                ret = handleSdbChunk(&header);
+                break;
+
+            case PACKET_TYPE_CRC:
+                ret = handleCrc(&header);
+                break;
+
+            case PACKET_TYPE_BAUDRATE:
+                ret = handleBaudrate(&header);
+                break;
+
+            case PACKET_TYPE_PING:
+                ret = handlePing(&header);
+                break;
+
+            default:
+                {
+                    DBG_ERR("unknown packet 0x%02X", header.type);
+                    ret = sendNak(0);
+                }
+                break;
+        }
+
+        /* lost sync: drop whatever is left of the packet */
+        if ( ret < 0 )
+        {
+            tcflush(master, TCIFLUSH);
+        }
+    }
+
+    PrintStats();
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+#ifndef __MS500EMULATOR_H__
+#define __MS500EMULATOR_H__
+
+#include <time.h>
+
+#include "MS500Protocol.h"
+
+/* emulated flash: FLASH_BASE_ADDR ~ FLASH_BASE_ADDR + EMU_FLASH_SIZE */
+static const unsigned int EMU_FLASH_SIZE        = (0x400000);
+static const unsigned int EMU_ERASE_BLOCK_SIZE  = (0x10000);
+static const unsigned int EMU_UPLOADER_MAX_SIZE = (0x40000);
+static const unsigned int EMU_SDB_MAX_SIZE      = (0x100000);
+static const int          EMU_SDB_ENTRY_MAX     = (32);
+
+/* a stored SDB entry, only what PACKET_TYPE_CRC answers with */
+typedef struct _emuSdbEntry_t
+{
+    unsigned char path[128];
+    unsigned int  datasize;
+    unsigned int  crc;
+} emuSdbEntry_t;
+
+/* per device counters, printed when the next device starts and at exit */
+typedef struct _emuStats_t
+{
+    struct timespec start;
+    unsigned long   rxBytes;
+    unsigned long   txBytes;
+    unsigned int    sectors;
+    unsigned int    eraseBlocks;
+    unsigned int    eraseSectors;
+    unsigned int    packedSectors;      /* PACKET_TYPE_FLASH_COMPRESSED */
+    unsigned long   packedBytes;
+    unsigned long   inflatedBytes;
+    unsigned int    fillSectors;        /* PACKET_TYPE_FLASH_FILL */
+    unsigned int    sdbPackets;
+    unsigned int    sdbChunks;          /* PACKET_TYPE_SDB_CHUNK */
+    unsigned int    efuseWrites;
+    unsigned int    efuseReads;
+    unsigned int    crcErrors;
+    unsigned int    naks;
+} emuStats_t;
+
+/*
+ * MS500 ROM bootloader + uploader on the master side of a pseudo terminal.
+ * ProcessController opens the slave(-d) like the real uart. Wire time at the emulated
+ * baudrate and the flash/eFuse latencies are simulated against a virtual clock, so a
+ * windowed transfer overlaps reception and programming like the real device does.
+ */
+class MS500Emulator
+{
+    public:
+        MS500Emulator(void);
+        virtual ~MS500Emulator(void);
+
+        int Open(const char* linkName);
+        int Close(void);
+        int Run(void);
+        void Stop(void);
+        const char* GetSlaveName(void);
+
+        void SetBaudrate(int baudrate);             /* 0: no wire pacing */
+        void SetMaxBaudrate(int baudrate);          /* uploader refuses faster rates, 0: any */
+        void SetSectorLatencyUs(int latencyUs);
+        void SetEraseLatencyUs(int latencyUs);      /* per EMU_ERASE_BLOCK_SIZE */
+        void SetEfuseLatencyUs(int latencyUs);
+        void SetKeepState(int keep);                /* keep flash/eFuse between loads(same chip) */
+        void SetRomBootMs(int bootMs);              /* ROM deaf this long from a new device's first header */
+        void SetEfuseBatch(int enable);             /* 0: NAK PACKET_TYPE_EFUSE_BATCH like an older uploader */
+        void SetChunkFault(int every);              /* NAK every n-th SDB chunk as a crc error, 0: none */
+        void PrintStats(void);
+
+    private:
+        int   master;
+        int   slave;        /* kept open so the master never sees EIO between sessions */
+        char  slaveName[128];
+        char* linkName;
+        volatile int running;
+
+        int   baseBaudrate;
+        int   baudrate;
+        int   maxBaudrate;
+        int   sectorLatencyUs;
+        int   eraseLatencyUs;
+        int   efuseLatencyUs;
+        int   keepState;
+        int   romBootMs;
+        int   efuseBatch;
+        int   chunkFault;
+
+        /* device model */
+        int            uploaderRunning;
+        unsigned char* flash;
+        unsigned char  efuse[EFUSE_TYPE_MAX][32];
+        emuSdbEntry_t  sdb[EMU_SDB_ENTRY_MAX];
+        int            sdbCount;
+        emuSdbEntry_t  sdbStream;       /* entry being streamed, crc so far */
+        unsigned int   sdbStreamOffset; /* next chunk offset */
+        int            sdbStreamOpen;
+        unsigned int   chunks;          /* SDB chunks seen, for chunkFault */
+        unsigned int   eraseBase;
+        unsigned int   eraseSize;
+        int            baudrateSwitched;
+        int            previousBaudrate;
+        struct timespec baudrateDeadline;
+        int            romBooting;
+        struct timespec romBootDeadline;
+
+        /* virtual clocks: end of the last byte on the wire, end of the last flash/eFuse job */
+        struct timespec rxClock;
+        struct timespec busyClock;
+
+        int        devices;
+        emuStats_t stats;
+
+        int readPacket(unsigned char* out, unsigned int outLen, int timeoutMs, int first);
+        int readHeader(cmdPacketHeader_t* out);
+        int writeResponse(const unsigned char* in, unsigned int inLen);
+        int sendAck(unsigned char tag);
+        int sendNak(unsigned char tag);
+        void addWireTime(struct timespec* clock, unsigned int len);
+        void addBusyTime(int latencyUs);
+
+        void resetDevice(void);
+        int romDeaf(void);
+        int handleSram(const cmdPacketHeader_t* header);
+        int handleEfuseWrite(const cmdPacketHeader_t* header);
+        int handleEfuseRead(const cmdPacketHeader_t* header);
+        int handleEfuseBatch(const cmdPacketHeader_t* header);
+        int handleFlash(const cmdPacketHeader_t* header);
+        int handleFlashSdb(const cmdPacketHeader_t* header);
+        int handleSdbOpen(const cmdPacketHeader_t* header);
+        int handleSdbChunk(const cmdPacketHeader_t* header);
+        void storeSdb(const emuSdbEntry_t* entry);
+        int handleCrc(const cmdPacketHeader_t* header);
+        int handleBaudrate(const cmdPacketHeader_t* header);
+        int handlePing(const cmdPacketHeader_t* header);
+};
+
+#endif // __MS500EMULATOR_H__
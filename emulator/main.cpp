@@ -0,0 +1,189 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <getopt.h>
+#include <signal.h>
+
+#include "MS500Emulator.h"
+
+#include "debug.h"
+
+static int  baudrate           = 230400;
+static int  maxBaudrate        = 0;
+static int  sectorLatencyUs    = 0;
+static int  eraseLatencyUs     = 0;
+static int  efuseLatencyUs     = 0;
+static int  keepState          = 0;
+static int  romBootMs          = 0;
+static int  efuseBatch         = 1;
+static int  chunkFault         = 0;
+static char linkName[128]      = "/tmp/ms500emu";
+
+static MS500Emulator* emulator = NULL;
+
+static void print_usage(const char *prog)
+{
+    fprintf(stdout, "Usage: %s [-blefmrncko]\n", prog);
+    fprintf(stdout, "  -b --baudrate    base baudrate, 0: no wire pacing (default %d)\n", baudrate);
+    fprintf(stdout, "  -l --sector      sector program latency(us)        (default %d)\n", sectorLatencyUs);
+    fprintf(stdout, "  -e --erase       64KB block erase latency(us)      (default %d)\n", eraseLatencyUs);
+    fprintf(stdout, "  -f --efuse       eFuse write latency(us)           (default %d)\n", efuseLatencyUs);
+    fprintf(stdout, "  -m --maxbaudrate uploader baudrate limit, 0: any   (default %d)\n", maxBaudrate);
+    fprintf(stdout, "  -r --romboot     ROM boot time after reset(ms)     (default %d)\n", romBootMs);
+    fprintf(stdout, "  -n --nobatch     uploader without the eFuse batch packet\n");
+    fprintf(stdout, "  -c --chunkfault  NAK every n-th SDB chunk as a crc error (default %d)\n", chunkFault);
+    fprintf(stdout, "  -k --keep        keep flash/eFuse between devices\n");
+    fprintf(stdout, "  -o --link        pty symlink for -d                (default %s)\n", linkName);
+    exit(1);
+}
+
+static void parse_opts(int argc, char *argv[])
+{
+    int c;
+    while ( 1 )
+    {
+        static const struct option lopts[] = {
+            { "baudrate",    required_argument, 0, 'b' },
+            { "sector",      required_argument, 0, 'l' },
+            { "erase",       required_argument, 0, 'e' },
+            { "efuse",       required_argument, 0, 'f' },
+            { "maxbaudrate", required_argument, 0, 'm' },
+            { "romboot",     required_argument, 0, 'r' },
+            { "nobatch",     no_argument,       0, 'n' },
+            { "chunkfault",  required_argument, 0, 'c' },
+            { "keep",        no_argument,       0, 'k' },
+            { "link",        required_argument, 0, 'o' },
+            { 0, 0, 0, 0 },
+        };
+
+        c = getopt_long(argc, argv, "b:l:e:f:m:r:nc:ko:", lopts, NULL);
+
+        if ( c == -1 )
+        {
+            break;
+        }
+
+        switch ( c )
+        {
+            case 'b':
+                {
+                    baudrate = atoi(optarg);
+                }
+                break;
+
+            case 'l':
+                {
+                    sectorLatencyUs = atoi(optarg);
+                }
+                break;
+
+            case 'e':
+                {
+                    eraseLatencyUs = atoi(optarg);
+                }
+                break;
+
+            case 'f':
+                {
+                    efuseLatencyUs = atoi(optarg);
+                }
+                break;
+
+            case 'm':
+                {
+                    maxBaudrate = atoi(optarg);
+                }
+                break;
+
+            case 'r':
+                {
+                    romBootMs = atoi(optarg);
+                }
+                break;
+
+            case 'n':
+                {
+                    efuseBatch = 0;
+                }
+                break;
+
+            case 'c':
+                {
+                    chunkFault = atoi(optarg);
+                }
+                break;
+
+            case 'k':
+                {
+                    keepState = 1;
+                }
+                break;
+
+            case 'o':
+                {
+                    memset(linkName, 0x00, sizeof(linkName));
+                    strncpy(linkName, optarg, sizeof(linkName) - 1);
+                }
+                break;
+
+            default:
+                {
+                    print_usage(argv[0]);
+                }
+                break;
+        }
+    }
+}
+
+static void stop_handler(int /* sig */)
+{
+    if ( emulator != NULL )
+    {
+        emulator->Stop();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int ret = -1;
+
+    parse_opts(argc, argv);
+
+    emulator = new MS500Emulator();
+    emulator->SetBaudrate(baudrate);
+    emulator->SetMaxBaudrate(maxBaudrate);
+    emulator->SetSectorLatencyUs(sectorLatencyUs);
+    emulator->SetEraseLatencyUs(eraseLatencyUs);
+    emulator->SetEfuseLatencyUs(efuseLatencyUs);
+    emulator->SetKeepState(keepState);
+    emulator->SetRomBootMs(romBootMs);
+    emulator->SetEfuseBatch(efuseBatch);
+    emulator->SetChunkFault(chunkFault);
+
+    ret = emulator->Open((linkName[0] != '\0') ? linkName : NULL);
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+        delete emulator;
+        return -1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0x00, sizeof(sa));
+    sa.sa_handler = stop_handler;
+    sigaction(SIGINT,  &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    fprintf(stdout, "MS500 emulator on %s(%s), baudrate %d, sector %d us, erase %d us, efuse %d us\n",
+            emulator->GetSlaveName(), linkName, baudrate, sectorLatencyUs, eraseLatencyUs, efuseLatencyUs);
+    fflush(stdout);
+
+    ret = emulator->Run();
+
+    delete emulator;
+    emulator = NULL;
+
+    return ret;
+}
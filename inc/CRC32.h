@@ -4,10 +4,31 @@
 
 class CRC32
 {
+    /* test/CRC32Test.cpp holds every kernel to the byte table */
+    friend class CRC32Test;
+
     public:
         CRC32();
         virtual ~CRC32();
         static unsigned int CalcCRC32(const unsigned char *buf, const unsigned int size, unsigned int crc = 0);
+        static unsigned int CalcCRC32Ref(const unsigned char *buf, const unsigned int size, unsigned int crc = 0);
+        static const char*  GetKernelName(void);
+
+    private:
+        /* kernels take and return the pre-inverted crc */
+        typedef unsigned int (*calcFunc_t)(const unsigned char* p, unsigned int size, unsigned int crc);
+
+        static calcFunc_t kernel;
+        static calcFunc_t selectKernel(void);
+        static int        selfCheck(calcFunc_t calc);
+
+        static unsigned int calcRef(const unsigned char* p, unsigned int size, unsigned int crc);
+        static unsigned int calcSlice8(const unsigned char* p, unsigned int size, unsigned int crc);
+        static unsigned int calcSlice16(const unsigned char* p, unsigned int size, unsigned int crc);
+
+        /* CRC32Arm.cpp, ARMv8 crc32 instructions */
+        static int          armSupported(void);
+        static unsigned int calcArm(const unsigned char* p, unsigned int size, unsigned int crc);
 };
 
 #endif // __CRC32_H__
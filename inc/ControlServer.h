@@ -0,0 +1,104 @@
+#ifndef __CONTROLSERVER_H__
+#define __CONTROLSERVER_H__
+
+#include <cstdio>
+#include <pthread.h>
+
+#include "CustomThread.h"
+#include "ProcessController.h"
+
+static const int CONTROL_CLIENT_MAX  = (4);
+static const int CONTROL_LINE_MAX    = (1024);
+static const int CONTROL_SOCKET_MODE = (0600);
+
+typedef struct _controlClient_t
+{
+    int          fd;                        /* -1: free */
+    char         line[CONTROL_LINE_MAX];    /* request being received */
+    unsigned int lineLen;
+} controlClient_t;
+
+class ControlServer;
+
+class CycleWorker : public CustomThread
+{
+    public:
+        virtual void customThread(void* param);
+};
+
+class RecipeWorker : public CustomThread
+{
+    public:
+        virtual void customThread(void* param);
+};
+
+/* recipe keys, in SwitchRecipe() order */
+typedef enum _eRECIPEKEY {
+    RECIPE_CONF = 0,
+    RECIPE_UPLOADER,
+    RECIPE_IMAGE,
+    RECIPE_SDBINFO,
+    RECIPE_KEY_MAX
+} eRECIPEKEY;
+
+/*
+ * daemon mode: a Unix domain socket, one request per line, the reply lines end with
+ * "ok" or "error <reason>". the images stay loaded between requests, a cycle runs on its
+ * own thread so status can be asked while it runs, so does a recipe load.
+ *   start                    run one cycle, no power/start switch waits
+ *   status                   server state, last cycle and recipe result, ProcessController::WriteStatus()
+ *   recipe key=path ...      conf, uploader, image, sdbinfo: reload with those files, idle only
+ *   metrics                  latency histograms as JSON
+ *   shutdown                 wait for the running cycle and leave Run()
+ */
+class ControlServer
+{
+    friend class CycleWorker;
+    friend class RecipeWorker;
+
+    public:
+        ControlServer(ProcessController* controller);
+        virtual ~ControlServer(void);
+
+        int Open(const char* path);
+        int Close(void);
+        int Run(void);
+
+    private:
+        ProcessController* controller;
+        char               path[108];       /* sockaddr_un sun_path */
+        int                listenFd;
+        controlClient_t    client[CONTROL_CLIENT_MAX];
+
+        CycleWorker        worker;
+        RecipeWorker       loader;
+        pthread_mutex_t    mutex;
+        int                running;         /* a cycle is on the worker */
+        int                joinable;        /* the worker ran and is not reaped yet */
+        int                lastResult;      /* ProcessStart() of the last cycle, 1: none yet */
+        int                loading;         /* a recipe is on the loader */
+        int                loaderJoinable;
+        int                lastRecipe;      /* SwitchRecipe() of the last recipe, 1: none yet */
+        int                ready;           /* a recipe is loaded */
+        int                quit;
+
+        /* the recipe on the loader, recipe[] point into recipeArgs or are NULL */
+        char               recipeArgs[CONTROL_LINE_MAX];
+        const char*        recipe[RECIPE_KEY_MAX];
+
+        void runCycle(void);
+        void runRecipe(void);
+        int isBusy(void);
+        void reap(void);
+
+        void acceptClient(void);
+        void closeClient(controlClient_t* c);
+        int receive(controlClient_t* c);
+        int handleLine(int fd, char* line);
+        int handleStart(const char** error);
+        int handleStatus(FILE* out, const char** error);
+        int handleRecipe(char* args, const char** error);
+        int reply(int fd, const char* body, size_t bodyLen, const char* result);
+};
+
+#endif // __CONTROLSERVER_H__
@@ -1,6 +1,8 @@
 #ifndef __CUSTOMTHREAD_H__
 #define __CUSTOMTHREAD_H__
 
+#include <pthread.h>
+
 class CustomThread
 {
     public:
@@ -12,12 +14,16 @@ class CustomThread
         {
             CustomThread* customThread = (CustomThread*)classPointer;
             customThread->customThread(customThread->GetThreadParam());
+            return NULL;
         }
         void *GetThreadParam(void);
-        int ThreadStart(void* threadParam);
+        int ThreadStart(void* threadParam, bool joinable = false);
+        int ThreadJoin(void);
 
     private:
-        void* threadParam;
+        void*     threadParam;
+        pthread_t thread;
+        bool      joinable;
 
 };
 
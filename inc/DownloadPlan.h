@@ -0,0 +1,113 @@
+#ifndef __DOWNLOADPLAN_H__
+#define __DOWNLOADPLAN_H__
+
+#include <cstdio>
+#include <limits.h>
+
+#include "MS500Protocol.h"
+#include "ImageFile.h"
+
+/*
+ * download plan: everything ImageSet::Load() derives from setting.conf, the uploader, the .img
+ * and the SDB set(prebuilt packet headers, CRCs, region map, payloads) in one file.
+ * the runtime maps it and points its tables straight into it. the plan is keyed by the
+ * content CRC32 of every input, any input that changes makes it stale and it is rebuilt.
+ * a changed stat() rejects it before any input is read.
+ * offsets are from the start of the file, 8 byte aligned, 0: none.
+ */
+static const unsigned char PLAN_MAGIC[4] = {
+    (unsigned char)('M'),
+    (unsigned char)('S'),
+    (unsigned char)('P'),
+    (unsigned char)('L')
+};
+static const unsigned int PLAN_VERSION    = (3);
+static const int          PLAN_INPUT_MAX  = (4 + 64);   /* conf, uploader, img, sdbinfo + SDB data files */
+static const int          PLAN_SDB_MAX    = (64);
+static const int          PLAN_REGION_MAX = (3);        /* eIMAGEREGION */
+
+#pragma pack(push, 1)
+typedef struct _planInput_t
+{
+    char               path[256];
+    unsigned long long size;
+    long long          mtimeNs;
+    unsigned long long ino;
+    unsigned int       crc;         /* content, what the key really depends on */
+} planInput_t;
+
+/* one sectorTable_t */
+typedef struct _planRegion_t
+{
+    unsigned int addr;
+    unsigned int size;
+    unsigned int count;             /* sectors, 0: region not used */
+    unsigned int crc;
+    unsigned int erased;
+    unsigned int dataOffset;        /* raw region */
+    unsigned int headerOffset;      /* cmdPacketHeader_t[count] */
+    unsigned int payloadOffset;     /* unsigned int[count], what follows each header on the wire */
+    unsigned int fillOffset;        /* flashFill_t[count](FLASHFILL) */
+} planRegion_t;
+
+/* one SDB_n section of sdbinfo.ini */
+typedef struct _planSdb_t
+{
+    unsigned char info[SDB_INFO_HEADER_SIZE];
+    unsigned int  dataOffset;
+    unsigned int  dataSize;
+    unsigned int  crc;              /* data, what CRC_TARGET_SDB answers for a stored entry */
+    unsigned int  packetCrc;        /* info + data, the crc of the one-shot PACKET_TYPE_FLASH_SDB */
+} planSdb_t;
+
+typedef struct _planHeader_t
+{
+    unsigned char     magic[4];
+    unsigned int      version;
+    unsigned int      key;          /* CRC32 of the planInput_t[] */
+    unsigned int      size;         /* whole file */
+    unsigned int      inputCount;
+    unsigned int      inputOffset;
+    cmdPacketHeader_t uploaderHeader;
+    unsigned int      uploaderOffset;
+    unsigned int      uploaderSize;
+    int               secureBootEnabled;
+    planRegion_t      region[PLAN_REGION_MAX];
+    unsigned int      sdbCount;
+    unsigned int      sdbOffset;    /* planSdb_t[sdbCount] */
+} planHeader_t;
+#pragma pack(pop)
+
+class DownloadPlan
+{
+    public:
+        DownloadPlan(void);
+        virtual ~DownloadPlan(void);
+
+        /* 0: mapped and every input unchanged, 1: missing, stale or another version, -1: error */
+        int Load(const char* path, const char* const* inputs, int inputCount);
+        int Close(void);
+        const planHeader_t* GetHeader(void);
+        const unsigned char* GetRange(unsigned int offset, unsigned long long len);   /* NULL: 0 or not all in the file */
+
+        /* writer: records go to <path>.tmp, Commit() renames it over path once complete */
+        int Create(const char* path);
+        int AddInput(const char* path);
+        unsigned int Append(const void* in, unsigned int inLen);   /* offset, 0: error */
+        int Commit(planHeader_t* header);
+        void Abort(void);
+
+    private:
+        ImageFile*   file;
+        FILE*        out;
+        char         path[PATH_MAX];
+        char         tempPath[PATH_MAX];
+        unsigned int offset;
+        planInput_t  input[PLAN_INPUT_MAX];
+        int          inputCount;
+
+        static int statInput(const char* path, planInput_t* out);
+        static int crcInput(planInput_t* io);
+};
+
+#endif // __DOWNLOADPLAN_H__
@@ -0,0 +1,136 @@
+#ifndef __GPIOBACKEND_H__
+#define __GPIOBACKEND_H__
+
+#include <cstdio>
+#include <time.h>
+
+typedef enum _eGPIODIR {
+    GPIO_DIR_IN  = 0,
+    GPIO_DIR_OUT = 1
+} eGPIODIR;
+
+typedef enum _eGPIOPULL {
+    GPIO_PULL_OFF  = 0,
+    GPIO_PULL_DOWN = 1,
+    GPIO_PULL_UP   = 2
+} eGPIOPULL;
+
+/* BCM pin numbers, 0 ~ GPIO_PIN_MAX-1 */
+static const int GPIO_PIN_MAX = 64;
+
+/*
+ * pin level access used by GPIOControl.
+ * the hardware backends are chosen in the Makefile(GPIO_BACKEND), the simulated one is
+ * always built so any build can run the fixture loop off-target(-G sim).
+ */
+class GPIOBackend
+{
+    public:
+        virtual ~GPIOBackend(void) {}
+
+        virtual int Init(void) = 0;
+        virtual int SetMode(int pin, eGPIODIR dir, eGPIOPULL pull) = 0;
+        virtual int Write(int pin, int value) = 0;
+        virtual int Read(int pin) = 0;
+        virtual const char* GetName(void) = 0;
+        virtual int DumpTimeline(FILE* /* out */) { return 0; }
+
+        /*
+         * block until the next level change of an input pin or timeoutMs(-1: forever, 0: only
+         * drain pending changes). 1: changed, edge(CLOCK_MONOTONIC) set, 0: no change seen.
+         * the default has no edge source and sleeps one poll period, callers re-read the pin.
+         */
+        virtual int WaitEvent(int pin, int timeoutMs, struct timespec* edge);
+
+        /* name: "wiringpi", "gpiod", "sim", NULL: build default */
+        static GPIOBackend* Create(const char* name);
+};
+
+#ifdef __GPIO_WIRINGPI__
+class GPIOBackendWiringPi : public GPIOBackend
+{
+    public:
+        GPIOBackendWiringPi(void);
+        virtual ~GPIOBackendWiringPi(void);
+
+        virtual int Init(void);
+        virtual int SetMode(int pin, eGPIODIR dir, eGPIOPULL pull);
+        virtual int Write(int pin, int value);
+        virtual int Read(int pin);
+        virtual const char* GetName(void);
+        virtual int WaitEvent(int pin, int timeoutMs, struct timespec* edge);
+
+    private:
+        /* sysfs value fd with edge "both", -1: not opened, -2: no sysfs, polled */
+        int valueFd[GPIO_PIN_MAX];
+
+        int openEdge(int pin);
+};
+#endif
+
+#ifdef __GPIO_LIBGPIOD__
+struct gpiod_chip;
+struct gpiod_line;
+
+class GPIOBackendGpiod : public GPIOBackend
+{
+    public:
+        GPIOBackendGpiod(void);
+        virtual ~GPIOBackendGpiod(void);
+
+        virtual int Init(void);
+        virtual int SetMode(int pin, eGPIODIR dir, eGPIOPULL pull);
+        virtual int Write(int pin, int value);
+        virtual int Read(int pin);
+        virtual const char* GetName(void);
+        virtual int WaitEvent(int pin, int timeoutMs, struct timespec* edge);
+
+    private:
+        struct gpiod_chip* chip;
+        struct gpiod_line* line[GPIO_PIN_MAX];
+        eGPIODIR           dir[GPIO_PIN_MAX];
+};
+#endif
+
+/* one recorded level change of the simulated backend */
+typedef struct _gpioEvent_t
+{
+    struct timespec time;
+    short           pin;
+    short           value;
+} gpioEvent_t;
+
+static const int GPIO_SIM_EVENT_MAX   = 4096;
+static const int GPIO_SIM_REACTION_MS = 100;
+
+/*
+ * in-memory pins. outputs are recorded with a timestamp. an input starts at its asserted
+ * level(opposite of the pull) and an operator flips it GPIO_SIM_REACTION_MS into any wait
+ * at least that long, so the power on, start switch and power off waits pass at once and
+ * a shorter debounce window sees a clean edge.
+ */
+class GPIOBackendSim : public GPIOBackend
+{
+    public:
+        GPIOBackendSim(void);
+
+        virtual int Init(void);
+        virtual int SetMode(int pin, eGPIODIR dir, eGPIOPULL pull);
+        virtual int Write(int pin, int value);
+        virtual int Read(int pin);
+        virtual const char* GetName(void);
+        virtual int DumpTimeline(FILE* out);
+        virtual int WaitEvent(int pin, int timeoutMs, struct timespec* edge);
+
+    private:
+        eGPIODIR        dir[GPIO_PIN_MAX];
+        eGPIOPULL       pull[GPIO_PIN_MAX];
+        int             value[GPIO_PIN_MAX];
+
+        struct timespec start;
+        gpioEvent_t     event[GPIO_SIM_EVENT_MAX];
+        int             eventCount;
+        int             eventDropped;
+};
+
+#endif // __GPIOBACKEND_H__
@@ -1,6 +1,8 @@
 #ifndef __GPIOCONTROL_H__
 #define __GPIOCONTROL_H__
 
+#include "GPIOBackend.h"
+
 typedef enum _eSOCKETCHANNEL {
     SOCKET_CH1 = 0,
     SOCKET_CH2 = 1,
@@ -43,27 +45,58 @@ typedef enum _eGPIOPINNAME {
     GPIOPINNAME_MAX
 } eGPIOPINNAME;
 
+/*
+ * deliberate delays of the fixture(ms), tuned per fixture revision in the config file.
+ * the defaults are the original fixed sleeps.
+ */
+typedef struct _timingProfile_t
+{
+    int selectSettleMs;     /* UART mux/LED switched -> socket usable */
+    int resetSetupMs;       /* reset line high before the pulse */
+    int resetPulseMs;       /* reset line held low */
+    int resultHoldMs;       /* downloadProcess() done -> result LED, UART switch off */
+    int romProbeMs;         /* resend the first header until the ROM answers, 0: one try */
+} timingProfile_t;
+
+static const timingProfile_t TIMING_PROFILE_DEFAULT = { 500, 50, 50, 3000, 0 };
+
 class GPIOControl
 {
     public:
-        GPIOControl(void);
+        GPIOControl(const char* backendName = NULL);
         virtual ~GPIOControl(void);
 
+        const char* GetBackendName(void);
+        int DumpTimeline(FILE* out);
+
         int GPIOTest(void);
         int gpioInit(void);
-        int WaitDownloadReadySet(void);
-        int WaitDownloadReadyReset(void);
-        int WaitDownloadStart(void);
+        /* 0: level reached, edge(CLOCK_MONOTONIC) set, 1: timeout, timeoutMs -1: forever */
+        int WaitDownloadReadySet(int timeoutMs = -1, struct timespec* edge = NULL);
+        int WaitDownloadReadyReset(int timeoutMs = -1, struct timespec* edge = NULL);
+        int WaitDownloadStart(int timeoutMs = -1, struct timespec* edge = NULL);
+        void SetDebounce(int debounceMs);
+        void SetTiming(const timingProfile_t* timing);
+        long TakeDelayUs(void);     /* deliberate delay since the last call */
         int ResetAllSocket(void);
         int ResetSocket(void);
+        int ResetSocket(eSOCKETCHANNEL ch);
         int SetResultLED(eRESULTLED res);
+        int SetResultLED(eSOCKETCHANNEL ch, eRESULTLED res);
+        int ClearResultLED(eSOCKETCHANNEL ch);
         int SelectSocket(eSOCKETCHANNEL ch);
         int EnableUARTSW(void);
         int DisableUARTSW(void);
 
     private:
+        GPIOBackend*   backend;
         eSOCKETCHANNEL enabledSocket;
+        int            debounceMs;
+        timingProfile_t timing;
+        long           delayUs;
+        void settle(int ms);
         int gpioSet(eGPIOPINNAME pin);
+        int gpioWait(eGPIOPINNAME pin, int level, int timeoutMs, struct timespec* edge);
         int gpioReset(eGPIOPINNAME pin);
         int resetResultLED(void);
         int enableUARTCH(void);
@@ -0,0 +1,32 @@
+#ifndef __IMAGEFILE_H__
+#define __IMAGEFILE_H__
+
+#include <sys/stat.h>
+
+/*
+ * read-only mmap view of an image file.
+ * sub-spans handed out by GetData() point straight into the page cache, so several
+ * sessions reading the same file share one copy and nothing is copied at load time.
+ * snapshot 1: a private copy instead, a file rewritten in place later(cp over it) can
+ * neither tear nor SIGBUS what was read; a file that changes while it is read fails.
+ */
+class ImageFile
+{
+    public:
+        ImageFile(void);
+        virtual ~ImageFile(void);
+
+        int Open(const char* fileName, int snapshot = 0);
+        int Close(void);
+        const unsigned char* GetData(void);
+        unsigned int GetSize(void);
+
+    private:
+        unsigned char* data;
+        unsigned int   size;
+        int            copied;     /* data is new[]ed, not mapped */
+
+        int readCopy(int fd, const struct stat* st);
+};
+
+#endif // __IMAGEFILE_H__
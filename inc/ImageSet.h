@@ -0,0 +1,217 @@
+#ifndef __IMAGESET_H__
+#define __IMAGESET_H__
+
+#include "MS500Protocol.h"
+#include "GPIOControl.h"
+#include "ImageFile.h"
+#include "DownloadPlan.h"
+#include "ini.h"
+
+typedef enum _eFILETYPE
+{
+    FILE_NAME_CONF = 0,
+    FILE_NAME_UPLOADER,
+    FILE_NAME_APPIMAGE,
+    FILE_NAME_SDBINFO,
+    FILE_NAME_STATS,
+    FILE_NAME_RESULT,
+    FILE_NAME_PLAN
+} eFILETYPE;
+
+typedef enum _eOPTIONTYPE {
+    OPTION_FLASH_WINDOW = 0,
+    OPTION_UART_CH1,
+    OPTION_UART_CH2,
+    OPTION_UART_CH3,
+    OPTION_UART_CH4,
+    OPTION_UPLOADER_BAUDRATE,
+    OPTION_GPIO_DEBOUNCE,
+    OPTION_GPIO_TIMEOUT,
+    OPTION_SELECT_SETTLE,
+    OPTION_RESET_SETUP,
+    OPTION_RESET_PULSE,
+    OPTION_RESULT_HOLD,
+    OPTION_ROM_PROBE,
+    OPTION_REWORK_SCAN,
+    OPTION_FLASH_DELTA,
+    OPTION_FLASH_COMPRESS,
+    OPTION_FLASH_FILL,
+    OPTION_SDB_STREAM,
+    OPTION_HOT_RELOAD,
+    OPTION_TYPE_MAX
+} eOPTIONTYPE;
+
+typedef enum _eIMAGEREGION {
+    IMAGE_REGION_APP = 0,
+    IMAGE_REGION_PKA,
+    IMAGE_REGION_SIGNATURE,
+    IMAGE_REGION_MAX
+} eIMAGEREGION;
+
+static const char eFuseKeyParams[EFUSE_TYPE_MAX][64] = {
+    "[BOOTSOURCE]",
+    "[SECUREBOOTENABLE]",
+    "[UKEYLOCK]",
+    "[PKFLOCK]",
+    "[DUKLOCK]",
+	"[PKFWRITE]",
+    "[UKEY]",
+    "[PKF]"
+};
+
+static const unsigned int FLASH_WINDOW_MAX = (16);
+
+/* flash packet headers of one image region, built once at load and read-only after */
+typedef struct _sectorTable_t
+{
+    const unsigned char* data;      /* region start, points into the image mapping */
+    unsigned int         size;
+    unsigned int         addr;      /* flash address of data[0] */
+    unsigned int         count;     /* sectors */
+    unsigned int         crc;       /* whole region, matched against the device by the rework pre-scan */
+    cmdPacketHeader_t*   header;    /* [count], crc included, sector tag left 0 */
+    const unsigned char** payload;  /* [count], what follows header[i] on the wire */
+    unsigned char*       packed;    /* LZ4 sectors back to back(FLASHCOMPRESS), NULL: none */
+    flashFill_t*         fill;      /* [count], payload of the constant sectors(FLASHFILL), NULL: none */
+    unsigned int         erased;    /* erased sectors left to the region erase, not sent */
+    int                  mapped;    /* header/fill point into the download plan, not owned */
+} sectorTable_t;
+
+/* an erased sector after the first needs no packet, the region erase already left it 0xFF */
+static inline int erasedSector(const sectorTable_t* table, unsigned int i)
+{
+    return (i != 0) && (table->fill != NULL)
+        && (table->header[i].type == PACKET_TYPE_FLASH_FILL) && (table->fill[i].value == 0xFF);
+}
+
+class ProcessController;
+
+/*
+ * everything one recipe loads: the setting.conf values, the uploader and .img, the prebuilt
+ * sector tables, the download plan and the SDB list. Load() runs once on a set nobody
+ * uses yet, the controller then swaps it in whole and frees the previous set; a set in
+ * use is only read. ProcessController is a friend, the cycle reads the members directly.
+ */
+class ImageSet
+{
+    friend class ProcessController;
+
+    public:
+        ImageSet(void);
+        virtual ~ImageSet(void);
+
+        /* FILE_NAME_CONF, _UPLOADER, _APPIMAGE, _SDBINFO and _PLAN, before Load() */
+        int SetName(eFILETYPE type, const char* in);
+        int Load(void);
+
+    private:
+        char* configFileName;
+        char* uploaderFileName;
+        char* appImageFileName;
+        char* sdbInfoFileName;
+        char* planFileName;
+
+        /* per socket uart topology, none set: all sockets share the UART mux */
+        char* socketDeviceName[SOCKET_MAX];
+
+        /* uploader file binary */
+        ImageFile*           uploaderFile;
+        unsigned int         uploaderBinarySize;
+        const unsigned char* uploaderBinary;
+
+        /* ini file binary */
+        unsigned char* sdbCodeBinary;
+        unsigned int   sdbCodeBinarySize;
+        unsigned char  sdbPath;
+
+        /* app image file binary */
+        int secureBootEnabled;
+        ImageFile*           appImageFile;
+        const unsigned char* pkaBinary;
+        unsigned int         pkaBinarySize;
+        const unsigned char* signatureBinary;
+        unsigned int         signatureBinarySize;
+        const unsigned char* appCodeBinary;
+        unsigned int         appCodeBinarySize;
+        unsigned int   appImageTotalSize;
+
+        /* prebuilt packet headers, no crc work left for the per-device path */
+        cmdPacketHeader_t uploaderHeader;
+        sectorTable_t     sectorTable[IMAGE_REGION_MAX];
+
+        /* download plan the tables run from */
+        DownloadPlan*     plan;
+
+        /* SDB entries every device replays: from the plan, or parsed once into sdbList with the data files kept mapped */
+        planSdb_t*           sdbList;
+        ImageFile*           sdbFile;       /* [PLAN_SDB_MAX], the data of sdbList */
+        const planSdb_t*     sdbEntry;
+        const unsigned char* sdbData[PLAN_SDB_MAX];    /* data of each entry, in the plan or in sdbFile[], never copied */
+        int                  sdbEntryCount;
+
+        unsigned char  eFuseBootSource;
+        unsigned char  eFuseSecureBootEnable;
+		unsigned char  eFusePKfWrite;
+        unsigned char  eFuseUKeyLock;
+        unsigned char  eFusePKfLock;
+        unsigned char  eFuseDUKLock;
+        unsigned char  eFuseUKey[32];
+        unsigned char  eFusePKf[32];
+
+        /* flash sectors in flight before waiting for an ack, 1: stop-and-wait */
+        unsigned int   flashWindowSize;
+
+        /* 1: read the device state first and skip the steps already programmed(rework units) */
+        int            reworkScan;
+
+        /* 1: flash only the sectors whose device CRC differs(re-flash, field returns) */
+        int            flashDelta;
+
+        /* 1: sectors that shrink go as LZ4 blocks(PACKET_TYPE_FLASH_COMPRESSED), the uploader inflates */
+        int            flashCompress;
+
+        /* 1: constant sectors go as PACKET_TYPE_FLASH_FILL, erased ones after a region erase not at all */
+        int            flashFill;
+        int            sdbStream;
+
+        /* 1: a changed conf/uploader/img/sdbinfo is loaded in the background and swapped in at the next cycle */
+        int            hotReload;
+
+        /* baudrate the uploader is switched to once it runs, 0: stay at baudrate */
+        int            uploaderBaudrate;
+
+        /* power/start switch waits: stable time(ms) and give up time(ms, -1: forever) */
+        int            gpioDebounceMs;
+        int            gpioTimeoutMs;
+
+        /* fixture delays */
+        timingProfile_t timing;
+
+        int makeCmdHeader(ePACKETTYPE type, unsigned int param, const unsigned char* in, unsigned int inSize, unsigned int optionSize, cmdPacketHeader_t* out);
+
+		void swapPkf(unsigned char* arr, int first, int second);
+        int keyStringTohexArray(eEFUSETYPE type, const char* keyValue);
+        int parseValue(eEFUSETYPE type, const char* keyValue);
+        int parseOption(eOPTIONTYPE type, const char* value);
+        int parseLine(const char* line);
+        int parseConfigFile(void);
+        int parseSdb(ini_t* sdb, int index, unsigned char* outInfo, unsigned int outInfoLen, ImageFile* outData);
+        int loadSdbList(void);
+        void freeSdbList(void);
+        int getSdb(int index, const unsigned char** info, const unsigned char** data, unsigned int* size, unsigned int* crc, unsigned int* packetCrc = NULL);
+
+        int openUploaderFile(void);
+
+        int checkImgFilePrefix(const unsigned char* in);
+        int readSizeFromImgFile(unsigned int in, unsigned int* out);
+        int checkAppCodeBinarySize(unsigned int in);
+        int checkSdbCodeBinarySize(unsigned int in);
+        int checkAppImageTotalSize(unsigned int in, unsigned int in2);
+        int openAppImageFile(void);
+        int buildSectorTable(eIMAGEREGION region, const unsigned char* in, unsigned int inLen, unsigned int addr);
+        void freeSectorTable(void);
+        int compilePlan(void);
+        int applyPlan(void);
+};
+
+#endif // __IMAGESET_H__
@@ -0,0 +1,45 @@
+#ifndef __IMAGEWATCHER_H__
+#define __IMAGEWATCHER_H__
+
+#include <limits.h>
+#include <pthread.h>
+
+static const int IMAGE_WATCH_MAX = (8);
+
+typedef struct _imageWatch_t
+{
+    int  wd;                    /* watch of the directory, several files may share one */
+    char name[NAME_MAX + 1];    /* file in it */
+} imageWatch_t;
+
+/*
+ * inotify on the directories of the watched files, so a file replaced by rename(tools,
+ * scp, rsync) is seen as well as one rewritten in place(cp). only the change is seen:
+ * the set in use must not map a watched file, HOTRELOAD loads private copies of them.
+ * Watch() may be called again from another thread while Wait() runs.
+ */
+class ImageWatcher
+{
+    public:
+        ImageWatcher(void);
+        virtual ~ImageWatcher(void);
+
+        int Open(void);
+        int Close(void);
+
+        /* replaces the watched set, count 0: none */
+        int Watch(const char* const* paths, int count);
+
+        /* 1: a watched file changed and nothing more for quietMs, 0: timeoutMs passed, -1: error */
+        int Wait(int quietMs, int timeoutMs);
+
+    private:
+        int             fd;
+        imageWatch_t    watch[IMAGE_WATCH_MAX];
+        int             watchCount;
+        pthread_mutex_t mutex;
+
+        int readEvents(void);
+};
+
+#endif // __IMAGEWATCHER_H__
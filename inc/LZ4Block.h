@@ -0,0 +1,19 @@
+#ifndef __LZ4BLOCK_H__
+#define __LZ4BLOCK_H__
+
+/*
+ * LZ4 block format(no frame, no checksum), the PACKET_TYPE_FLASH_COMPRESSED payload.
+ * the decoder needs no state beyond the output buffer, so the uploader inflates straight
+ * into the sector buffer it already has.
+ */
+class LZ4Block
+{
+    public:
+        /* compressed size, 0: does not fit in outLen(incompressible), -1: error */
+        static int Compress(const unsigned char* in, unsigned int inLen, unsigned char* out, unsigned int outLen);
+
+        /* decompressed size, -1: malformed block or larger than outLen */
+        static int Decompress(const unsigned char* in, unsigned int inLen, unsigned char* out, unsigned int outLen);
+};
+
+#endif // __LZ4BLOCK_H__
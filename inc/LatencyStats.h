@@ -0,0 +1,114 @@
+#ifndef __LATENCYSTATS_H__
+#define __LATENCYSTATS_H__
+
+#include <cstdio>
+#include <time.h>
+#include <pthread.h>
+
+#include "GPIOControl.h"
+
+/* downloadProcess() phases in the order they run, then the fixture cycle */
+typedef enum _ePHASE {
+    PHASE_UPLOADER = 0,
+    PHASE_BAUDRATE,
+    PHASE_PRESCAN,              /* rework pre-scan(REWORKSCAN) */
+    PHASE_UKEY,
+    PHASE_PKF,
+    PHASE_SDB,
+    PHASE_APP,
+    PHASE_UKEY_LOCK,
+    PHASE_PKF_LOCK,
+    PHASE_DUK_LOCK,
+    PHASE_SB_EN,
+    PHASE_BOOT_SRC,
+    PHASE_EFUSE_BATCH,          /* UKEY_LOCK ~ BOOT_SRC in one PACKET_TYPE_EFUSE_BATCH */
+    PHASE_DEVICE_TOTAL,
+    PHASE_OPERATOR_START,       /* fixture row: power on -> start switch */
+    PHASE_MACHINE,              /* fixture row: start switch -> all sockets done */
+    PHASE_OPERATOR_REMOVE,      /* fixture row: done -> power off */
+    PHASE_DELAY,                /* fixture row: deliberate sleeps of the cycle(timing profile) */
+    PHASE_MAX
+} ePHASE;
+
+/* rows: SOCKET_CH1 ~ SOCKET_CH4, LATENCY_FIXTURE for the cycle phases */
+static const int LATENCY_FIXTURE = SOCKET_MAX;
+static const int LATENCY_ROW_MAX = (SOCKET_MAX + 1);
+
+/*
+ * log-linear buckets in us: 0 ~ 63 one each, above that 32 per power of two(~3% wide),
+ * up to 2^36 us.
+ */
+static const int LATENCY_SUB_BITS   = (5);
+static const int LATENCY_SUB_COUNT  = (1 << LATENCY_SUB_BITS);
+static const int LATENCY_BUCKET_MAX = (LATENCY_SUB_COUNT * 32);
+
+typedef struct _latencyHistogram_t
+{
+    unsigned int  count;
+    unsigned int  failures;
+    unsigned int  skips;        /* already programmed, not timed */
+    unsigned long minUs;
+    unsigned long maxUs;
+    unsigned long long sumUs;
+    unsigned int  bucket[LATENCY_BUCKET_MAX];
+} latencyHistogram_t;
+
+/* phaseUs[] of a phase the device took another path around */
+static const long LATENCY_PHASE_SKIPPED = (-2);
+
+#define PHASE_BIT(phase)    (1U << (phase))
+
+/* one socket of one cycle, filled by downloadProcess() */
+typedef struct _deviceReport_t
+{
+    int          result;                /* downloadProcess() return, 1: not run */
+    long         phaseUs[PHASE_MAX];    /* -1: phase not reached, LATENCY_PHASE_SKIPPED: not on this path */
+    unsigned int skipped;               /* PHASE_BIT()s the pre-scan found already programmed */
+    struct timespec start;              /* CLOCK_REALTIME, for the result log */
+    struct timespec end;
+    unsigned long   txBytes;            /* uart bytes of this device */
+    unsigned long   rxBytes;
+    unsigned int    generation;         /* image set of the cycle(hot reload) */
+} deviceReport_t;
+
+class LatencyStats
+{
+    public:
+        LatencyStats(void);
+        virtual ~LatencyStats(void);
+
+        void Record(int row, ePHASE phase, long us);
+        void RecordFailure(int row, ePHASE phase);
+        void RecordReport(int row, const deviceReport_t* report);
+
+        /* <basePath>.csv and <basePath>.json, rewritten on every dump */
+        int Dump(const char* basePath);
+
+        /* the .json dump to an open stream(control socket metrics) */
+        int DumpJson(FILE* out);
+
+        static const char* GetPhaseName(ePHASE phase);
+
+        /* phase a failed device stopped in, PHASE_MAX: did not fail */
+        static ePHASE GetFailedPhase(const deviceReport_t* report);
+
+    private:
+        latencyHistogram_t histogram[LATENCY_ROW_MAX][PHASE_MAX];
+        struct timespec    start;
+        pthread_mutex_t    statsMutex;  /* histogram, recorded by the cycle, dumped by SIGUSR1 and metrics */
+
+        static int getBucket(unsigned long us);
+        static unsigned long getBucketLow(int index);
+        static unsigned long getBucketHigh(int index);
+        unsigned long getPercentile(const latencyHistogram_t* h, double percentile);
+
+        /* statsMutex held */
+        void record(int row, ePHASE phase, long us);
+        void recordFailure(int row, ePHASE phase);
+        void recordReport(int row, const deviceReport_t* report);
+
+        int dumpCsv(FILE* out);
+        int dumpJson(FILE* out);
+};
+
+#endif // __LATENCYSTATS_H__
@@ -0,0 +1,175 @@
+#ifndef __MS500PROTOCOL_H__
+#define __MS500PROTOCOL_H__
+
+#include <cstddef>
+
+/* MS500 bootloader/uploader uart protocol, shared by ProcessController and the emulator */
+
+#pragma pack(push, 1)
+typedef struct _cmdPacketHeader_t
+{
+    unsigned char sync;         /* 0x57 */
+    unsigned char type;         /* packet type */
+    unsigned char reserved[2];  /* [0]: sector tag(windowed flash), [1]: flash flags */
+    unsigned int  param;        /* data address or eFuse type */
+    unsigned int  size[2];      /* [0]: data size, [1]: option size*/
+    unsigned int  crc;          /* verify */
+} cmdPacketHeader_t;
+#pragma pack(pop)
+
+#pragma pack(push, 1)
+typedef struct _response_t
+{
+    unsigned char ack;
+    unsigned char nak;
+    unsigned char reserved[2];  /* [0]: echoed sector tag(windowed flash), [1]: reserved */
+} response_t;
+#pragma pack(pop)
+
+typedef enum _eEFUSETYPE {
+    EFUSE_BOOT_SRC = 0,
+    EFUSE_SB_EN,
+    EFUSE_TYPE_UKEY_LOCK,
+    EFUSE_TYPE_PKF_LOCK,
+    EFUSE_TYPE_DUK_LOCK,
+	EFUSE_WRITE_PKF,
+    EFUSE_TYPE_UKEY,
+    EFUSE_TYPE_PKF,
+    EFUSE_TYPE_MAX
+} eEFUSETYPE;
+
+typedef enum _ePACKETTYPE {
+    PACKET_TYPE_SRAM        = 0x33,
+    PACKET_TYPE_EFUSE_WRITE = 0x22,
+    PACKET_TYPE_EFUSE_READ  = 0x11,
+    PACKET_TYPE_FLASH       = 0x55,
+    PACKET_TYPE_FLASH_SDB   = 0x66,
+    PACKET_TYPE_BAUDRATE    = 0x44,
+    PACKET_TYPE_PING        = 0x77,
+    PACKET_TYPE_EFUSE_BATCH = 0x88,
+    PACKET_TYPE_CRC         = 0x99,
+    PACKET_TYPE_FLASH_COMPRESSED = 0xAA,
+    PACKET_TYPE_FLASH_FILL  = 0xBB,
+    PACKET_TYPE_SDB_OPEN    = 0xCC,
+    PACKET_TYPE_SDB_CHUNK   = 0xDD
+} ePACKETTYPE;
+
+/*
+ * PACKET_TYPE_FLASH_COMPRESSED: PACKET_TYPE_FLASH with the sector as one LZ4 block(LZ4Block.h).
+ *  size[0]: compressed size, crc: the decompressed sector, param/size[1]/reserved[]: as PACKET_TYPE_FLASH
+ *  the uploader inflates into its FLASH_SECTOR_SIZE sector buffer, the decoded length is the
+ *  sector length. NAK: malformed block or crc mismatch
+ */
+
+/*
+ * PACKET_TYPE_FLASH_FILL: PACKET_TYPE_FLASH of a sector that is one byte throughout.
+ *  size[0]: sizeof(flashFill_t), payload: flashFill_t, crc: the filled sector,
+ *  param/size[1]/reserved[]: as PACKET_TYPE_FLASH. value 0xFF programs nothing, it only
+ *  carries the region erase(first sector) or the sector erase(FLASH_FLAG_SECTOR_ERASE)
+ */
+#pragma pack(push, 1)
+typedef struct _flashFill_t
+{
+    unsigned short length;      /* bytes from param, up to FLASH_SECTOR_SIZE */
+    unsigned char  value;
+    unsigned char  reserved;
+} flashFill_t;
+#pragma pack(pop)
+
+/*
+ * PACKET_TYPE_SDB_OPEN/PACKET_TYPE_SDB_CHUNK: an SDB entry streamed in sector sized chunks
+ * instead of one PACKET_TYPE_FLASH_SDB packet, the uploader never holds more than a chunk.
+ *  OPEN:  payload: the SDB info header, size[0]: SDB_INFO_HEADER_SIZE, size[1]: data size,
+ *         crc: payload. starts the entry over, one without data is stored right away
+ *  CHUNK: param: offset in the data, size[0]: chunk size(up to FLASH_SECTOR_SIZE),
+ *         size[1]: data size, crc: chunk, reserved[0]: sector tag(windowed) as PACKET_TYPE_FLASH.
+ *         taken in order only, the entry is stored with the last chunk
+ *  NAK: crc mismatch or a chunk that is not at the next offset. every chunk after a NAK is
+ *       NAKed as well until the next offset comes again, so the sender goes back to it
+ */
+
+/*
+ * PACKET_TYPE_CRC: CRC32 of what the device already holds, for the rework pre-scan and delta flashing.
+ *  reserved[0]: eCRCTARGET
+ *  CRC_TARGET_FLASH:   param: flash address, size[1]: length
+ *  CRC_TARGET_SDB:     payload: the SDB info header of the entry(path, option, datasize),
+ *                      size[0]: SDB_INFO_HEADER_SIZE, crc: payload. the CRC covers the data only
+ *  CRC_TARGET_SECTORS: param: flash address, size[1]: length, one CRC32 per FLASH_SECTOR_SIZE
+ *                      (the last one over what is left), up to FLASH_CRC_SECTOR_MAX
+ *  reply: response_t, an ack is followed by the CRC32(s). NAK: out of range or no such SDB entry
+ */
+typedef enum _eCRCTARGET {
+    CRC_TARGET_FLASH = 0,
+    CRC_TARGET_SDB,
+    CRC_TARGET_SECTORS
+} eCRCTARGET;
+
+/* PACKET_TYPE_FLASH reserved[1]: erase only this sector first, the region erase is not done */
+static const unsigned char FLASH_FLAG_SECTOR_ERASE = (0x01);
+
+/* addresses and sizes */
+static const unsigned int SRAM_BASE_ADDR        = (0x20000000);
+static const unsigned int FLASH_BASE_ADDR       = (0x30000000);
+static const unsigned int FLASH_SECTOR_SIZE     = (0x1000);
+static const unsigned int FLASH_CRC_SECTOR_MAX  = (64);
+
+/* uploader hello after the SRAM DONE packet */
+static const unsigned int UPLOADER_START_MESSAGE_SIZE = (10);
+
+/* uploader reverts to the previous rate if no ping arrives in time(ms) */
+static const int BAUDRATE_FALLBACK_MS = (200);
+
+/* uploader binary prefix */
+static const unsigned char UPLOADER_BINARY_PREFIX[4] = {
+    (unsigned char)('e'),
+    (unsigned char)('W'),
+    (unsigned char)('B'),
+    (unsigned char)('M')
+};
+
+#pragma pack(push, 1)
+typedef struct SDBInfoFile_t{
+    unsigned char path[128];
+    unsigned int  option;
+    unsigned int  datasize;
+    unsigned char data[1];
+} SDBInfoFile_t;
+#pragma pack(pop)
+
+/* sdb info header sent in front of the mapped sdb data */
+static const unsigned int SDB_INFO_HEADER_SIZE = offsetof(SDBInfoFile_t, data);
+
+/* eFuse read length */
+static const unsigned int eFuseLength[EFUSE_TYPE_MAX] = {1, 1, 1, 1, 1, 1, 32, 32};
+
+/*
+ * PACKET_TYPE_EFUSE_BATCH: several eFuse writes and one read-all in a single round trip.
+ *  param: entry count, size[0]: payload size, crc: payload
+ *  payload: entries of eFuseTlv_t + value(byte order of PACKET_TYPE_EFUSE_WRITE), applied in order
+ *  reply: response_t, an ack is followed by the eFuse image(every type in eEFUSETYPE order,
+ *         eFuseLength[] each) and the CRC32 of the image
+ */
+#pragma pack(push, 1)
+typedef struct _eFuseTlv_t
+{
+    unsigned char type;         /* eEFUSETYPE */
+    unsigned char length;       /* eFuseLength[type] */
+} eFuseTlv_t;
+#pragma pack(pop)
+
+static const unsigned int EFUSE_BATCH_MAX_SIZE = (EFUSE_TYPE_MAX * (sizeof(eFuseTlv_t) + 32));
+static const unsigned int EFUSE_IMAGE_SIZE     = (6 * 1 + 2 * 32);
+
+static inline unsigned int eFuseImageOffset(eEFUSETYPE type)
+{
+    unsigned int offset = 0;
+
+    for ( int i = EFUSE_BOOT_SRC; i < type; i++ )
+    {
+        offset += eFuseLength[i];
+    }
+
+    return offset;
+}
+
+#endif //__MS500PROTOCOL_H__
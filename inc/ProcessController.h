@@ -5,134 +5,145 @@
 
 #include "SerialComm.h"
 #include "GPIOControl.h"
-
-#pragma pack(push, 1)
-typedef struct _cmdPacketHeader_t
+#include "CustomThread.h"
+#include "MS500Protocol.h"
+#include "LatencyStats.h"
+#include "ResultLog.h"
+#include "ImageSet.h"
+#include "ImageWatcher.h"
+
+/* what starts a cycle: the power/start switches of the fixture, or the control socket */
+typedef enum _eCYCLETRIGGER {
+    CYCLE_TRIGGER_FIXTURE = 0,
+    CYCLE_TRIGGER_COMMAND
+} eCYCLETRIGGER;
+
+class ProcessController;
+
+typedef struct _downloadJob_t
 {
-    unsigned char sync;         /* 0x57 */
-    unsigned char type;         /* packet type */
-    unsigned char reserved[2];  /* reserved */
-    unsigned int  param;        /* data address or eFuse type */
-    unsigned int  size[2];      /* [0]: data size, [1]: option size*/
-    unsigned int  crc;          /* verify */
-} cmdPacketHeader_t;
-#pragma pack(pop)
-
-#pragma pack(push, 1)
-typedef struct _response_t
+    ProcessController* controller;
+    eSOCKETCHANNEL     ch;
+    SerialComm*        port;
+    int                result;
+} downloadJob_t;
+
+class DownloadWorker : public CustomThread
 {
-    unsigned char ack;
-    unsigned char nak;
-    unsigned char reserved[2];
-} response_t;
-#pragma pack(pop)
+    public:
+        virtual void customThread(void* param);
+};
 
-typedef enum _eFILETYPE
+/* HOTRELOAD: waits for the watched files to change and stages the new image set */
+class ReloadWorker : public CustomThread
 {
-    FILE_NAME_CONF = 0,
-    FILE_NAME_UPLOADER,
-    FILE_NAME_APPIMAGE,
-    FILE_NAME_SDBINFO
-} eFILETYPE;
-
-typedef enum _eEFUSETYPE {
-    EFUSE_BOOT_SRC = 0,
-    EFUSE_SB_EN,
-    EFUSE_TYPE_UKEY_LOCK,
-    EFUSE_TYPE_PKF_LOCK,
-    EFUSE_TYPE_DUK_LOCK,
-	EFUSE_WRITE_PKF,
-    EFUSE_TYPE_UKEY,
-    EFUSE_TYPE_PKF,
-    EFUSE_TYPE_MAX
-} eEFUSETYPE;
-
-typedef enum _ePACKETTYPE {
-    PACKET_TYPE_SRAM        = 0x33,
-    PACKET_TYPE_EFUSE_WRITE = 0x22,
-    PACKET_TYPE_EFUSE_READ  = 0x11,
-    PACKET_TYPE_FLASH       = 0x55,
-    PACKET_TYPE_FLASH_SDB   = 0x66
-} ePACKETTYPE;
+    public:
+        virtual void customThread(void* param);
+};
 
 class ProcessController
 {
+    friend class DownloadWorker;
+    friend class ReloadWorker;
+
     public:
-        ProcessController(const char* device, const int baudrate);
+        ProcessController(const char* device, const int baudrate, const char* gpioBackend = NULL);
         virtual ~ProcessController(void);
         int SetName(eFILETYPE type, const char* in);
         int ProcessInit(void);
-        int ProcessStart(void);
+        int ProcessStart(eCYCLETRIGGER trigger = CYCLE_TRIGGER_FIXTURE);
+        int DumpStats(void);
+
+        /* control socket, between cycles only: NULL keeps that file. 0: switched, 1: refused, the recipe in use stays, -1: none loaded */
+        int SwitchRecipe(const char* conf, const char* uploader, const char* image, const char* sdbInfo);
+        int WriteStatus(FILE* out);
+        int WriteMetrics(FILE* out);
 
     private:
         SerialComm*  comm = NULL;
         GPIOControl* gpio = NULL;
 
+        /* per socket uart topology of the set in use, none: all sockets share comm through the UART mux */
+        int          baudrate;
+        SerialComm*  socketComm[SOCKET_MAX];
+        int          parallelDownload;
+
+        /* conf, uploader, img, sdbinfo and plan: the recipe every set is loaded from */
         char* configFileName;
         char* uploaderFileName;
         char* appImageFileName;
         char* sdbInfoFileName;
         char* sdbImageFileName;
-
-        /* uploader file binary */
-        unsigned int   uploaderBinarySize;
-        unsigned char* uploaderBinary;
-
-        /* ini file binary */
-        unsigned char* sdbCodeBinary;
-        unsigned char* sdbCodePacket;
-        unsigned int   sdbCodeBinarySize;
-        unsigned int   sdbCodePacketSize;
-        unsigned char  sdbPath;
-
-        /* app image file binary */
-        int secureBootEnabled;
-        unsigned char* pkaBinary;
-        unsigned int   pkaBinarySize;
-        unsigned char* signatureBinary;
-        unsigned int   signatureBinarySize;
-        unsigned char* appCodeBinary;
-        unsigned int   appCodeBinarySize;
-        unsigned int   appImageTotalSize;
-
-        unsigned char  eFuseBootSource;
-        unsigned char  eFuseSecureBootEnable;
-		unsigned char  eFusePKfWrite;
-        unsigned char  eFuseUKeyLock;
-        unsigned char  eFusePKfLock;
-        unsigned char  eFuseDUKLock;
-        unsigned char  eFuseUKey[32];
-        unsigned char  eFusePKf[32];
-
-        int makeCmdHeader(ePACKETTYPE type, unsigned int param, unsigned char* in, unsigned int inSize, unsigned int optionSize, cmdPacketHeader_t* out);
-
-		void swapPkf(unsigned char* arr, int first, int second);
-        int keyStringTohexArray(eEFUSETYPE type, const char* keyValue);
-        int parseValue(eEFUSETYPE type, const char* keyValue);
-        int parseLine(const char* line);
-        int parseConfigFile(void);
-        int parseSdb(int index);
-
-        int openUploaderFile(void);
-
-        int checkImgFilePrefix(unsigned char* in);
-        int readSizeFromImgFile(unsigned int in, unsigned int* out);
-        int checkAppCodeBinarySize(unsigned int in);
-        int checkSdbCodeBinarySize(unsigned int in);
-        int checkAppImageTotalSize(unsigned int in, unsigned int in2);
-        int openAppImageFile(void);
-
-        int sendUploaderFile(void);
-
-        int sendNVMWrite(eEFUSETYPE type);
-        int sendNVMRead(eEFUSETYPE type, unsigned char* out, unsigned int* outLen);
-
-        int sendDataToFlash(const unsigned char* in, unsigned int inLen, unsigned int addr);
-        int sendSDBDataToFlash(const unsigned char* in, unsigned int inLen);
-        int sendAppImageFirmware(void);
-        int sendSdbInfo(void);
-
-        int downloadProcess(eSOCKETCHANNEL ch);
+        char* statsFileName;
+        char* resultFileName;
+        char* planFileName;
+
+        /* per phase latency, downloadProcess() fills report[ch], the cycle folds it into stats */
+        LatencyStats*  stats;
+        deviceReport_t report[SOCKET_MAX];
+
+        /* one record per socket per cycle, appended and flushed once a cycle */
+        ResultLog*     resultLog;
+        unsigned long  cycle;
+
+        /* the set the cycles run on, and a loaded one waiting for the next cycle(HOTRELOAD) */
+        ImageSet*      set;
+        ImageSet*      staged;
+        pthread_mutex_t reloadMutex;    /* set and staged: the swap vs status and staging */
+        pthread_mutex_t loadMutex;      /* one set is loaded at a time, it reads the recipe names and may compile the plan */
+
+        ImageWatcher*  watcher;
+        ReloadWorker   reloadWorker;
+        int            reloadStarted;
+        volatile int   reloadStop;
+
+        /* image sets loaded so far, every device record names the one it got */
+        unsigned int   generation;
+
+        /* fixture delays, the cycle reports how long it slept on purpose */
+        long            delayUs;
+        void settle(int ms);
+
+        /* edges of the current cycle, operator time is kept apart from machine time */
+        struct timespec readyEdge;
+        struct timespec startEdge;
+        struct timespec doneTime;
+        struct timespec removeEdge;
+
+        void resetReport(void);
+
+        ImageSet* loadSet(const char* conf, const char* uploader, const char* image, const char* sdbInfo);
+        void swapSet(ImageSet* next);
+        int armWatcher(void);
+        int stageReload(void);
+        void applyReload(void);
+
+        int sendUploaderFile(SerialComm* port);
+        int sendPing(SerialComm* port);
+        int sendUploaderBaudrate(SerialComm* port);
+
+        int getNVMValue(eEFUSETYPE type, unsigned char* out);
+        int getNVMWriteData(eEFUSETYPE type, unsigned char* out);
+        int sendNVMWrite(SerialComm* port, eEFUSETYPE type);
+        int sendNVMRead(SerialComm* port, eEFUSETYPE type, unsigned char* out, unsigned int* outLen);
+        int sendNVMBatch(SerialComm* port, const eEFUSETYPE* types, int count, unsigned char* image);
+        int sendNVMLocks(SerialComm* port, deviceReport_t* report, struct timespec* mark);
+        int sendUKey(SerialComm* port);
+        int sendPKf(SerialComm* port);
+        int sendCrcQuery(SerialComm* port, eCRCTARGET target, unsigned int addr, unsigned int length, const unsigned char* info, unsigned int* crc);
+        int scanDevice(SerialComm* port, deviceReport_t* report, unsigned int* sdbSkip);
+
+        int diffSectors(SerialComm* port, const sectorTable_t* table, unsigned char* dirty, unsigned int* dirtyCount);
+        int sendDataToFlash(SerialComm* port, const sectorTable_t* table);
+        int sendSDBDataToFlash(SerialComm* port, const unsigned char* info, unsigned int infoLen, const unsigned char* in, unsigned int inLen, unsigned int crc);
+        int sendAppImageFirmware(SerialComm* port);
+        int sendSdbInfo(SerialComm* port, unsigned int skip);
+        int streamSDBDataToFlash(SerialComm* port, const unsigned char* info, unsigned int infoLen, const unsigned char* in, unsigned int inLen);
+
+        int downloadProcess(eSOCKETCHANNEL ch, SerialComm* port);
+        int downloadDevice(eSOCKETCHANNEL ch, SerialComm* port);
+        int downloadSerial(void);
+        int downloadParallel(void);
 };
 
 #endif //__PROCESSCONTROLLER_H__
\ No newline at end of file
@@ -0,0 +1,34 @@
+#ifndef __RESULTLOG_H__
+#define __RESULTLOG_H__
+
+#include <cstdio>
+#include <pthread.h>
+
+#include "LatencyStats.h"
+
+/* records kept in the stdio buffer before they hit the file, flushed at least once per cycle */
+static const int RESULT_LOG_BUFFER_SIZE = (64 * 1024);
+
+/*
+ * production result log, one CSV record per socket per cycle, appended to the file.
+ * a new or empty file gets the column header first, so several runs share one log.
+ */
+class ResultLog
+{
+    public:
+        ResultLog(void);
+        virtual ~ResultLog(void);
+
+        int Open(const char* path);
+        int Close(void);
+        int Write(unsigned long cycle, int socket, const deviceReport_t* report);
+        int Flush(void);
+
+    private:
+        FILE*           file;
+        pthread_mutex_t mutex;
+
+        void writeTime(const struct timespec* ts);
+};
+
+#endif // __RESULTLOG_H__
@@ -1,6 +1,14 @@
 #ifndef __SERIALCOMM_H__
 #define __SERIALCOMM_H__
 
+#include <sys/uio.h>
+
+/* timeout(ms) used when the caller does not give a deadline, negative: wait forever */
+static const int SERIAL_TIMEOUT_DEFAULT_MS = 10000;
+
+/* max segments of one SendV() */
+static const int SERIAL_IOV_MAX = 8;
+
 class SerialComm
 {
     public:
@@ -10,14 +18,34 @@ class SerialComm
         int Open(void);
         int Close(void);
         int Flush(void);
-        int Send(const unsigned char* in, unsigned int inLen);
-        int Receive(unsigned char *out, unsigned int outLen);
+        int Send(const unsigned char* in, unsigned int inLen, int timeoutMs = SERIAL_TIMEOUT_DEFAULT_MS);
+        int SendV(const struct iovec* iov, int iovcnt, int timeoutMs = SERIAL_TIMEOUT_DEFAULT_MS);
+        int Receive(unsigned char *out, unsigned int outLen, int timeoutMs = SERIAL_TIMEOUT_DEFAULT_MS);
         int GetReceiveSize(void);
+        int GetTransferTimeMs(unsigned int len);
+        int SetBaudrate(const int baudrate);
+        static int IsSupportedBaudrate(const int baudrate);
+        unsigned long GetWriteCalls(void);
+        unsigned long GetReadCalls(void);
+        unsigned long GetTxBytes(void);
+        unsigned long GetRxBytes(void);
 
     private:
         char* device;
         int   fd;
         int   baudrate;
+        int   stale;    /* I/O error, reopen on the next Open() */
+
+        /* syscall counters, write()/writev() and read() */
+        unsigned long writeCalls;
+        unsigned long readCalls;
+
+        /* bytes moved since the port was created */
+        unsigned long txBytes;
+        unsigned long rxBytes;
+
+        int configure(void);
+        int waitReady(short events, int timeoutMs);
 };
 
 #endif // __SERIALCOMM_H__
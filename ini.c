@@ -27,9 +27,17 @@
 
 #include "ini.h"
 
+typedef struct {
+  const char *name;
+  char *start;      /* first string after the header */
+  char *end;        /* next header or the end of data */
+} ini_section_t;
+
 struct ini_t {
   char *data;
   char *end;
+  ini_section_t *sections;    /* sorted by name, same names in file order */
+  int section_count;
 };
 
 
@@ -173,6 +181,68 @@ static void split_data(ini_t *ini) {
 
 
 
+/* Orders sections by name, then by position so a repeated section keeps
+ * the file order */
+static int section_cmp(const void *a, const void *b) {
+  const ini_section_t *x = (const ini_section_t*)a;
+  const ini_section_t *y = (const ini_section_t*)b;
+  int d = strcmpci(x->name, y->name);
+  if (d != 0) {
+    return d;
+  }
+  return (x->start < y->start) ? -1 : (x->start > y->start);
+}
+
+
+/* Builds the section index so a lookup only scans the keys of its own
+ * section. Keys before the first header form the section "". Without the
+ * index (out of memory) ini_get() scans the whole data as before */
+static void index_sections(ini_t *ini) {
+  int count = 1;
+  int i = 0;
+  char *p = ini->data;
+
+  if (*p == '\0') {
+    p = next(ini, p);
+  }
+  while (p < ini->end) {
+    if (*p == '[') {
+      count++;
+    } else {
+      p = next(ini, p);
+    }
+    p = next(ini, p);
+  }
+
+  ini->sections = (ini_section_t*)malloc(count * sizeof(ini_section_t));
+  if (!ini->sections) {
+    return;
+  }
+
+  p = ini->data;
+  if (*p == '\0') {
+    p = next(ini, p);
+  }
+  ini->sections[0].name = "";
+  ini->sections[0].start = p;
+  while (p < ini->end) {
+    if (*p == '[') {
+      ini->sections[i].end = p;
+      i++;
+      ini->sections[i].name = p + 1;
+      ini->sections[i].start = next(ini, p);
+    } else {
+      p = next(ini, p);
+    }
+    p = next(ini, p);
+  }
+  ini->sections[i].end = ini->end;
+  ini->section_count = count;
+
+  qsort(ini->sections, count, sizeof(ini_section_t), section_cmp);
+}
+
+
 ini_t* ini_load(const char *filename) {
   ini_t *ini = NULL;
   FILE *fp = NULL;
@@ -207,6 +277,7 @@ ini_t* ini_load(const char *filename) {
 
   /* Prepare data */
   split_data(ini);
+  index_sections(ini);
 
   /* Clean up and return */
   fclose(fp);
@@ -220,6 +291,7 @@ fail:
 
 
 void ini_free(ini_t *ini) {
+  free(ini->sections);
   free(ini->data);
   free(ini);
 }
@@ -230,6 +302,32 @@ const char* ini_get(ini_t *ini, const char *section, const char *key) {
   char *val;
   char *p = ini->data;
 
+  if (section && ini->sections) {
+    /* First section of that name, then each repeat of it in file order */
+    int lo = 0;
+    int hi = ini->section_count;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (strcmpci(ini->sections[mid].name, section) < 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+
+    for (; lo < ini->section_count && !strcmpci(ini->sections[lo].name, section); lo++) {
+      p = ini->sections[lo].start;
+      while (p < ini->sections[lo].end) {
+        val = next(ini, p);
+        if (!strcmpci(p, key)) {
+          return val;
+        }
+        p = next(ini, val);
+      }
+    }
+    return NULL;
+  }
+
   if (*p == '\0') {
     p = next(ini, p);
   }
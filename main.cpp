@@ -8,11 +8,14 @@
 #include <fcntl.h>
 #include <termios.h>
 #include <time.h>
+#include <signal.h>
 #include <sys/ioctl.h>
 #include <linux/types.h>
 
 #include "ProcessController.h"
+#include "ControlServer.h"
 #include "GPIOControl.h"
+#include "CustomThread.h"
 
 #include "debug.h"
 
@@ -22,9 +25,14 @@ static char configFileName[128]   = "/home/pi/setting.cfg";
 static char uploaderFileName[128] = "/home/pi/uploader.bin";
 static char appImageFileName[128] = "/home/pi/test.img";
 static char sdbInfoFileName[128]  = "/home/pi/sdbinfo.ini";
+static char gpioBackendName[32]  = "";
+static char statsFileName[128]   = "/home/pi/latency";
+static char resultFileName[128]  = "/home/pi/result.csv";
+static char planFileName[128]    = "/home/pi/download.plan";
+static char controlSocketName[108] = "";
 static void gpio_test(void)
 {
-    GPIOControl gpio;
+    GPIOControl gpio(gpioBackendName);
 
     gpio.GPIOTest();
 
@@ -33,12 +41,17 @@ static void gpio_test(void)
 
 static void print_usage(const char *prog)
 {
-    fprintf(stdout, "Usage: %s [-bdcuag]\n", prog);
+    fprintf(stdout, "Usage: %s [-bdcuaGsrpDg]\n", prog);
     fprintf(stdout, "  -b --baudrate uart baudrate       (default %d)\n", baudrate);
     fprintf(stdout, "  -d --device   serial device name  (default %s)\n", serialDeviceName);
     fprintf(stdout, "  -c --config   config file name    (default %s)\n", configFileName);
     fprintf(stdout, "  -u --uploader uploader file name  (default %s)\n", uploaderFileName);
     fprintf(stdout, "  -a --appimage app image file name (default %s)\n", appImageFileName);
+    fprintf(stdout, "  -G --gpio     gpio backend        (wiringpi, gpiod, sim, default: build)\n");
+    fprintf(stdout, "  -s --stats    latency dump, .csv/.json at exit and on SIGUSR1 (default %s)\n", statsFileName);
+    fprintf(stdout, "  -r --result   per device result log, CSV appended every cycle (default %s)\n", resultFileName);
+    fprintf(stdout, "  -p --plan     download plan cache, rebuilt when an input changes, \"\" disables (default %s)\n", planFileName);
+    fprintf(stdout, "  -D --daemon   control socket, cycles start on request instead of the start switch (default: off)\n");
     fprintf(stdout, "  -g --gpiotest\n");
     exit(1);
 }
@@ -53,11 +66,16 @@ static void parse_opts(int argc, char *argv[])
             { "config",   required_argument, 0, 'c' },
             { "uploader", required_argument, 0, 'u' },
             { "appimage", required_argument, 0, 'a' },
+            { "gpio",     required_argument, 0, 'G' },
+            { "stats",    required_argument, 0, 's' },
+            { "result",   required_argument, 0, 'r' },
+            { "plan",     required_argument, 0, 'p' },
+            { "daemon",   required_argument, 0, 'D' },
             { "gpiotest", no_argument,       0, 'g' },
             { 0, 0, 0, 0 },
         };
 
-        c = getopt_long(argc, argv, "d:b:c:u:a:g", lopts, NULL);
+        c = getopt_long(argc, argv, "d:b:c:u:a:G:s:r:p:D:g", lopts, NULL);
 
         if ( c == -1 )
         {
@@ -100,6 +118,41 @@ static void parse_opts(int argc, char *argv[])
                 }
                 break;
 
+            case 'G':
+                {
+                    memset(gpioBackendName, 0x00, sizeof(gpioBackendName));
+                    strncpy(gpioBackendName, optarg, sizeof(gpioBackendName) - 1);
+                }
+                break;
+
+            case 's':
+                {
+                    memset(statsFileName, 0x00, sizeof(statsFileName));
+                    strncpy(statsFileName, optarg, sizeof(statsFileName) - 1);
+                }
+                break;
+
+            case 'r':
+                {
+                    memset(resultFileName, 0x00, sizeof(resultFileName));
+                    strncpy(resultFileName, optarg, sizeof(resultFileName) - 1);
+                }
+                break;
+
+            case 'p':
+                {
+                    memset(planFileName, 0x00, sizeof(planFileName));
+                    strncpy(planFileName, optarg, sizeof(planFileName) - 1);
+                }
+                break;
+
+            case 'D':
+                {
+                    memset(controlSocketName, 0x00, sizeof(controlSocketName));
+                    strncpy(controlSocketName, optarg, sizeof(controlSocketName) - 1);
+                }
+                break;
+
             case 'g':
                 {
                     gpio_test();
@@ -115,6 +168,43 @@ static void parse_opts(int argc, char *argv[])
     }
 }
 
+/*
+ * SIGUSR1 dumps the latency stats, SIGINT/SIGTERM dump them and terminate as before.
+ * the signals are blocked in every thread and taken here with sigwait(), so the dump runs
+ * in a normal thread context instead of a handler.
+ */
+class SignalWorker : public CustomThread
+{
+    public:
+        virtual void customThread(void* param);
+};
+
+static sigset_t signalSet;
+
+void SignalWorker::customThread(void* param)
+{
+    ProcessController* processController = (ProcessController*)param;
+    int                sig = 0;
+
+    while ( 1 )
+    {
+        if ( sigwait(&signalSet, &sig) != 0 )
+        {
+            continue;
+        }
+
+        DBG_LOG("signal %d, latency dump", sig);
+        processController->DumpStats();
+
+        if ( sig != SIGUSR1 )
+        {
+            signal(sig, SIG_DFL);
+            pthread_sigmask(SIG_UNBLOCK, &signalSet, NULL);
+            raise(sig);
+        }
+    }
+}
+
 time_t     currentTime;
 struct tm* currentTimeStruct;
 void timestamping(FILE* file)
@@ -142,6 +232,13 @@ int main(int argc, char* argv[])
 
     parse_opts(argc, argv);
 
+    /* before any thread exists, so they all inherit the mask */
+    sigemptyset(&signalSet);
+    sigaddset(&signalSet, SIGUSR1);
+    sigaddset(&signalSet, SIGINT);
+    sigaddset(&signalSet, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signalSet, NULL);
+
 #ifdef __MP_DEBUG_BUILD__
     DBG_LOG("%s %s", __DATE__, __TIME__);
     DBG_LOG("Start upload");
@@ -153,10 +250,15 @@ int main(int argc, char* argv[])
     DBG_LOG(" uploader | %s", uploaderFileName);
     DBG_LOG(" appimage | %s", appImageFileName);
 	DBG_LOG("  sdbinfo | %s", sdbInfoFileName);
+    DBG_LOG("    stats | %s", statsFileName);
+    DBG_LOG("   result | %s", resultFileName);
+    DBG_LOG("     plan | %s", planFileName);
+    DBG_LOG("   daemon | %s", (controlSocketName[0] != '\0') ? controlSocketName : "off");
+    DBG_LOG("     gpio | %s", (gpioBackendName[0] != '\0') ? gpioBackendName : "default");
     DBG_LOG("----------+-----------------");
 #endif
 
-    ProcessController* processController = new ProcessController(serialDeviceName, baudrate);
+    ProcessController* processController = new ProcessController(serialDeviceName, baudrate, gpioBackendName);
 
 
     ret = processController->SetName(FILE_NAME_CONF, configFileName);
@@ -187,6 +289,44 @@ int main(int argc, char* argv[])
         return -1;
     }
 
+    if ( statsFileName[0] != '\0' )
+    {
+        ret = processController->SetName(FILE_NAME_STATS, statsFileName);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+    }
+
+    if ( resultFileName[0] != '\0' )
+    {
+        ret = processController->SetName(FILE_NAME_RESULT, resultFileName);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+    }
+
+    if ( planFileName[0] != '\0' )
+    {
+        ret = processController->SetName(FILE_NAME_PLAN, planFileName);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+    }
+
+    SignalWorker signalWorker;
+    ret = signalWorker.ThreadStart(processController);
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
     ret = processController->ProcessInit();
     if ( ret < 0 )
     {
@@ -194,6 +334,32 @@ int main(int argc, char* argv[])
         return -1;
     }
 
+    /* daemon: the images stay loaded, the control socket starts the cycles and switches recipes */
+    if ( controlSocketName[0] != '\0' )
+    {
+        ControlServer* controlServer = new ControlServer(processController);
+
+        ret = controlServer->Open(controlSocketName);
+        if ( ret == 0 )
+        {
+            ret = controlServer->Run();
+        }
+        delete controlServer;
+        controlServer = NULL;
+
+        delete processController;
+        processController = NULL;
+
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+
+        DBG_LOG("daemon done.");
+
+        return 1;
+    }
 
 #ifdef __TEST10000__
     char  logFileName[128] = {0,};
@@ -239,6 +405,7 @@ int main(int argc, char* argv[])
         if ( ret < 0 )
         {
             DBG_ERR("error!!!");
+            processController->DumpStats();
             return -1;
         }
     } while ( 1 );
@@ -1,6 +1,12 @@
+#include <cstring>
+#include <cstdint>
+
 #include "CRC32.h"
 
-static const unsigned int crc32Table[] = {
+#include "debug.h"
+
+/* reference table, byte-at-a-time */
+static constexpr unsigned int crc32Table[256] = {
     0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
     0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
     0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
@@ -46,15 +52,223 @@ static const unsigned int crc32Table[] = {
     0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
-unsigned int CRC32::CalcCRC32(const unsigned char *buf, unsigned int size, unsigned int crc)
+/* slice-by-N tables, crc32Slice.t[0] is crc32Table */
+typedef struct _crc32SliceTable_t {
+    unsigned int t[16][256];
+} crc32SliceTable_t;
+
+static constexpr crc32SliceTable_t makeSliceTable(void)
+{
+    crc32SliceTable_t out {};
+
+    for ( unsigned int i = 0; i < 256; i++ )
+    {
+        unsigned int c = i;
+        for ( int k = 0; k < 8; k++ )
+        {
+            c = (c & 1) ? ((c >> 1) ^ 0xEDB88320U) : (c >> 1);
+        }
+        out.t[0][i] = c;
+    }
+
+    for ( int s = 1; s < 16; s++ )
+    {
+        for ( unsigned int i = 0; i < 256; i++ )
+        {
+            out.t[s][i] = (out.t[s - 1][i] >> 8) ^ out.t[0][out.t[s - 1][i] & 0xFF];
+        }
+    }
+
+    return out;
+}
+
+static constexpr crc32SliceTable_t crc32Slice = makeSliceTable();
+
+static constexpr bool checkSliceTable(void)
+{
+    for ( unsigned int i = 0; i < 256; i++ )
+    {
+        if ( crc32Slice.t[0][i] != crc32Table[i] )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static constexpr unsigned int calcCRC32Const(const char* in, unsigned int size)
+{
+    unsigned int crc = ~0U;
+
+    for ( unsigned int i = 0; i < size; i++ )
+    {
+        crc = crc32Table[(crc ^ (unsigned char)in[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ ~0U;
+}
+
+/* generated tables must be bit-exact with the reference, check value of "123456789" */
+static_assert(checkSliceTable(), "crc32 slice table does not match crc32Table");
+static_assert(calcCRC32Const("123456789", 9) == 0xCBF43926U, "crc32 check value mismatch");
+
+static inline unsigned int load32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+unsigned int CRC32::calcSlice8(const unsigned char* p, unsigned int size, unsigned int crc)
+{
+    const unsigned int (*t)[256] = crc32Slice.t;
+
+    while ( size >= 8 )
+    {
+        unsigned int a = load32(p) ^ crc;
+        unsigned int b = load32(p + 4);
+
+        crc = t[7][a & 0xFF] ^ t[6][(a >> 8) & 0xFF] ^ t[5][(a >> 16) & 0xFF] ^ t[4][a >> 24]
+            ^ t[3][b & 0xFF] ^ t[2][(b >> 8) & 0xFF] ^ t[1][(b >> 16) & 0xFF] ^ t[0][b >> 24];
+
+        p    += 8;
+        size -= 8;
+    }
+
+    while ( size-- )
+    {
+        crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+unsigned int CRC32::calcSlice16(const unsigned char* p, unsigned int size, unsigned int crc)
+{
+    const unsigned int (*t)[256] = crc32Slice.t;
+
+    while ( size >= 16 )
+    {
+        unsigned int a = load32(p) ^ crc;
+        unsigned int b = load32(p + 4);
+        unsigned int c = load32(p + 8);
+        unsigned int d = load32(p + 12);
+
+        crc = t[15][a & 0xFF] ^ t[14][(a >> 8) & 0xFF] ^ t[13][(a >> 16) & 0xFF] ^ t[12][a >> 24]
+            ^ t[11][b & 0xFF] ^ t[10][(b >> 8) & 0xFF] ^ t[ 9][(b >> 16) & 0xFF] ^ t[ 8][b >> 24]
+            ^ t[ 7][c & 0xFF] ^ t[ 6][(c >> 8) & 0xFF] ^ t[ 5][(c >> 16) & 0xFF] ^ t[ 4][c >> 24]
+            ^ t[ 3][d & 0xFF] ^ t[ 2][(d >> 8) & 0xFF] ^ t[ 1][(d >> 16) & 0xFF] ^ t[ 0][d >> 24];
+
+        p    += 16;
+        size -= 16;
+    }
+
+    return calcSlice8(p, size, crc);
+}
+
+/* kernel picked once at load time, before any download thread runs */
+CRC32::calcFunc_t CRC32::kernel = CRC32::selectKernel();
+
+/* start offsets 0 ~ CHECK_ALIGN_MAX - 1 against every word alignment and the unrolled loop entry */
+static const unsigned int CHECK_ALIGN_MAX  = (16);
+static const unsigned int CHECK_LENGTHS[]  = { 64, 127, 128, 129, 255, 256, 257, 600, 4095, 4096, 4099 };
+static const unsigned int CHECK_LENGTH_MAX = (4099);
+
+/*
+ * 1: calc matches the byte table bit for bit over every length 0 ~ 63 and the lengths above,
+ * at each start offset, seeded with ~0 and with a running crc. covers the block loops and the tails.
+ */
+int CRC32::selfCheck(calcFunc_t calc)
 {
-    const unsigned char *p;
+    static unsigned char buffer[CHECK_ALIGN_MAX + CHECK_LENGTH_MAX];
+    unsigned int         x = 0x2545F491U;
+
+    for ( unsigned int i = 0; i < sizeof(buffer); i++ )
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buffer[i] = (unsigned char)x;
+    }
+
+    const unsigned int lengthCount = 64 + sizeof(CHECK_LENGTHS) / sizeof(CHECK_LENGTHS[0]);
+    for ( unsigned int offset = 0; offset < CHECK_ALIGN_MAX; offset++ )
+    {
+        for ( unsigned int n = 0; n < lengthCount; n++ )
+        {
+            unsigned int size = (n < 64) ? n : CHECK_LENGTHS[n - 64];
+            unsigned int seed = (n & 1) ? ~0U : (0x9E3779B9U * (offset + 1));
+
+            if ( calc(buffer + offset, size, seed) != calcRef(buffer + offset, size, seed) )
+            {
+                DBG_ERR("crc32 kernel mismatch at offset %u, %u bytes, not used", offset, size);
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+CRC32::calcFunc_t CRC32::selectKernel(void)
+{
+#if !defined(__BYTE_ORDER__) || (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+    /* slicing loads words little endian */
+    return calcRef;
+#endif
+
+    /* the fastest kernel the cpu has that agrees with the reference, the byte table otherwise */
+    if ( armSupported() && selfCheck(calcArm) )
+    {
+        return calcArm;
+    }
 
-    p = (unsigned char *)buf;
-    crc = crc ^ ~0U;
+    if ( selfCheck(calcSlice16) )
+    {
+        return calcSlice16;
+    }
 
+    if ( selfCheck(calcSlice8) )
+    {
+        return calcSlice8;
+    }
+
+    return calcRef;
+}
+
+unsigned int CRC32::calcRef(const unsigned char* p, unsigned int size, unsigned int crc)
+{
     while (size--)
         crc = crc32Table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
 
-    return crc ^ ~0U;
+    return crc;
+}
+
+unsigned int CRC32::CalcCRC32Ref(const unsigned char *buf, unsigned int size, unsigned int crc)
+{
+    return calcRef(buf, size, crc ^ ~0U) ^ ~0U;
+}
+
+unsigned int CRC32::CalcCRC32(const unsigned char *buf, unsigned int size, unsigned int crc)
+{
+    return kernel(buf, size, crc ^ ~0U) ^ ~0U;
+}
+
+const char* CRC32::GetKernelName(void)
+{
+    if ( kernel == calcArm )
+    {
+        return "armv8 crc32";
+    }
+    else
+    if ( kernel == calcSlice16 )
+    {
+        return "slice-by-16";
+    }
+    else
+    if ( kernel == calcSlice8 )
+    {
+        return "slice-by-8";
+    }
+
+    return "table";
 }
@@ -0,0 +1,81 @@
+#include <cstring>
+#include <cstdint>
+
+#include "CRC32.h"
+
+/*
+ * built with -march=armv8-a+crc (Makefile CRC32_HW), the rest of the program keeps
+ * the toolchain default, so this code only runs once armSupported() said so.
+ */
+#if defined(__ARM_FEATURE_CRC32)
+
+#include <arm_acle.h>
+#include <sys/auxv.h>
+
+#if defined(__aarch64__)
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32     (1 << 7)
+#endif
+#else
+#ifndef HWCAP2_CRC32
+#define HWCAP2_CRC32    (1 << 4)
+#endif
+#endif
+
+int CRC32::armSupported(void)
+{
+#if defined(__aarch64__)
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) ? 1 : 0;
+#else
+    return (getauxval(AT_HWCAP2) & HWCAP2_CRC32) ? 1 : 0;
+#endif
+}
+
+unsigned int CRC32::calcArm(const unsigned char* p, unsigned int size, unsigned int crc)
+{
+    /* align so the doubleword loads are naturally aligned */
+    while ( size > 0 && ((uintptr_t)p & 7) != 0 )
+    {
+        crc = __crc32b(crc, *p++);
+        size--;
+    }
+
+    while ( size >= 8 )
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        crc = __crc32d(crc, v);
+        p    += 8;
+        size -= 8;
+    }
+
+    if ( size >= 4 )
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        crc = __crc32w(crc, v);
+        p    += 4;
+        size -= 4;
+    }
+
+    while ( size-- )
+    {
+        crc = __crc32b(crc, *p++);
+    }
+
+    return crc;
+}
+
+#else
+
+int CRC32::armSupported(void)
+{
+    return 0;
+}
+
+unsigned int CRC32::calcArm(const unsigned char* p, unsigned int size, unsigned int crc)
+{
+    return calcRef(p, size, crc);
+}
+
+#endif
@@ -0,0 +1,539 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "ControlServer.h"
+
+#include "debug.h"
+
+static const char* const controlHelp =
+    "start\n"
+    "status\n"
+    "recipe [conf=<path>] [uploader=<path>] [image=<path>] [sdbinfo=<path>]\n"
+    "metrics\n"
+    "shutdown\n";
+
+void CycleWorker::customThread(void* param)
+{
+    ControlServer* server = (ControlServer*)param;
+
+    server->runCycle();
+}
+
+void RecipeWorker::customThread(void* param)
+{
+    ControlServer* server = (ControlServer*)param;
+
+    server->runRecipe();
+}
+
+ControlServer::ControlServer(ProcessController* controller)
+{
+    this->controller = controller;
+    memset(path, 0x00, sizeof(path));
+    listenFd = -1;
+    for ( int i = 0; i < CONTROL_CLIENT_MAX; i++ )
+    {
+        client[i].fd      = -1;
+        client[i].lineLen = 0;
+    }
+
+    pthread_mutex_init(&mutex, NULL);
+    running        = 0;
+    joinable       = 0;
+    lastResult     = 1;
+    loading        = 0;
+    loaderJoinable = 0;
+    lastRecipe     = 1;
+    ready          = 1;     /* the caller ran ProcessInit() */
+    quit           = 0;
+
+    memset(recipeArgs, 0x00, sizeof(recipeArgs));
+    for ( int i = 0; i < RECIPE_KEY_MAX; i++ )
+    {
+        recipe[i] = NULL;
+    }
+}
+
+ControlServer::~ControlServer(void)
+{
+    Close();
+    pthread_mutex_destroy(&mutex);
+}
+
+int ControlServer::Open(const char* path)
+{
+    struct sockaddr_un addr;
+
+    if ( path == NULL || path[0] == '\0' || strlen(path) >= sizeof(addr.sun_path) )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    Close();
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if ( listenFd < 0 )
+    {
+        DBG_ERR("socket error(%d)", errno);
+        return -1;
+    }
+
+    memset(&addr, 0x00, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    /* a socket file left by a killed daemon */
+    unlink(path);
+
+    /* owner only: a request flashes devices and switches recipes. set before listen(), no connect gets in first */
+    if ( bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || chmod(path, CONTROL_SOCKET_MODE) != 0 || listen(listenFd, CONTROL_CLIENT_MAX) != 0 )
+    {
+        DBG_ERR("%s bind error(%d)", path, errno);
+        close(listenFd);
+        listenFd = -1;
+        unlink(path);
+        return -1;
+    }
+    strncpy(this->path, path, sizeof(this->path) - 1);
+
+    DBG_LOG("control socket %s", path);
+
+    return 0;
+}
+
+int ControlServer::Close(void)
+{
+    reap();
+
+    for ( int i = 0; i < CONTROL_CLIENT_MAX; i++ )
+    {
+        closeClient(&client[i]);
+    }
+
+    if ( listenFd >= 0 )
+    {
+        close(listenFd);
+        listenFd = -1;
+        unlink(path);
+        memset(path, 0x00, sizeof(path));
+    }
+
+    return 0;
+}
+
+/* until shutdown, the running cycle is waited for */
+int ControlServer::Run(void)
+{
+    struct pollfd fds[1 + CONTROL_CLIENT_MAX];
+
+    if ( listenFd < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    quit = 0;
+    while ( quit == 0 )
+    {
+        fds[0].fd     = listenFd;
+        fds[0].events = POLLIN;
+        for ( int i = 0; i < CONTROL_CLIENT_MAX; i++ )
+        {
+            fds[1 + i].fd     = client[i].fd;     /* -1 is ignored by poll() */
+            fds[1 + i].events = POLLIN;
+        }
+
+        int ret = poll(fds, 1 + CONTROL_CLIENT_MAX, -1);
+        if ( ret < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            DBG_ERR("poll error(%d)", errno);
+            return -1;
+        }
+
+        for ( int i = 0; i < CONTROL_CLIENT_MAX; i++ )
+        {
+            if ( (client[i].fd >= 0) && (fds[1 + i].revents != 0) && (receive(&client[i]) != 0) )
+            {
+                closeClient(&client[i]);
+            }
+        }
+
+        if ( (fds[0].revents & POLLIN) != 0 )
+        {
+            acceptClient();
+        }
+    }
+
+    reap();
+
+    return 0;
+}
+
+void ControlServer::runCycle(void)
+{
+    int ret = controller->ProcessStart(CYCLE_TRIGGER_COMMAND);
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+    }
+
+    pthread_mutex_lock(&mutex);
+    lastResult = ret;
+    running    = 0;
+    pthread_mutex_unlock(&mutex);
+}
+
+/* the images load with loadMutex held, status and metrics never wait for it */
+void ControlServer::runRecipe(void)
+{
+    int ret = controller->SwitchRecipe(recipe[RECIPE_CONF], recipe[RECIPE_UPLOADER], recipe[RECIPE_IMAGE], recipe[RECIPE_SDBINFO]);
+    if ( ret != 0 )
+    {
+        DBG_ERR("error!!!");
+    }
+
+    pthread_mutex_lock(&mutex);
+    lastRecipe = ret;
+    if ( ret < 0 )
+    {
+        ready = 0;
+    }
+    else
+    if ( ret == 0 )
+    {
+        ready = 1;
+    }
+    loading = 0;
+    pthread_mutex_unlock(&mutex);
+}
+
+/* a cycle or a recipe load is on its thread */
+int ControlServer::isBusy(void)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&mutex);
+    ret = (running != 0) || (loading != 0);
+    pthread_mutex_unlock(&mutex);
+
+    return ret;
+}
+
+/* joins the last cycle and recipe load, blocks while they still run */
+void ControlServer::reap(void)
+{
+    if ( joinable != 0 )
+    {
+        worker.ThreadJoin();
+        joinable = 0;
+    }
+
+    if ( loaderJoinable != 0 )
+    {
+        loader.ThreadJoin();
+        loaderJoinable = 0;
+    }
+}
+
+void ControlServer::acceptClient(void)
+{
+    int fd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC);
+    if ( fd < 0 )
+    {
+        DBG_ERR("accept error(%d)", errno);
+        return;
+    }
+
+    for ( int i = 0; i < CONTROL_CLIENT_MAX; i++ )
+    {
+        if ( client[i].fd < 0 )
+        {
+            client[i].fd      = fd;
+            client[i].lineLen = 0;
+            return;
+        }
+    }
+
+    reply(fd, NULL, 0, "error busy");
+    close(fd);
+}
+
+void ControlServer::closeClient(controlClient_t* c)
+{
+    if ( c->fd >= 0 )
+    {
+        close(c->fd);
+        c->fd = -1;
+    }
+    c->lineLen = 0;
+}
+
+/* every complete line is handled, 0: keep the client, -1: closed or broken */
+int ControlServer::receive(controlClient_t* c)
+{
+    ssize_t readBytes = recv(c->fd, c->line + c->lineLen, sizeof(c->line) - 1 - c->lineLen, 0);
+    if ( readBytes <= 0 )
+    {
+        return ((readBytes < 0) && (errno == EINTR)) ? 0 : -1;
+    }
+    c->lineLen += readBytes;
+
+    char*        line  = c->line;
+    unsigned int count = c->lineLen;
+    char*        end   = NULL;
+    while ( (end = (char*)memchr(line, '\n', count)) != NULL )
+    {
+        *end = '\0';
+        if ( (end > line) && (end[-1] == '\r') )
+        {
+            end[-1] = '\0';
+        }
+
+        if ( handleLine(c->fd, line) < 0 )
+        {
+            return -1;
+        }
+
+        count -= (unsigned int)(end + 1 - line);
+        line   = end + 1;
+    }
+    memmove(c->line, line, count);
+    c->lineLen = count;
+
+    if ( c->lineLen >= sizeof(c->line) - 1 )
+    {
+        reply(c->fd, NULL, 0, "error line too long");
+        return -1;
+    }
+
+    return 0;
+}
+
+int ControlServer::handleLine(int fd, char* line)
+{
+    char*       body    = NULL;
+    size_t      bodyLen = 0;
+    const char* error   = NULL;
+    int         ret     = 0;
+
+    char* args    = NULL;
+    char* command = strtok_r(line, " \t", &args);
+    if ( command == NULL )
+    {
+        return 0;
+    }
+
+    FILE* out = open_memstream(&body, &bodyLen);
+    if ( out == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    if ( !strcmp(command, "start") )
+    {
+        handleStart(&error);
+    }
+    else
+    if ( !strcmp(command, "status") )
+    {
+        handleStatus(out, &error);
+    }
+    else
+    if ( !strcmp(command, "recipe") )
+    {
+        handleRecipe(args, &error);
+    }
+    else
+    if ( !strcmp(command, "metrics") )
+    {
+        if ( controller->WriteMetrics(out) < 0 )
+        {
+            error = "error metrics";
+        }
+    }
+    else
+    if ( !strcmp(command, "shutdown") )
+    {
+        quit = 1;
+    }
+    else
+    if ( !strcmp(command, "help") )
+    {
+        fputs(controlHelp, out);
+    }
+    else
+    {
+        error = "error unknown command";
+    }
+    fclose(out);
+
+    ret = reply(fd, body, bodyLen, (error != NULL) ? error : "ok");
+    free(body);
+
+    return ret;
+}
+
+int ControlServer::handleStart(const char** error)
+{
+    if ( isBusy() != 0 )
+    {
+        *error = "error busy";
+        return -1;
+    }
+    reap();
+
+    /* the loader is reaped, ready no longer changes */
+    if ( ready == 0 )
+    {
+        *error = "error no recipe";
+        return -1;
+    }
+
+    running = 1;
+    if ( worker.ThreadStart(this, true) < 0 )
+    {
+        running = 0;
+        *error = "error thread";
+        return -1;
+    }
+    joinable = 1;
+
+    return 0;
+}
+
+int ControlServer::handleStatus(FILE* out, const char** error)
+{
+    pthread_mutex_lock(&mutex);
+    fprintf(out, "state %s\n", (running != 0) ? "running" : ((loading != 0) ? "loading" : ((ready != 0) ? "idle" : "norecipe")));
+    fprintf(out, "last %d\n", lastResult);
+    fprintf(out, "load %d\n", lastRecipe);
+    pthread_mutex_unlock(&mutex);
+
+    if ( controller->WriteStatus(out) < 0 )
+    {
+        *error = "error status";
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * the keys are checked here, the load runs on the loader like a cycle on the worker.
+ * status shows "state loading", then "load": 0 loaded, 1 refused(the recipe in use stays),
+ * -1 nothing usable loaded(start refused until a recipe loads).
+ */
+int ControlServer::handleRecipe(char* args, const char** error)
+{
+    char* save = NULL;
+
+    if ( isBusy() != 0 )
+    {
+        *error = "error busy";
+        return -1;
+    }
+    reap();
+
+    /* the client line buffer is reused by the next request, the loader keeps a copy */
+    memset(recipeArgs, 0x00, sizeof(recipeArgs));
+    if ( args != NULL )
+    {
+        strncpy(recipeArgs, args, sizeof(recipeArgs) - 1);
+    }
+    for ( int i = 0; i < RECIPE_KEY_MAX; i++ )
+    {
+        recipe[i] = NULL;
+    }
+
+    for ( char* arg = strtok_r(recipeArgs, " \t", &save); arg != NULL; arg = strtok_r(NULL, " \t", &save) )
+    {
+        char* value = strchr(arg, '=');
+        if ( value == NULL )
+        {
+            *error = "error recipe key=path";
+            return -1;
+        }
+        *value++ = '\0';
+
+        if ( !strcmp(arg, "conf") )
+        {
+            recipe[RECIPE_CONF] = value;
+        }
+        else
+        if ( !strcmp(arg, "uploader") )
+        {
+            recipe[RECIPE_UPLOADER] = value;
+        }
+        else
+        if ( !strcmp(arg, "image") )
+        {
+            recipe[RECIPE_IMAGE] = value;
+        }
+        else
+        if ( !strcmp(arg, "sdbinfo") )
+        {
+            recipe[RECIPE_SDBINFO] = value;
+        }
+        else
+        {
+            *error = "error recipe key";
+            return -1;
+        }
+    }
+
+    pthread_mutex_lock(&mutex);
+    loading = 1;
+    pthread_mutex_unlock(&mutex);
+    if ( loader.ThreadStart(this, true) < 0 )
+    {
+        pthread_mutex_lock(&mutex);
+        loading = 0;
+        pthread_mutex_unlock(&mutex);
+        *error = "error thread";
+        return -1;
+    }
+    loaderJoinable = 1;
+
+    return 0;
+}
+
+/* a client that went away is not an error of the server */
+int ControlServer::reply(int fd, const char* body, size_t bodyLen, const char* result)
+{
+    const char* part[]    = { body, result, "\n" };
+    size_t      partLen[] = { bodyLen, strlen(result), 1 };
+
+    for ( int i = 0; i < 3; i++ )
+    {
+        size_t sent = 0;
+        while ( (part[i] != NULL) && (sent < partLen[i]) )
+        {
+            ssize_t ret = send(fd, part[i] + sent, partLen[i] - sent, MSG_NOSIGNAL);
+            if ( ret < 0 )
+            {
+                if ( errno == EINTR )
+                {
+                    continue;
+                }
+                return -1;
+            }
+            sent += ret;
+        }
+    }
+
+    return 0;
+}
@@ -5,28 +5,69 @@
 
 #include "CustomThread.h"
 
+CustomThread::CustomThread(void): threadParam(NULL), joinable(false)
+{
+}
+
+CustomThread::~CustomThread(void)
+{
+}
+
 void *CustomThread::GetThreadParam(void)
 {
     return threadParam;
 }
 
-int CustomThread::ThreadStart(void* threadParam)
+int CustomThread::ThreadStart(void* threadParam, bool joinable)
 {
     int ret;
-    pthread_t threads;
     this->threadParam = threadParam;
-    ret = pthread_create(&threads, NULL, &(CustomThread::threadRun), (void*)this);
-    if ( ret < 0 )
+    this->joinable    = false;
+    ret = pthread_create(&thread, NULL, &(CustomThread::threadRun), (void*)this);
+    if ( ret != 0 )
     {
         fprintf(stderr, "pthread_create error(0x%02X)\r\n", ret);
         ret = -1;
         return ret;
     }
-    ret = pthread_detach(threads);
-    if ( ret < 0 )
+
+    /* joinable threads are reaped by ThreadJoin() */
+    if ( joinable )
+    {
+        this->joinable = true;
+        return 0;
+    }
+
+    ret = pthread_detach(thread);
+    if ( ret != 0 )
     {
         fprintf(stderr, "pthread_detach error(0x%02X)\r\n", ret);
         ret = -1;
         return ret;
     }
+
+    return 0;
+}
+
+int CustomThread::ThreadJoin(void)
+{
+    int ret;
+
+    if ( !joinable )
+    {
+        fprintf(stderr, "pthread_join error(not joinable)\r\n");
+        ret = -1;
+        return ret;
+    }
+
+    ret = pthread_join(thread, NULL);
+    joinable = false;
+    if ( ret != 0 )
+    {
+        fprintf(stderr, "pthread_join error(0x%02X)\r\n", ret);
+        ret = -1;
+        return ret;
+    }
+
+    return 0;
 }
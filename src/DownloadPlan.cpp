@@ -0,0 +1,307 @@
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "CRC32.h"
+#include "DownloadPlan.h"
+
+#include "debug.h"
+
+static const unsigned int PLAN_ALIGN = (8);
+
+DownloadPlan::DownloadPlan(void)
+{
+    file       = new ImageFile();
+    out        = NULL;
+    offset     = 0;
+    inputCount = 0;
+    memset(path, 0x00, sizeof(path));
+    memset(tempPath, 0x00, sizeof(tempPath));
+    memset(input, 0x00, sizeof(input));
+}
+
+DownloadPlan::~DownloadPlan(void)
+{
+    Abort();
+
+    if ( file != NULL )
+    {
+        delete file;
+        file = NULL;
+    }
+}
+
+/* size, modification time and inode: cheap, tells a changed input without reading it */
+int DownloadPlan::statInput(const char* path, planInput_t* out)
+{
+    struct stat st;
+
+    memset(out, 0x00, sizeof(planInput_t));
+    if ( path == NULL || strlen(path) >= sizeof(out->path) )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+    strncpy(out->path, path, sizeof(out->path) - 1);
+
+    if ( stat(path, &st) != 0 )
+    {
+        return -1;
+    }
+
+    out->size    = (unsigned long long)st.st_size;
+    out->mtimeNs = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    out->ino     = (unsigned long long)st.st_ino;
+
+    return 0;
+}
+
+/* a file replaced with the same size and mtime(cp -p, a restore) is only told by its content */
+int DownloadPlan::crcInput(planInput_t* io)
+{
+    ImageFile content;
+
+    if ( content.Open(io->path) < 0 )
+    {
+        return -1;
+    }
+    io->crc = CRC32::CalcCRC32(content.GetData(), content.GetSize());
+
+    return 0;
+}
+
+int DownloadPlan::Load(const char* path, const char* const* inputs, int inputCount)
+{
+    int ret = -1;
+
+    if ( path == NULL || inputs == NULL || inputCount <= 0 || inputCount > PLAN_INPUT_MAX )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    Close();
+
+    if ( access(path, R_OK) != 0 )
+    {
+        DBG_LOG("plan %s: none", path);
+        return 1;
+    }
+
+    ret = file->Open(path);
+    if ( ret < 0 || file->GetSize() < sizeof(planHeader_t) )
+    {
+        DBG_LOG("plan %s: unreadable", path);
+        Close();
+        return 1;
+    }
+
+    const planHeader_t* header = (const planHeader_t*)file->GetData();
+    if ( memcmp(header->magic, PLAN_MAGIC, sizeof(PLAN_MAGIC)) != 0 || header->version != PLAN_VERSION
+      || header->size != file->GetSize() || header->inputCount < (unsigned int)inputCount
+      || header->inputCount > PLAN_INPUT_MAX
+      || GetRange(header->inputOffset, header->inputCount * sizeof(planInput_t)) == NULL )
+    {
+        DBG_LOG("plan %s: another version or truncated", path);
+        Close();
+        return 1;
+    }
+
+    /* the fixed inputs must be the files named now, the rest(SDB data) are what the plan recorded */
+    const planInput_t* recorded = (const planInput_t*)(file->GetData() + header->inputOffset);
+    planInput_t        current;
+    unsigned int       key = 0;
+    for ( unsigned int i = 0; i < header->inputCount; i++ )
+    {
+        if ( ((int)i < inputCount) && (strncmp(recorded[i].path, inputs[i], sizeof(recorded[i].path)) != 0) )
+        {
+            DBG_LOG("plan %s: input %s, built for %s", path, inputs[i], recorded[i].path);
+            Close();
+            return 1;
+        }
+
+        if ( statInput(recorded[i].path, &current) < 0 )
+        {
+            DBG_LOG("plan %s: input %s gone", path, recorded[i].path);
+            Close();
+            return 1;
+        }
+
+        if ( current.size != recorded[i].size || current.mtimeNs != recorded[i].mtimeNs || current.ino != recorded[i].ino )
+        {
+            DBG_LOG("plan %s: input %s changed", path, recorded[i].path);
+            Close();
+            return 1;
+        }
+
+        if ( crcInput(&current) < 0 || current.crc != recorded[i].crc )
+        {
+            DBG_LOG("plan %s: input %s content changed", path, recorded[i].path);
+            Close();
+            return 1;
+        }
+        key = CRC32::CalcCRC32((const unsigned char*)&current, sizeof(current), key);
+    }
+
+    if ( key != header->key )
+    {
+        DBG_LOG("plan %s: inputs changed", path);
+        Close();
+        return 1;
+    }
+
+    return 0;
+}
+
+int DownloadPlan::Close(void)
+{
+    return file->Close();
+}
+
+const planHeader_t* DownloadPlan::GetHeader(void)
+{
+    if ( file->GetSize() < sizeof(planHeader_t) )
+    {
+        return NULL;
+    }
+
+    return (const planHeader_t*)file->GetData();
+}
+
+/* a truncated or corrupt plan must never point a table past the mapping */
+const unsigned char* DownloadPlan::GetRange(unsigned int offset, unsigned long long len)
+{
+    if ( offset == 0 || offset >= file->GetSize() || len > (unsigned long long)(file->GetSize() - offset) )
+    {
+        return NULL;
+    }
+
+    return file->GetData() + offset;
+}
+
+int DownloadPlan::Create(const char* path)
+{
+    if ( path == NULL || strlen(path) + 5 > sizeof(this->path) )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    Abort();
+
+    strncpy(this->path, path, sizeof(this->path) - 1);
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    out = fopen(tempPath, "wb");
+    if ( out == NULL )
+    {
+        DBG_ERR("%s open error", tempPath);
+        return -1;
+    }
+
+    /* the header is written last, once every offset is known */
+    planHeader_t header;
+    memset(&header, 0x00, sizeof(header));
+    fwrite(&header, sizeof(header), 1, out);
+    offset     = sizeof(header);
+    inputCount = 0;
+
+    return 0;
+}
+
+int DownloadPlan::AddInput(const char* path)
+{
+    if ( out == NULL || inputCount >= PLAN_INPUT_MAX )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    if ( statInput(path, &input[inputCount]) < 0 || crcInput(&input[inputCount]) < 0 )
+    {
+        DBG_ERR("%s stat error", path);
+        return -1;
+    }
+    inputCount++;
+
+    return 0;
+}
+
+unsigned int DownloadPlan::Append(const void* in, unsigned int inLen)
+{
+    static const unsigned char pad[PLAN_ALIGN] = {0,};
+
+    if ( out == NULL || in == NULL || inLen == 0 )
+    {
+        return 0;
+    }
+
+    if ( (offset % PLAN_ALIGN) != 0 )
+    {
+        unsigned int padLen = PLAN_ALIGN - (offset % PLAN_ALIGN);
+        fwrite(pad, 1, padLen, out);
+        offset += padLen;
+    }
+
+    unsigned int start = offset;
+    fwrite(in, 1, inLen, out);
+    offset += inLen;
+
+    return start;
+}
+
+int DownloadPlan::Commit(planHeader_t* header)
+{
+    if ( out == NULL || header == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    memcpy(header->magic, PLAN_MAGIC, sizeof(PLAN_MAGIC));
+    header->version     = PLAN_VERSION;
+    header->inputCount  = inputCount;
+    header->inputOffset = Append(input, inputCount * sizeof(planInput_t));
+    header->key         = 0;
+    for ( int i = 0; i < inputCount; i++ )
+    {
+        header->key = CRC32::CalcCRC32((const unsigned char*)&input[i], sizeof(planInput_t), header->key);
+    }
+    header->size = offset;
+
+    fseek(out, 0, SEEK_SET);
+    fwrite(header, sizeof(planHeader_t), 1, out);
+    fflush(out);
+
+    /* a power cut leaves the old plan or the whole new one, never half of it */
+    if ( ferror(out) != 0 || fsync(fileno(out)) != 0 )
+    {
+        DBG_ERR("%s write error", tempPath);
+        Abort();
+        return -1;
+    }
+
+    fclose(out);
+    out = NULL;
+
+    if ( rename(tempPath, path) != 0 )
+    {
+        DBG_ERR("%s rename error", path);
+        unlink(tempPath);
+        return -1;
+    }
+
+    return 0;
+}
+
+void DownloadPlan::Abort(void)
+{
+    if ( out != NULL )
+    {
+        fclose(out);
+        out = NULL;
+        unlink(tempPath);
+    }
+}
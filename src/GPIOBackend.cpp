@@ -0,0 +1,206 @@
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "GPIOBackend.h"
+
+#include "debug.h"
+
+#if defined(__GPIO_WIRINGPI__)
+static const char GPIO_BACKEND_DEFAULT[] = "wiringpi";
+#elif defined(__GPIO_LIBGPIOD__)
+static const char GPIO_BACKEND_DEFAULT[] = "gpiod";
+#else
+static const char GPIO_BACKEND_DEFAULT[] = "sim";
+#endif
+
+/* poll period of backends without an edge source */
+static const int GPIO_POLL_PERIOD_US = (1000);
+
+GPIOBackend* GPIOBackend::Create(const char* name)
+{
+    if ( name == NULL || name[0] == '\0' )
+    {
+        name = GPIO_BACKEND_DEFAULT;
+    }
+
+#ifdef __GPIO_WIRINGPI__
+    if ( strcmp(name, "wiringpi") == 0 )
+    {
+        return new GPIOBackendWiringPi();
+    }
+#endif
+
+#ifdef __GPIO_LIBGPIOD__
+    if ( strcmp(name, "gpiod") == 0 )
+    {
+        return new GPIOBackendGpiod();
+    }
+#endif
+
+    if ( strcmp(name, "sim") == 0 )
+    {
+        return new GPIOBackendSim();
+    }
+
+    DBG_ERR("gpio backend %s is not built in", name);
+    return NULL;
+}
+
+int GPIOBackend::WaitEvent(int /* pin */, int timeoutMs, struct timespec* /* edge */)
+{
+    if ( timeoutMs == 0 )
+    {
+        return 0;
+    }
+
+    if ( (timeoutMs > 0) && (timeoutMs * 1000 < GPIO_POLL_PERIOD_US) )
+    {
+        usleep(timeoutMs * 1000);
+    }
+    else
+    {
+        usleep(GPIO_POLL_PERIOD_US);
+    }
+
+    return 0;
+}
+
+GPIOBackendSim::GPIOBackendSim(void)
+{
+    for ( int i = 0; i < GPIO_PIN_MAX; i++ )
+    {
+        dir[i]   = GPIO_DIR_IN;
+        pull[i]  = GPIO_PULL_OFF;
+        value[i] = 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    eventCount   = 0;
+    eventDropped = 0;
+}
+
+int GPIOBackendSim::Init(void)
+{
+    return 0;
+}
+
+int GPIOBackendSim::SetMode(int pin, eGPIODIR dir, eGPIOPULL pull)
+{
+    if ( pin < 0 || pin >= GPIO_PIN_MAX )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    this->dir[pin]  = dir;
+    this->pull[pin] = pull;
+
+    if ( dir == GPIO_DIR_IN )
+    {
+        value[pin] = (pull == GPIO_PULL_UP) ? 0 : 1;
+    }
+
+    return 0;
+}
+
+int GPIOBackendSim::Write(int pin, int value)
+{
+    if ( pin < 0 || pin >= GPIO_PIN_MAX || dir[pin] != GPIO_DIR_OUT )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    this->value[pin] = (value != 0) ? 1 : 0;
+
+    if ( eventCount < GPIO_SIM_EVENT_MAX )
+    {
+        clock_gettime(CLOCK_MONOTONIC, &event[eventCount].time);
+        event[eventCount].pin   = (short)pin;
+        event[eventCount].value = (short)this->value[pin];
+        eventCount++;
+    }
+    else
+    {
+        eventDropped++;
+    }
+
+    return 0;
+}
+
+int GPIOBackendSim::Read(int pin)
+{
+    if ( pin < 0 || pin >= GPIO_PIN_MAX )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    return value[pin];
+}
+
+int GPIOBackendSim::WaitEvent(int pin, int timeoutMs, struct timespec* edge)
+{
+    if ( pin < 0 || pin >= GPIO_PIN_MAX || dir[pin] != GPIO_DIR_IN )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    if ( timeoutMs == 0 )
+    {
+        return 0;
+    }
+
+    /* a debounce window is shorter than the operator reaction, nothing happens in it */
+    if ( (timeoutMs > 0) && (timeoutMs < GPIO_SIM_REACTION_MS) )
+    {
+        usleep(timeoutMs * 1000);
+        return 0;
+    }
+
+    usleep(GPIO_SIM_REACTION_MS * 1000);
+
+    value[pin] = !value[pin];
+    if ( edge != NULL )
+    {
+        clock_gettime(CLOCK_MONOTONIC, edge);
+    }
+
+    return 1;
+}
+
+const char* GPIOBackendSim::GetName(void)
+{
+    return "sim";
+}
+
+/* pin timeline since the last dump, ms from the previous dump(or start) */
+int GPIOBackendSim::DumpTimeline(FILE* out)
+{
+    if ( out == NULL )
+    {
+        out = stdout;
+    }
+
+    fprintf(out, "[GPIO timeline] %d events", eventCount);
+    if ( eventDropped > 0 )
+    {
+        fprintf(out, ", %d dropped", eventDropped);
+    }
+    fprintf(out, "\n");
+
+    for ( int i = 0; i < eventCount; i++ )
+    {
+        long us = (event[i].time.tv_sec - start.tv_sec) * 1000000L + (event[i].time.tv_nsec - start.tv_nsec) / 1000;
+        fprintf(out, "%8ld.%03ld ms  GPIO#%02d %d\n", us / 1000, us % 1000, event[i].pin, event[i].value);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    eventCount   = 0;
+    eventDropped = 0;
+
+    return 0;
+}
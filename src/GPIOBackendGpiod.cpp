@@ -0,0 +1,197 @@
+#include "GPIOBackend.h"
+
+#ifdef __GPIO_LIBGPIOD__
+
+#include <cerrno>
+
+#include <gpiod.h>
+
+#include "debug.h"
+
+/* BCM pins of the 40 pin header */
+static const char GPIOD_CHIP_NAME[]  = "gpiochip0";
+static const char GPIOD_CONSUMER[]   = "MS500MultiDownload";
+
+GPIOBackendGpiod::GPIOBackendGpiod(void)
+{
+    chip = NULL;
+    for ( int i = 0; i < GPIO_PIN_MAX; i++ )
+    {
+        line[i] = NULL;
+        dir[i]  = GPIO_DIR_IN;
+    }
+}
+
+GPIOBackendGpiod::~GPIOBackendGpiod(void)
+{
+    for ( int i = 0; i < GPIO_PIN_MAX; i++ )
+    {
+        if ( line[i] != NULL )
+        {
+            gpiod_line_release(line[i]);
+            line[i] = NULL;
+        }
+    }
+
+    if ( chip != NULL )
+    {
+        gpiod_chip_close(chip);
+        chip = NULL;
+    }
+}
+
+int GPIOBackendGpiod::Init(void)
+{
+    if ( chip != NULL )
+    {
+        return 0;
+    }
+
+    chip = gpiod_chip_open_by_name(GPIOD_CHIP_NAME);
+    if ( chip == NULL )
+    {
+        DBG_ERR("%s open error", GPIOD_CHIP_NAME);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* a line is requested once per direction, re-requested only when the direction changes */
+int GPIOBackendGpiod::SetMode(int pin, eGPIODIR dir, eGPIOPULL pull)
+{
+    int ret = -1;
+
+    if ( chip == NULL || pin < 0 || pin >= GPIO_PIN_MAX )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    if ( line[pin] != NULL )
+    {
+        if ( this->dir[pin] == dir )
+        {
+            return 0;
+        }
+        gpiod_line_release(line[pin]);
+        line[pin] = NULL;
+    }
+
+    struct gpiod_line* l = gpiod_chip_get_line(chip, pin);
+    if ( l == NULL )
+    {
+        DBG_ERR("line %d error", pin);
+        return -1;
+    }
+
+    if ( dir == GPIO_DIR_OUT )
+    {
+        ret = gpiod_line_request_output(l, GPIOD_CONSUMER, 0);
+    }
+    else
+    {
+        int flags = 0;
+        if ( pull == GPIO_PULL_UP )
+        {
+            flags = GPIOD_LINE_REQUEST_FLAG_BIAS_PULL_UP;
+        }
+        else
+        if ( pull == GPIO_PULL_DOWN )
+        {
+            flags = GPIOD_LINE_REQUEST_FLAG_BIAS_PULL_DOWN;
+        }
+        /* inputs are requested with edge events so WaitEvent() sleeps in the kernel */
+        ret = gpiod_line_request_both_edges_events_flags(l, GPIOD_CONSUMER, flags);
+    }
+    if ( ret < 0 )
+    {
+        DBG_ERR("line %d request error", pin);
+        return -1;
+    }
+
+    line[pin]      = l;
+    this->dir[pin] = dir;
+
+    return 0;
+}
+
+int GPIOBackendGpiod::Write(int pin, int value)
+{
+    if ( pin < 0 || pin >= GPIO_PIN_MAX || line[pin] == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    return (gpiod_line_set_value(line[pin], (value != 0) ? 1 : 0) < 0) ? -1 : 0;
+}
+
+int GPIOBackendGpiod::Read(int pin)
+{
+    if ( pin < 0 || pin >= GPIO_PIN_MAX || line[pin] == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    return gpiod_line_get_value(line[pin]);
+}
+
+int GPIOBackendGpiod::WaitEvent(int pin, int timeoutMs, struct timespec* edge)
+{
+    struct gpiod_line_event event;
+    struct timespec         timeout;
+    int                     ret = -1;
+
+    if ( pin < 0 || pin >= GPIO_PIN_MAX || line[pin] == NULL || dir[pin] != GPIO_DIR_IN )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    /* no gpiod timeout means forever, a day is close enough between two operator actions */
+    if ( timeoutMs < 0 )
+    {
+        timeoutMs = 24 * 60 * 60 * 1000;
+    }
+    timeout.tv_sec  = timeoutMs / 1000;
+    timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+
+    do
+    {
+        ret = gpiod_line_event_wait(line[pin], &timeout);
+    } while ( (ret < 0) && (errno == EINTR) );
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    if ( ret == 0 )
+    {
+        return 0;
+    }
+
+    /* the kernel stamp is CLOCK_REALTIME before linux 5.7, stamp on wakeup instead */
+    if ( edge != NULL )
+    {
+        clock_gettime(CLOCK_MONOTONIC, edge);
+    }
+
+    ret = gpiod_line_event_read(line[pin], &event);
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    return 1;
+}
+
+const char* GPIOBackendGpiod::GetName(void)
+{
+    return "gpiod";
+}
+
+#endif /* __GPIO_LIBGPIOD__ */
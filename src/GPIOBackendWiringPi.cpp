@@ -0,0 +1,181 @@
+#include "GPIOBackend.h"
+
+#ifdef __GPIO_WIRINGPI__
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include <wiringPi.h>
+
+#include "debug.h"
+
+static const char GPIO_SYSFS_PATH[] = "/sys/class/gpio";
+
+static int writeSysfs(const char* path, const char* value)
+{
+    int fd = open(path, O_WRONLY);
+    if ( fd < 0 )
+    {
+        return -1;
+    }
+
+    int ret = write(fd, value, strlen(value));
+    close(fd);
+
+    return (ret < 0) ? -1 : 0;
+}
+
+GPIOBackendWiringPi::GPIOBackendWiringPi(void)
+{
+    for ( int i = 0; i < GPIO_PIN_MAX; i++ )
+    {
+        valueFd[i] = -1;
+    }
+}
+
+GPIOBackendWiringPi::~GPIOBackendWiringPi(void)
+{
+    for ( int i = 0; i < GPIO_PIN_MAX; i++ )
+    {
+        if ( valueFd[i] >= 0 )
+        {
+            close(valueFd[i]);
+            valueFd[i] = -1;
+        }
+    }
+}
+
+int GPIOBackendWiringPi::Init(void)
+{
+    /* BCM numbering */
+    wiringPiSetupGpio();
+
+    return 0;
+}
+
+int GPIOBackendWiringPi::SetMode(int pin, eGPIODIR dir, eGPIOPULL pull)
+{
+    pinMode(pin, (dir == GPIO_DIR_OUT) ? OUTPUT : INPUT);
+
+    if ( dir == GPIO_DIR_IN )
+    {
+        pullUpDnControl(pin, (pull == GPIO_PULL_UP) ? PUD_UP : ((pull == GPIO_PULL_DOWN) ? PUD_DOWN : PUD_OFF));
+    }
+
+    return 0;
+}
+
+int GPIOBackendWiringPi::Write(int pin, int value)
+{
+    digitalWrite(pin, (value != 0) ? HIGH : LOW);
+
+    return 0;
+}
+
+int GPIOBackendWiringPi::Read(int pin)
+{
+    return digitalRead(pin);
+}
+
+const char* GPIOBackendWiringPi::GetName(void)
+{
+    return "wiringpi";
+}
+
+/*
+ * same edge source as wiringPiISR(): export the pin, edge "both" and poll(POLLPRI) the value
+ * file. kernels that number the sysfs gpios from another base(or dropped sysfs) fall back
+ * to polling digitalRead().
+ */
+int GPIOBackendWiringPi::openEdge(int pin)
+{
+    char path[64];
+    char value[8];
+
+    snprintf(value, sizeof(value), "%d", pin);
+    snprintf(path, sizeof(path), "%s/gpio%d/value", GPIO_SYSFS_PATH, pin);
+    if ( access(path, F_OK) != 0 )
+    {
+        snprintf(path, sizeof(path), "%s/export", GPIO_SYSFS_PATH);
+        writeSysfs(path, value);
+    }
+
+    snprintf(path, sizeof(path), "%s/gpio%d/edge", GPIO_SYSFS_PATH, pin);
+    if ( writeSysfs(path, "both") < 0 )
+    {
+        DBG_LOG("GPIO#%02d no sysfs edge, polled", pin);
+        return -2;
+    }
+
+    snprintf(path, sizeof(path), "%s/gpio%d/value", GPIO_SYSFS_PATH, pin);
+    int fd = open(path, O_RDONLY);
+    if ( fd < 0 )
+    {
+        DBG_LOG("GPIO#%02d no sysfs value, polled", pin);
+        return -2;
+    }
+
+    /* the first read clears the pending POLLPRI */
+    read(fd, value, sizeof(value));
+
+    return fd;
+}
+
+int GPIOBackendWiringPi::WaitEvent(int pin, int timeoutMs, struct timespec* edge)
+{
+    struct pollfd pfd;
+    char          value[8];
+    int           ret = -1;
+
+    if ( pin < 0 || pin >= GPIO_PIN_MAX )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    if ( valueFd[pin] == -1 )
+    {
+        valueFd[pin] = openEdge(pin);
+    }
+
+    if ( valueFd[pin] < 0 )
+    {
+        return GPIOBackend::WaitEvent(pin, timeoutMs, edge);
+    }
+
+    pfd.fd      = valueFd[pin];
+    pfd.events  = POLLPRI | POLLERR;
+    pfd.revents = 0;
+
+    do
+    {
+        ret = poll(&pfd, 1, timeoutMs);
+    } while ( (ret < 0) && (errno == EINTR) );
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    if ( ret == 0 )
+    {
+        return 0;
+    }
+
+    if ( edge != NULL )
+    {
+        clock_gettime(CLOCK_MONOTONIC, edge);
+    }
+
+    lseek(pfd.fd, 0, SEEK_SET);
+    read(pfd.fd, value, sizeof(value));
+
+    return 1;
+}
+
+#endif /* __GPIO_WIRINGPI__ */
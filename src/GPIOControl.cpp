@@ -1,8 +1,6 @@
 #include <cstdio>
 #include <unistd.h>
 
-#include <wiringPi.h>
-
 #include "GPIOControl.h"
 
 #include "debug.h"
@@ -68,38 +66,38 @@ static const int pinNumber[GPIOPINNAME_MAX] = {
 //    33
 };
 
-static const int pinDir[GPIOPINNAME_MAX] = {
-    OUTPUT,
-    OUTPUT,
-    INPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-    OUTPUT,
-//    OUTPUT,
-    INPUT
-//    OUTPUT,
-//    OUTPUT
+static const eGPIODIR pinDir[GPIOPINNAME_MAX] = {
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_IN,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+    GPIO_DIR_OUT,
+//    GPIO_DIR_OUT,
+    GPIO_DIR_IN
+//    GPIO_DIR_OUT,
+//    GPIO_DIR_OUT
 };
 
 static const int pinDefaultValue[GPIOPINNAME_MAX] = {
     GPIO_RESET,
     GPIO_RESET,
-    PUD_DOWN,
+    GPIO_PULL_DOWN,
     GPIO_RESET,
     GPIO_SET,
     GPIO_SET,
@@ -119,18 +117,35 @@ static const int pinDefaultValue[GPIOPINNAME_MAX] = {
     GPIO_SET,
     GPIO_SET,
 //    GPIO_SET,
-    PUD_UP
+    GPIO_PULL_UP
 //    GPIO_RESET,
 //    GPIO_RESET
 };
 
-GPIOControl::GPIOControl(void)
+GPIOControl::GPIOControl(const char* backendName)
 {
     int ret = -1;
 
     enabledSocket = SOCKET_MAX;
+    debounceMs    = 0;
+    timing        = TIMING_PROFILE_DEFAULT;
+    delayUs       = 0;
 
-    wiringPiSetupGpio();
+    backend = GPIOBackend::Create(backendName);
+    if ( backend == NULL )
+    {
+        DBG_ERR("error!!!");
+        return;
+    }
+
+    ret = backend->Init();
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+        delete backend;
+        backend = NULL;
+        return;
+    }
 
     ret = gpioInit();
     if ( ret < 0 )
@@ -143,13 +158,34 @@ GPIOControl::~GPIOControl(void)
 {
     int ret = -1;
 
-    ret = gpioInit();
-    if ( ret < 0 )
+    if ( backend != NULL )
     {
-        DBG_ERR("error!!!");
+        ret = gpioInit();
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+        }
+
+        delete backend;
+        backend = NULL;
     }
 }
 
+const char* GPIOControl::GetBackendName(void)
+{
+    return (backend != NULL) ? backend->GetName() : NULL;
+}
+
+int GPIOControl::DumpTimeline(FILE* out)
+{
+    if ( backend == NULL )
+    {
+        return -1;
+    }
+
+    return backend->DumpTimeline(out);
+}
+
 int GPIOControl::gpioDump(void)
 {
 #ifdef __MP_DEBUG_BUILD__
@@ -161,7 +197,7 @@ int GPIOControl::gpioDump(void)
     fprintf(stdout, "\n");
     for ( int i = 0; i < GPIOPINNAME_MAX; i++ )
     {
-        DBG_LOG("%02d ", digitalRead(pinNumber[i]));
+        DBG_LOG("%02d ", backend->Read(pinNumber[i]));
     }
     fprintf(stdout, "\n");
 #endif
@@ -172,15 +208,26 @@ int GPIOControl::gpioInit(void)
 {
     int ret = -1;
 
+    if ( backend == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
 #ifdef __MP_DEBUG_BUILD__
     DBG_LOG("[GPIO]");
     DBG_LOG("-PIN-+-MODE-+-VALUE-----");
 #endif
     for ( int i = 0; i < GPIOPINNAME_MAX; i++ )
     {
-        pinMode(pinNumber[i], pinDir[i]);
+        ret = backend->SetMode(pinNumber[i], pinDir[i], (pinDir[i] == GPIO_DIR_IN) ? (eGPIOPULL)pinDefaultValue[i] : GPIO_PULL_OFF);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
 
-        if ( pinDir[i] == OUTPUT )
+        if ( pinDir[i] == GPIO_DIR_OUT )
         {
             if ( pinDefaultValue[i] == GPIO_SET )
             {
@@ -204,9 +251,8 @@ int GPIOControl::gpioInit(void)
     fprintf(stdout, "[Log %s3%d] %4d |%5d | OUT %6d\n", __FUNCTION__, __LINE__, pinNumber[i], pinDir[i], pinDefaultValue[i]);
 #endif
         }
-        else if ( pinDir[i] == INPUT )
+        else if ( pinDir[i] == GPIO_DIR_IN )
         {
-            pullUpDnControl(pinNumber[i], pinDefaultValue[i]) ;
 #ifdef __MP_DEBUG_BUILD__
     fprintf(stdout, "[Log %s3%d] %4d |%5d | IN  %6d\n", __FUNCTION__, __LINE__, pinNumber[i], pinDir[i], pinDefaultValue[i]);
 #endif
@@ -227,14 +273,12 @@ int GPIOControl::gpioSet(eGPIOPINNAME pin)
         return -1;
     }
 
-    if ( pinDir[pin] != OUTPUT )
+    if ( pinDir[pin] != GPIO_DIR_OUT )
     {
         return -1;
     }
 
-    digitalWrite(pinNumber[pin], GPIO_SET);
-
-    return 0;
+    return backend->Write(pinNumber[pin], GPIO_SET);
 }
 
 int GPIOControl::gpioReset(eGPIOPINNAME pin)
@@ -244,14 +288,12 @@ int GPIOControl::gpioReset(eGPIOPINNAME pin)
         return -1;
     }
 
-    if ( pinDir[pin] != OUTPUT )
+    if ( pinDir[pin] != GPIO_DIR_OUT )
     {
         return -1;
     }
 
-    digitalWrite(pinNumber[pin], GPIO_RESET);
-
-    return 0;
+    return backend->Write(pinNumber[pin], GPIO_RESET);
 }
 
 int GPIOControl::GPIOTest(void)
@@ -260,7 +302,7 @@ int GPIOControl::GPIOTest(void)
 
     for ( int i = 0; i < GPIOPINNAME_MAX; i++ )
     {
-        if ( pinDir[i] != OUTPUT )
+        if ( pinDir[i] != GPIO_DIR_OUT )
         {
             continue;
         }
@@ -278,7 +320,7 @@ int GPIOControl::GPIOTest(void)
 
     for ( int i = 0; i < GPIOPINNAME_MAX; i++ )
     {
-        if ( pinDir[i] != OUTPUT )
+        if ( pinDir[i] != GPIO_DIR_OUT )
         {
             continue;
         }
@@ -303,7 +345,154 @@ int GPIOControl::GPIOTest(void)
     return 0;
 }
 
-int GPIOControl::WaitDownloadReadySet(void)
+static inline long elapsedMs(const struct timespec* from, const struct timespec* to)
+{
+    return (to->tv_sec - from->tv_sec) * 1000L + (to->tv_nsec - from->tv_nsec) / 1000000L;
+}
+
+/*
+ * sleeps on the backend edge events until the input reads level and stays there debounceMs.
+ * edge: when the level was reached, the wait start if it was already there.
+ */
+int GPIOControl::gpioWait(eGPIOPINNAME pin, int level, int timeoutMs, struct timespec* edge)
+{
+    struct timespec start;
+    struct timespec now;
+    struct timespec since;
+    struct timespec event;
+    int             eventSeen = 0;
+    int             matched   = 0;
+    int             waitMs    = -1;
+    int             ret       = -1;
+
+    if ( backend == NULL || pinDir[pin] != GPIO_DIR_IN )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    /* edges left over from the last wait are stale */
+    do
+    {
+        ret = backend->WaitEvent(pinNumber[pin], 0, &event);
+    } while ( ret > 0 );
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    since = start;
+
+    while ( 1 )
+    {
+        ret = backend->Read(pinNumber[pin]);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        if ( ret == level )
+        {
+            if ( matched == 0 )
+            {
+                matched = 1;
+                since   = (eventSeen != 0) ? event : now;
+            }
+
+            long held = elapsedMs(&since, &now);
+            if ( held >= debounceMs )
+            {
+                break;
+            }
+            waitMs = (int)(debounceMs - held);
+        }
+        else
+        {
+            matched = 0;
+
+            if ( timeoutMs >= 0 )
+            {
+                long elapsed = elapsedMs(&start, &now);
+                if ( elapsed >= timeoutMs )
+                {
+                    return 1;
+                }
+                waitMs = (int)(timeoutMs - elapsed);
+            }
+            else
+            {
+                waitMs = -1;
+            }
+        }
+
+        ret = backend->WaitEvent(pinNumber[pin], waitMs, &event);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+
+        if ( ret > 0 )
+        {
+            /* a bounce restarts the debounce from this edge */
+            eventSeen = 1;
+            matched   = 0;
+        }
+    }
+
+    if ( edge != NULL )
+    {
+        *edge = since;
+    }
+
+    return 0;
+}
+
+void GPIOControl::SetDebounce(int debounceMs)
+{
+    this->debounceMs = (debounceMs > 0) ? debounceMs : 0;
+}
+
+void GPIOControl::SetTiming(const timingProfile_t* timing)
+{
+    if ( timing != NULL )
+    {
+        this->timing = *timing;
+    }
+}
+
+long GPIOControl::TakeDelayUs(void)
+{
+    long us = delayUs;
+
+    delayUs = 0;
+
+    return us;
+}
+
+/* every deliberate sleep goes through here so the cycle can report it */
+void GPIOControl::settle(int ms)
+{
+    struct timespec from;
+    struct timespec to;
+
+    if ( ms <= 0 )
+    {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &from);
+    usleep(ms * 1000);
+    clock_gettime(CLOCK_MONOTONIC, &to);
+
+    delayUs += (to.tv_sec - from.tv_sec) * 1000000L + (to.tv_nsec - from.tv_nsec) / 1000L;
+}
+
+int GPIOControl::WaitDownloadReadySet(int timeoutMs, struct timespec* edge)
 {
     int ret = -1;
 
@@ -314,12 +503,12 @@ int GPIOControl::WaitDownloadReadySet(void)
         return -1;
     }
 
-    do
+    ret = gpioWait(GPIOPINNAME_MS500_DL_READY, 1, timeoutMs, edge);
+    if ( ret != 0 )
     {
-        usleep(100);
-        ret = digitalRead(pinNumber[GPIOPINNAME_MS500_DL_READY]);
-    } while ( ret != 1 );
-    DBG_LOG("Power: %d", ret);
+        return ret;
+    }
+    DBG_LOG("Power: %d", 1);
 
     ret = gpioSet(GPIOPINNAME_MS500_DL_STATE);
     if ( ret < 0 )
@@ -331,7 +520,7 @@ int GPIOControl::WaitDownloadReadySet(void)
     return 0;
 }
 
-int GPIOControl::WaitDownloadReadyReset(void)
+int GPIOControl::WaitDownloadReadyReset(int timeoutMs, struct timespec* edge)
 {
     int ret = -1;
 
@@ -342,12 +531,12 @@ int GPIOControl::WaitDownloadReadyReset(void)
         return -1;
     }
 
-    do
+    ret = gpioWait(GPIOPINNAME_MS500_DL_READY, 0, timeoutMs, edge);
+    if ( ret != 0 )
     {
-        usleep(100);
-        ret = digitalRead(pinNumber[GPIOPINNAME_MS500_DL_READY]);
-    } while ( ret != 0 );
-    DBG_LOG("Power: %d", ret);
+        return ret;
+    }
+    DBG_LOG("Power: %d", 0);
 
     ret = gpioSet(GPIOPINNAME_MS500_DL_STATE);
     if ( ret < 0 )
@@ -359,7 +548,7 @@ int GPIOControl::WaitDownloadReadyReset(void)
     return 0;
 }
 
-int GPIOControl::WaitDownloadStart(void)
+int GPIOControl::WaitDownloadStart(int timeoutMs, struct timespec* edge)
 {
     int ret = -1;
 
@@ -370,12 +559,12 @@ int GPIOControl::WaitDownloadStart(void)
         return -1;
     }
 
-    do
+    ret = gpioWait(GPIOPINNAME_MS500_DL_START, 0, timeoutMs, edge);
+    if ( ret != 0 )
     {
-        usleep(100);
-        ret = digitalRead(pinNumber[GPIOPINNAME_MS500_DL_START]);
-    } while ( ret != 0 );
-    DBG_LOG("Start button value: %d", ret);
+        return ret;
+    }
+    DBG_LOG("Start button value: %d", 0);
 
     ret = gpioSet(GPIOPINNAME_MS500_DL_STATE);
     if ( ret < 0 )
@@ -424,7 +613,8 @@ int GPIOControl::ResetAllSocket(void)
 /* after 0.2 */
 #else
     int ret = -1;
-    
+
+    /* all four lines get the same pulse at once, one pulse time instead of four */
     for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
     {
         ret = gpioSet((eGPIOPINNAME)(GPIOPINNAME_MS500_RST_CH1+i));
@@ -433,20 +623,24 @@ int GPIOControl::ResetAllSocket(void)
             DBG_ERR("error!!!");
             return -1;
         }
+    }
 
-        /* sleep 0.5 sec */
-        usleep(50*1000);
+    settle(timing.resetSetupMs);
 
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
+    {
         ret = gpioReset((eGPIOPINNAME)(GPIOPINNAME_MS500_RST_CH1+i));
         if ( ret < 0 )
         {
             DBG_ERR("error!!!");
             return -1;
         }
+    }
 
-        /* sleep 0.5 sec */
-        usleep(50*1000);
+    settle(timing.resetPulseMs);
 
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
+    {
         ret = gpioSet((eGPIOPINNAME)(GPIOPINNAME_MS500_RST_CH1+i));
         if ( ret < 0 )
         {
@@ -460,17 +654,22 @@ int GPIOControl::ResetAllSocket(void)
 }
 
 int GPIOControl::ResetSocket(void)
+{
+    return ResetSocket(enabledSocket);
+}
+
+int GPIOControl::ResetSocket(eSOCKETCHANNEL ch)
 {
     int ret = -1;
     int rst = -1;
     
-    if ( (enabledSocket < SOCKET_CH1) || (enabledSocket >= SOCKET_MAX) )
+    if ( (ch < SOCKET_CH1) || (ch >= SOCKET_MAX) )
     {
         DBG_ERR("error!!!");
         return -1;
     }
     
-    rst = (GPIOPINNAME_MS500_RST_CH1+enabledSocket);
+    rst = (GPIOPINNAME_MS500_RST_CH1+ch);
     ret = gpioSet((eGPIOPINNAME)rst);
     if ( ret < 0 )
     {
@@ -478,8 +677,7 @@ int GPIOControl::ResetSocket(void)
         return -1;
     }
 
-    /* sleep 0.5 sec */
-    usleep(50*1000);
+    settle(timing.resetSetupMs);
 
     ret = gpioReset((eGPIOPINNAME)rst);
     if ( ret < 0 )
@@ -488,8 +686,7 @@ int GPIOControl::ResetSocket(void)
         return -1;
     }
 
-    /* sleep 0.5 sec */
-    usleep(50*1000);
+    settle(timing.resetPulseMs);
 
     ret = gpioSet((eGPIOPINNAME)rst);
     if ( ret < 0 )
@@ -502,18 +699,23 @@ int GPIOControl::ResetSocket(void)
 }
 
 int GPIOControl::resetResultLED(void)
+{
+    return ClearResultLED(enabledSocket);
+}
+
+int GPIOControl::ClearResultLED(eSOCKETCHANNEL ch)
 {
     int ret = -1;
 
-    if ( (enabledSocket < SOCKET_CH1) || (enabledSocket >= SOCKET_MAX) )
+    if ( (ch < SOCKET_CH1) || (ch >= SOCKET_MAX) )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    if ( pinDefaultValue[(GPIOPINNAME_MS500_CH1_LEDR+(enabledSocket*2))] == GPIO_SET )
+    if ( pinDefaultValue[(GPIOPINNAME_MS500_CH1_LEDR+(ch*2))] == GPIO_SET )
     {
-        ret = gpioSet((eGPIOPINNAME)(GPIOPINNAME_MS500_CH1_LEDR+(enabledSocket*2)));
+        ret = gpioSet((eGPIOPINNAME)(GPIOPINNAME_MS500_CH1_LEDR+(ch*2)));
         if ( ret < 0 )
         {
             DBG_ERR("error!!!");
@@ -522,7 +724,7 @@ int GPIOControl::resetResultLED(void)
     }
     else
     {
-        ret = gpioReset((eGPIOPINNAME)(GPIOPINNAME_MS500_CH1_LEDR+(enabledSocket*2)));
+        ret = gpioReset((eGPIOPINNAME)(GPIOPINNAME_MS500_CH1_LEDR+(ch*2)));
         if ( ret < 0 )
         {
             DBG_ERR("error!!!");
@@ -531,9 +733,9 @@ int GPIOControl::resetResultLED(void)
     }
 
 
-    if ( pinDefaultValue[(GPIOPINNAME_MS500_CH1_LEDR+(enabledSocket*2)+1)] == GPIO_SET )
+    if ( pinDefaultValue[(GPIOPINNAME_MS500_CH1_LEDR+(ch*2)+1)] == GPIO_SET )
     {
-        ret = gpioSet((eGPIOPINNAME)(GPIOPINNAME_MS500_CH1_LEDR+(enabledSocket*2)+1));
+        ret = gpioSet((eGPIOPINNAME)(GPIOPINNAME_MS500_CH1_LEDR+(ch*2)+1));
         if ( ret < 0 )
         {
             DBG_ERR("error!!!");
@@ -542,13 +744,15 @@ int GPIOControl::resetResultLED(void)
     }
     else
     {
-        ret = gpioReset((eGPIOPINNAME)(GPIOPINNAME_MS500_CH1_LEDR+(enabledSocket*2)+1));
+        ret = gpioReset((eGPIOPINNAME)(GPIOPINNAME_MS500_CH1_LEDR+(ch*2)+1));
         if ( ret < 0 )
         {
             DBG_ERR("error!!!");
             return -1;
         }
     }
+
+    return 0;
 }
 
 int GPIOControl::EnableUARTSW(void)
@@ -687,31 +891,35 @@ int GPIOControl::SelectSocket(eSOCKETCHANNEL ch)
         return -1;
     }
 
-    /* sleep 0.5 sec */
-    usleep(500*1000);
+    settle(timing.selectSettleMs);
 
     return 0;
 }
 
 int GPIOControl::SetResultLED(eRESULTLED res)
+{
+    return SetResultLED(enabledSocket, res);
+}
+
+int GPIOControl::SetResultLED(eSOCKETCHANNEL ch, eRESULTLED res)
 {
     int ret = -1;
     int led = 0;
 
-    if ( (enabledSocket < SOCKET_CH1) || (enabledSocket >= SOCKET_MAX) )
+    if ( (ch < SOCKET_CH1) || (ch >= SOCKET_MAX) )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    if ( (led < LED_R) || (led > LED_G) )
+    if ( (res < LED_R) || (res > LED_G) )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
     led =  GPIOPINNAME_MS500_CH1_LEDR;
-    led += enabledSocket*2;
+    led += ch*2;
     led += res;
 
     if ( (led < GPIOPINNAME_MS500_CH1_LEDR) || (led > GPIOPINNAME_MS500_CH4_LEDG) )
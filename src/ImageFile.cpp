@@ -0,0 +1,157 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "debug.h"
+#include "ImageFile.h"
+
+ImageFile::ImageFile(void): data(NULL), size(0), copied(0)
+{
+}
+
+ImageFile::~ImageFile(void)
+{
+    Close();
+}
+
+int ImageFile::Open(const char* fileName, int snapshot)
+{
+    int ret = -1;
+    int fd  = -1;
+    struct stat st;
+
+    if ( fileName == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    Close();
+
+    fd = open(fileName, O_RDONLY);
+    if ( fd < 0 )
+    {
+        DBG_ERR("%s open error", fileName);
+        return -1;
+    }
+
+    ret = fstat(fd, &st);
+    if ( ret < 0 || !S_ISREG(st.st_mode) )
+    {
+        DBG_ERR("%s stat error", fileName);
+        close(fd);
+        return -1;
+    }
+
+    /* empty file: valid, nothing to map */
+    if ( st.st_size == 0 )
+    {
+        close(fd);
+        return 0;
+    }
+
+    if ( snapshot != 0 )
+    {
+        ret = readCopy(fd, &st);
+        close(fd);
+        if ( ret < 0 )
+        {
+            DBG_ERR("%s changed while read", fileName);
+            return -1;
+        }
+        return 0;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if ( map == MAP_FAILED )
+    {
+        DBG_ERR("%s mmap error", fileName);
+        return -1;
+    }
+
+    /* images are streamed front to back */
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    data = (unsigned char*)map;
+    size = (unsigned int)st.st_size;
+
+    return 0;
+}
+
+/* the whole file into private memory, -1: short read, or size/mtime moved meanwhile */
+int ImageFile::readCopy(int fd, const struct stat* st)
+{
+    struct stat    after;
+    unsigned char* copy = new unsigned char[st->st_size];
+    off_t          done = 0;
+
+    while ( done < st->st_size )
+    {
+        ssize_t readBytes = pread(fd, copy + done, st->st_size - done, done);
+        if ( readBytes < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        if ( readBytes <= 0 )
+        {
+            break;
+        }
+        done += readBytes;
+    }
+
+    if ( done != st->st_size || fstat(fd, &after) < 0 || after.st_size != st->st_size
+      || after.st_mtim.tv_sec != st->st_mtim.tv_sec || after.st_mtim.tv_nsec != st->st_mtim.tv_nsec )
+    {
+        delete[] copy;
+        return -1;
+    }
+
+    data   = copy;
+    size   = (unsigned int)st->st_size;
+    copied = 1;
+
+    return 0;
+}
+
+int ImageFile::Close(void)
+{
+    int ret = 0;
+
+    if ( data != NULL && copied != 0 )
+    {
+        delete[] data;
+    }
+    else
+    if ( data != NULL )
+    {
+        ret = munmap(data, size);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+        }
+    }
+    data   = NULL;
+    size   = 0;
+    copied = 0;
+
+    return (ret < 0) ? -1 : 0;
+}
+
+const unsigned char* ImageFile::GetData(void)
+{
+    return data;
+}
+
+unsigned int ImageFile::GetSize(void)
+{
+    return size;
+}
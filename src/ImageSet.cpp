@@ -0,0 +1,2153 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <time.h>
+
+#include "CRC32.h"
+#include "LZ4Block.h"
+#include "ImageSet.h"
+#include "SerialComm.h"
+
+#include "debug.h"
+#define MINIINI_NO_STL
+#include "ini.h"
+
+#define CONFIG_LINE_BUFFER_SIZE    (1024)
+
+static const char optionParams[OPTION_TYPE_MAX][64] = {
+    "[FLASHWINDOW]",
+    "[UART_CH1]",
+    "[UART_CH2]",
+    "[UART_CH3]",
+    "[UART_CH4]",
+    "[UPLOADERBAUDRATE]",
+    "[GPIODEBOUNCE]",
+    "[GPIOTIMEOUT]",
+    "[SELECTSETTLE]",
+    "[RESETSETUP]",
+    "[RESETPULSE]",
+    "[RESULTHOLD]",
+    "[ROMPROBE]",
+    "[REWORKSCAN]",
+    "[FLASHDELTA]",
+    "[FLASHCOMPRESS]",
+    "[FLASHFILL]",
+    "[SDBSTREAM]",
+    "[HOTRELOAD]"
+};
+
+/* addresses and sizes */
+static const unsigned int PKA_BASE_ADDR         = (FLASH_BASE_ADDR + 0x10000);
+static const unsigned int PKA_FW_IV_ADDR        = (PKA_BASE_ADDR + 0x0000);
+static const unsigned int PKA_AKEY_ADDR         = (PKA_BASE_ADDR + 0x0400);
+static const unsigned int PKA_CURVE_PARAM_ADDR  = (PKA_BASE_ADDR + 0x0800);
+static const unsigned int PKA_CLP300_FW_ADDR    = (PKA_BASE_ADDR + 0x1000);
+static const unsigned int APP_BASE_ADDR         = (FLASH_BASE_ADDR + 0x20000);
+static const unsigned int APP_SIGNATURE_S_ADDR  = (APP_BASE_ADDR + 0x0000);
+static const unsigned int APP_SIGNATURE_R_ADDR  = (APP_BASE_ADDR + 0x0400);
+static const unsigned int APP_SIZE_ADDR         = (APP_BASE_ADDR + 0x0800);
+static const unsigned int APP_IMAGE_BASE_ADDR   = (APP_BASE_ADDR + 0x2000);
+static const unsigned int SDB_INFO_ADDR         = (FLASH_BASE_ADDR + 0x0300000);
+static const unsigned int FLASH_BLOCK_SIZE      = (0x10000);
+
+static inline long diffUs(const struct timespec* from, const struct timespec* to)
+{
+    return (to->tv_sec - from->tv_sec) * 1000000L + (to->tv_nsec - from->tv_nsec) / 1000L;
+}
+
+#pragma pack(push, 1)
+typedef struct _FirmwareImageFileHeader_t {
+    unsigned char  prefix[5];
+    unsigned char  sbEnEnabled;
+    unsigned int   codeSize;
+    unsigned int   totalSize;
+} FirmwareImageFileHeader_t;
+#pragma pack(pop)
+
+/* setting.conf only names what it changes, every set starts from these */
+ImageSet::ImageSet(void)
+{
+    configFileName   = NULL;
+    uploaderFileName = NULL;
+    appImageFileName = NULL;
+    sdbInfoFileName  = NULL;
+    planFileName     = NULL;
+
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
+    {
+        socketDeviceName[i] = NULL;
+    }
+
+    uploaderBinary = NULL;
+    uploaderBinarySize = 0;
+
+    secureBootEnabled = 0;
+
+    pkaBinary = NULL;
+    pkaBinarySize = 0;
+
+    signatureBinary = NULL;
+    signatureBinarySize = 0;
+
+    sdbCodeBinary = NULL;
+    sdbCodeBinarySize = 0;
+    sdbPath = 0;
+    appCodeBinary = NULL;
+    appCodeBinarySize = 0;
+    appImageTotalSize = 0;
+
+    memset(&uploaderHeader, 0x00, sizeof(uploaderHeader));
+    memset(sectorTable, 0x00, sizeof(sectorTable));
+
+    uploaderFile = new ImageFile();
+    appImageFile = new ImageFile();
+
+    plan          = new DownloadPlan();
+    sdbList       = NULL;
+    sdbFile       = NULL;
+    sdbEntry      = NULL;
+    sdbEntryCount = 0;
+    memset(sdbData, 0x00, sizeof(sdbData));
+
+    eFuseBootSource = 0x00;
+    eFuseSecureBootEnable = 0;
+    eFusePKfWrite = 0;
+    eFuseUKeyLock = 0;
+    eFusePKfLock  = 0;
+    eFuseDUKLock  = 0;
+    memset(eFuseUKey, 0x00, sizeof(eFuseUKey));
+    memset(eFusePKf,  0x00, sizeof(eFusePKf));
+
+    flashWindowSize = 1;
+    reworkScan = 0;
+    flashDelta = 0;
+    flashCompress = 0;
+    flashFill = 0;
+    sdbStream = 0;
+    hotReload = 0;
+    uploaderBaudrate = 0;
+    gpioDebounceMs = 0;
+    gpioTimeoutMs  = -1;
+    timing  = TIMING_PROFILE_DEFAULT;
+}
+
+ImageSet::~ImageSet(void)
+{
+    char** name[] = { &configFileName, &uploaderFileName, &appImageFileName, &sdbInfoFileName, &planFileName };
+
+    for ( unsigned int i = 0; i < sizeof(name) / sizeof(name[0]); i++ )
+    {
+        if ( *name[i] != NULL )
+        {
+            delete[] *name[i];
+            *name[i] = NULL;
+        }
+    }
+
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
+    {
+        if ( socketDeviceName[i] != NULL )
+        {
+            delete[] socketDeviceName[i];
+            socketDeviceName[i] = NULL;
+        }
+    }
+
+    freeSectorTable();
+    freeSdbList();
+
+    /* binaries point into the mappings, unmapped here */
+    uploaderBinary  = NULL;
+    pkaBinary       = NULL;
+    signatureBinary = NULL;
+    appCodeBinary   = NULL;
+
+    if ( uploaderFile != NULL )
+    {
+        delete uploaderFile;
+        uploaderFile = NULL;
+    }
+
+    if ( appImageFile != NULL )
+    {
+        delete appImageFile;
+        appImageFile = NULL;
+    }
+
+    if ( plan != NULL )
+    {
+        delete plan;
+        plan = NULL;
+    }
+}
+
+int ImageSet::SetName(eFILETYPE type, const char* in)
+{
+    size_t inLen = 0;
+    char** name  = NULL;
+
+    if ( in == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    inLen = strlen(in);
+    if ( inLen <= 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    switch ( type )
+    {
+        case FILE_NAME_CONF:
+            {
+                name = &configFileName;
+            }
+            break;
+
+        case FILE_NAME_UPLOADER:
+            {
+                name = &uploaderFileName;
+            }
+            break;
+
+        case FILE_NAME_APPIMAGE:
+            {
+                name = &appImageFileName;
+            }
+            break;
+
+        case FILE_NAME_SDBINFO:
+            {
+                name = &sdbInfoFileName;
+            }
+            break;
+
+        case FILE_NAME_PLAN:
+            {
+                name = &planFileName;
+            }
+            break;
+
+        default:
+            {
+                DBG_ERR("error!!!");
+            }
+            return -1;
+    }
+
+    if ( *name != NULL )
+    {
+        delete[] *name;
+    }
+    *name = new char[(inLen + 1)] {0,};
+    memcpy(*name, in, inLen);
+
+    return 0;
+}
+
+/* once per set, before any cycle reads it: on -1 the caller only deletes the set */
+int ImageSet::Load(void)
+{
+    int ret = -1;
+
+    if ( configFileName == NULL || uploaderFileName == NULL || appImageFileName == NULL || sdbInfoFileName == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    ret = parseConfigFile();
+    if ( ret != 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+#ifdef __MP_DEBUG_BUILD__
+    DBG_LOG("[%s]", __FUNCTION__);
+    DBG_LOG("-PARAMS--------------+-VALUES-----------------------------------------------------------");
+    DBG_LOG("    Config File Name | %s", configFileName);
+    DBG_LOG("  Uploader File Name | %s", uploaderFileName);
+    DBG_LOG(" App Image File Name | %s", appImageFileName);
+    DBG_LOG(" sdbinfo   File Name | %s", sdbInfoFileName);
+    DBG_LOG("      Plan File Name | %s", (planFileName != NULL) ? planFileName : "(none)");
+    DBG_LOG("         Boot Source | 0x%02X", eFuseBootSource);
+    DBG_LOG("  Secure Boot Enable | %d", eFuseSecureBootEnable);
+    DBG_LOG("           UKey Lock | %d", eFuseUKeyLock);
+    DBG_LOG("            PKf Lock | %d", eFusePKfLock);
+    DBG_LOG("            DUK Lock | %d", eFuseDUKLock);
+	DBG_LOG("            PKF Skip | %d", eFusePKfWrite);
+    DBG_LOG("        Flash Window | %d", flashWindowSize);
+    DBG_LOG("   Uploader Baudrate | %d", uploaderBaudrate);
+    DBG_LOG("        CRC32 Kernel | %s", CRC32::GetKernelName());
+    DBG_LOG("       GPIO Debounce | %d ms", gpioDebounceMs);
+    DBG_LOG("        GPIO Timeout | %d ms", gpioTimeoutMs);
+    DBG_LOG("       Select Settle | %d ms", timing.selectSettleMs);
+    DBG_LOG("   Reset Setup/Pulse | %d/%d ms", timing.resetSetupMs, timing.resetPulseMs);
+    DBG_LOG("         Result Hold | %d ms", timing.resultHoldMs);
+    DBG_LOG("           ROM Probe | %d ms", timing.romProbeMs);
+    DBG_LOG("         Rework Scan | %d", reworkScan);
+    DBG_LOG("         Flash Delta | %d", flashDelta);
+    DBG_LOG("      Flash Compress | %d", flashCompress);
+    DBG_LOG("          Flash Fill | %d", flashFill);
+    DBG_LOG("          SDB Stream | %d", sdbStream);
+    DBG_LOG("          Hot Reload | %d", hotReload);
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
+    {
+        DBG_LOG("     Socket#%d  UART | %s", i, (socketDeviceName[i] != NULL) ? socketDeviceName[i] : "(UART mux)");
+    }
+    fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
+    fprintf(stdout, "                UKey | ");
+    for ( int i = 0; i < sizeof(eFuseUKey); i++ )
+    {
+        fprintf(stdout, "%02X", eFuseUKey[i]);
+    }
+    fprintf(stdout, "\n");
+    fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
+    fprintf(stdout, "                 PKf | ");
+    for ( int i = 0; i < sizeof(eFusePKf); i++ )
+    {
+        fprintf(stdout, "%02X", eFusePKf[i]);
+    }
+    fprintf(stdout, "\n");
+    DBG_LOG("---------------------+------------------------------------------------------------------\n");
+#endif
+
+    /* socket topology: every socket on its own UART, or all of them on the UART mux */
+    int socketDeviceCount = 0;
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
+    {
+        if ( socketDeviceName[i] != NULL )
+        {
+            socketDeviceCount++;
+        }
+    }
+    if ( (socketDeviceCount != 0) && (socketDeviceCount != SOCKET_MAX) )
+    {
+        DBG_ERR("UART_CH1~%d must be all set or all empty", SOCKET_MAX);
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    /* a plan built from these very inputs replaces the image checks and every crc and compression pass below */
+    const char*     planInputs[] = { configFileName, uploaderFileName, appImageFileName, sdbInfoFileName };
+    struct timespec planFrom;
+    struct timespec planTo;
+    clock_gettime(CLOCK_MONOTONIC, &planFrom);
+    if ( planFileName != NULL )
+    {
+        ret = plan->Load(planFileName, planInputs, sizeof(planInputs) / sizeof(planInputs[0]));
+        if ( ret == 0 )
+        {
+            ret = applyPlan();
+        }
+        if ( ret == 0 )
+        {
+            clock_gettime(CLOCK_MONOTONIC, &planTo);
+            DBG_LOG("plan %s: up to date, %u bytes, %ld us", planFileName, plan->GetHeader()->size, diffUs(&planFrom, &planTo));
+            return 0;
+        }
+        plan->Close();
+    }
+
+    ret = openUploaderFile();
+    if ( ret != 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    ret = openAppImageFile();
+    if ( ret != 0 )
+    {
+        DBG_ERR("appImageFileName: %s", appImageFileName);
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    /* every crc of the download is computed here once, the images never change between cycles */
+    unsigned int uploaderPacketSize = uploaderBinarySize + sizeof(UPLOADER_BINARY_PREFIX) + sizeof(uploaderBinarySize);
+    ret = makeCmdHeader(PACKET_TYPE_SRAM, SRAM_BASE_ADDR, uploaderBinary, uploaderPacketSize, uploaderBinarySize, &uploaderHeader);
+    if ( ret != 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    freeSectorTable();
+    ret = buildSectorTable(IMAGE_REGION_APP, appCodeBinary, appCodeBinarySize, APP_IMAGE_BASE_ADDR);
+    if ( ret == 0 && secureBootEnabled == 1 )
+    {
+        ret = buildSectorTable(IMAGE_REGION_PKA, pkaBinary, pkaBinarySize, PKA_BASE_ADDR);
+    }
+    if ( ret == 0 && secureBootEnabled == 1 )
+    {
+        ret = buildSectorTable(IMAGE_REGION_SIGNATURE, signatureBinary, signatureBinarySize, APP_BASE_ADDR);
+    }
+    if ( ret != 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    ret = loadSdbList();
+    if ( ret != 0 )
+    {
+        DBG_ERR("sdbInfoFileName: %s", sdbInfoFileName);
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    /* a plan that can not be written is not fatal, the tables just built stay in use */
+    if ( planFileName != NULL )
+    {
+        ret = compilePlan();
+        if ( ret == 0 )
+        {
+            ret = plan->Load(planFileName, planInputs, sizeof(planInputs) / sizeof(planInputs[0]));
+        }
+        if ( ret == 0 )
+        {
+            ret = applyPlan();
+        }
+        clock_gettime(CLOCK_MONOTONIC, &planTo);
+        if ( ret == 0 )
+        {
+            DBG_LOG("plan %s: rebuilt, %u bytes, %ld us", planFileName, plan->GetHeader()->size, diffUs(&planFrom, &planTo));
+        }
+        else
+        {
+            plan->Close();
+            DBG_ERR("plan %s: not written, running without it", planFileName);
+        }
+    }
+
+    return 0;
+}
+
+/* SDB_<index> of the loaded sdbinfo.ini, 1: no such section */
+int ImageSet::parseSdb(ini_t* sdb, int index, unsigned char* outInfo, unsigned int outInfoLen, ImageFile* outData)
+{
+    int ret = -1;
+    char section[128] = {0,};
+
+    if ( sdb == NULL || outInfo == NULL || outInfoLen != SDB_INFO_HEADER_SIZE || outData == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    sprintf(section, "SDB_%d", index);
+    const char* path = ini_get(sdb, section, "Path");
+    if ( path == NULL )
+    {
+        return 1;
+    }
+    
+    const char* option = ini_get(sdb, section, "Option");
+    const char* data = ini_get(sdb, section, "Data");
+
+    ret = outData->Open(data, hotReload);
+    if ( ret < 0 )
+    {
+        DBG_ERR("%s, file(%s) open error", __FUNCTION__, data);
+        return -1;
+    }
+
+    SDBInfoFile_t* sdbinfo = (SDBInfoFile_t*)outInfo;
+    memset(outInfo, 0x00, outInfoLen);
+    strncpy((char*)sdbinfo->path, path, sizeof(sdbinfo->path) - 1);
+    sdbinfo->option = (option != NULL) ? atoi(option) : 0;
+    sdbinfo->datasize = outData->GetSize();
+    
+#ifdef __MP_DEBUG_BUILD__
+    DBG_LOG("[SDB Data]");
+    DBG_LOG("-PARAMS--------------+-VALUES-----");
+    if ( sdbinfo->datasize > 0 )
+    {
+        fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
+        fprintf(stdout, "   data              | ");
+        for ( unsigned int i = 0; i < 16 && i < sdbinfo->datasize; i++ )
+        {
+            fprintf(stdout, "%02X", outData->GetData()[i]);
+        }
+        fprintf(stdout, "\n");
+    }
+    DBG_LOG("   path              | %s", sdbinfo->path);
+    DBG_LOG("   option            | %d", sdbinfo->option);
+    DBG_LOG("   datasize          | %d", sdbinfo->datasize);
+    DBG_LOG("---------------------+------------");
+#endif
+
+    return 0;
+}
+
+/*
+ * every SDB_n of sdbinfo.ini parsed once at load into planSdb_t[count] with the info packets
+ * and CRCs. the data files stay mapped, every device streams them from there.
+ */
+int ImageSet::loadSdbList(void)
+{
+    int           ret = -1;
+    int           count = 0;
+    unsigned int  dataSize = 0;
+    planSdb_t     entry[PLAN_SDB_MAX];
+    char          section[128] = {0,};
+
+    freeSdbList();
+
+    ini_t* sdb = ini_load(sdbInfoFileName);
+    if ( sdb == NULL )
+    {
+        DBG_ERR("sdbinfo is NULL");
+        return -1;
+    }
+
+    sdbFile = new ImageFile[PLAN_SDB_MAX];
+    memset(entry, 0x00, sizeof(entry));
+    while ( count < PLAN_SDB_MAX )
+    {
+        ret = parseSdb(sdb, count, entry[count].info, SDB_INFO_HEADER_SIZE, &sdbFile[count]);
+        if ( ret != 0 )
+        {
+            break;
+        }
+        dataSize += sdbFile[count].GetSize();
+        count++;
+    }
+    if ( ret == 0 )
+    {
+        sprintf(section, "SDB_%d", count);
+        if ( ini_get(sdb, section, "Path") != NULL )
+        {
+            DBG_ERR("more than %d SDB entries", PLAN_SDB_MAX);
+            ret = -1;
+        }
+    }
+    ini_free(sdb);
+    if ( ret < 0 )
+    {
+        freeSdbList();
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    sdbList = new planSdb_t[(count > 0) ? count : 1];
+    for ( int i = 0; i < count; i++ )
+    {
+        sdbList[i] = entry[i];
+        sdbList[i].dataSize  = sdbFile[i].GetSize();
+        sdbList[i].crc       = CRC32::CalcCRC32(sdbFile[i].GetData(), sdbFile[i].GetSize());
+        sdbList[i].packetCrc = CRC32::CalcCRC32(sdbFile[i].GetData(), sdbFile[i].GetSize(),
+                                                CRC32::CalcCRC32(sdbList[i].info, SDB_INFO_HEADER_SIZE));
+        sdbData[i] = sdbFile[i].GetData();
+    }
+
+    sdbEntry      = sdbList;
+    sdbEntryCount = count;
+
+    DBG_LOG("%s: %d SDB entries, %u bytes", sdbInfoFileName, count, dataSize);
+
+    return 0;
+}
+
+void ImageSet::freeSdbList(void)
+{
+    if ( sdbList != NULL )
+    {
+        delete[] sdbList;
+        sdbList = NULL;
+    }
+
+    if ( sdbFile != NULL )
+    {
+        delete[] sdbFile;
+        sdbFile = NULL;
+    }
+
+    sdbEntry      = NULL;
+    sdbEntryCount = 0;
+    memset(sdbData, 0x00, sizeof(sdbData));
+}
+
+/* SDB_<index> for one device, 0: found, 1: no such entry */
+int ImageSet::getSdb(int index, const unsigned char** info, const unsigned char** data, unsigned int* size, unsigned int* crc, unsigned int* packetCrc)
+{
+    if ( info == NULL || data == NULL || size == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    if ( index >= sdbEntryCount )
+    {
+        return 1;
+    }
+
+    *info = sdbEntry[index].info;
+    *size = sdbEntry[index].dataSize;
+    *data = (*size > 0) ? sdbData[index] : NULL;
+    if ( crc != NULL )
+    {
+        *crc = sdbEntry[index].crc;
+    }
+    if ( packetCrc != NULL )
+    {
+        *packetCrc = sdbEntry[index].packetCrc;
+    }
+
+    return 0;
+}
+
+void ImageSet::swapPkf(unsigned char* arr, int first, int second)
+{
+	unsigned char temp;
+
+	temp = arr[first];
+	arr[first] = arr[second];
+	arr[second] = temp;
+}
+
+int ImageSet::keyStringTohexArray(eEFUSETYPE type, const char* in)
+{
+    int ret = -1;
+    int inLen = 0;	
+	int removeCharLen = 0;
+	char endChar = 5;
+	char removeChar[65] = {0,};
+	
+	inLen = strlen(in);
+	if(inLen == 66)
+	{		
+		DBG_LOG("PKF Swap Mode");
+		endChar = in[inLen-1];
+		DBG_LOG("endChar: %c", endChar);
+		
+		memcpy(removeChar, in, 64);
+		removeCharLen = strlen(removeChar);		
+		if(removeCharLen != 64)
+		{
+			DBG_ERR("removecharLen: %d", removeCharLen);
+			DBG_ERR("removeChar: %s", removeChar);
+			return -1;
+		}
+	}
+	else
+	if(inLen == 64)
+	{
+		DBG_LOG("PKF None Swap Mode");
+		
+		removeCharLen = 64;
+		memcpy(removeChar, in, 64);
+	}
+	else
+	{
+		DBG_ERR("Error 111111");
+		return -1;
+	}
+	
+	
+    /* check type */
+    unsigned char* hexArray = NULL;
+    switch ( type )
+    {
+        case EFUSE_TYPE_UKEY:
+            {
+                hexArray = eFuseUKey;
+                ret = 0;
+            }
+            break;
+
+        case EFUSE_TYPE_PKF:
+            {
+                hexArray = eFusePKf;
+                ret = 0;
+            }
+            break;
+
+        default:
+            {
+                DBG_ERR("error!!!");
+                ret = -1;
+            }
+            break;
+    }
+    if ( ret != 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    /* convert: string(char array) => hex(unsigned char array) */
+    memset(hexArray, 0, 32);
+    for ( int i = 0; i < removeCharLen; i++ )
+    {
+        /* a(10)~f(15) => A(10)~F(15)  */
+        if ( removeChar[i] >= 'a' && removeChar[i] <= 'f' )
+        {
+            removeChar[i] -= ('a' - 'A');
+        }
+
+        /* case #1: A ~ F */
+        if ( removeChar[i] >= 'A' && removeChar[i] <= 'F' )
+        {
+            /* Even, 0xA0 ~ 0xF0 */
+            if ( i % 2 == 0 )
+            {
+                hexArray[i/2] = (removeChar[i]-('A'-0xA))<<4;
+            }
+            /* Odd, 0xA ~ 0xF */
+            else
+            {
+                hexArray[i/2] |= (removeChar[i]-('A'-0xA));
+            }
+        }
+        /* case #2: 0 ~ 9 */
+        else if( removeChar[i] >= '0' && removeChar[i] <= '9' )
+        {
+            /* Even, 0x00 ~ 0x90 */
+            if ( i % 2 == 0 )
+            {
+                hexArray[i/2] = (removeChar[i]-('0'-0))<<4;
+            }
+            /* Odd, 0x00 ~ 0x09 */
+            else
+            {
+                hexArray[i/2] |= (removeChar[i]-('0'-0));
+            }
+        }
+        /* invalid key string */
+        else
+        {
+
+            DBG_ERR("error!!!");
+            return -1;
+        }
+    }
+	
+	switch (endChar)
+	{
+		case '0':
+			swapPkf(hexArray, 3, 7);
+			swapPkf(hexArray, 16, 22);
+			swapPkf(hexArray, 25, 29);
+			break;
+		case '1':
+			swapPkf(hexArray, 4, 26);
+			swapPkf(hexArray, 6, 18);
+			swapPkf(hexArray, 12, 20);
+			break;
+		case '2':
+			swapPkf(hexArray, 5, 14);
+			swapPkf(hexArray, 11, 18);
+			swapPkf(hexArray, 3, 30);
+			break;
+		case '3':
+			swapPkf(hexArray, 2, 13);
+			swapPkf(hexArray, 7, 21);
+			swapPkf(hexArray, 15, 17);
+			break;
+		default:
+			break;
+	}
+	
+    return 0;
+}
+
+int ImageSet::parseValue(eEFUSETYPE type, const char* in)
+{
+    int ret = -1;
+
+    /* check key type */
+    if ( (type < EFUSE_BOOT_SRC) || (type >= EFUSE_TYPE_MAX) )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    switch ( type )
+    {
+        case EFUSE_BOOT_SRC:
+            {
+                /* param is empty */
+                if ( in == NULL )
+                {
+                    eFuseBootSource = 0;
+                    ret = 0;
+                }
+
+                /* set boot source value */
+                const char bootSrcString[6][64] = {
+                    "ExternalPins",    /* 0b000, 0 */
+                    "SPIDirect1",      /* 0b100, 4 */
+                    "SPIDirect2",      /* 0b101, 5 */
+                    "SPIDirect3",      /* 0b110, 6 */
+                    "SRAM",            /* 0b111, 7 */
+                    "ROM"              /* 0b001, 0 */
+                };
+                const unsigned char bootSrcValue[6] = {0, 4, 5, 6, 7, 0};
+
+                /* check param, set boot source value */
+                for ( unsigned int i = 0; i < 6; i++ )
+                {
+                    if ( !strcmp(in, bootSrcString[i]) )
+                    {
+                        eFuseBootSource = (bootSrcValue[i]&0x07);
+                        ret = 0;
+                        break;
+                    }
+                }
+            }
+            break;
+
+        case EFUSE_SB_EN:
+            {
+                /* param is 'n' or empty: disable */
+                if ( (in == NULL) || !strcmp(in, "n") )
+                {
+                    eFuseSecureBootEnable = 0;
+                    ret = 0;
+                }
+                /* param is 'y': enable */
+                else if ( !strcmp(in, "y") )
+                {
+                    eFuseSecureBootEnable = 1;
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case EFUSE_TYPE_UKEY_LOCK:
+            {
+                /* param is 'n' or empty: disable */
+                if ( (in == NULL) || !strcmp(in, "n") )
+                {
+                    DBG_LOG("UKEY_N");
+                    eFuseUKeyLock = 0;
+                    ret = 0;
+                }
+                /* param is 'y': enable */
+                else if ( !strcmp(in, "y") )
+                {
+                    DBG_LOG("UKEY_Y");
+                    eFuseUKeyLock = 1;
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case EFUSE_TYPE_PKF_LOCK:
+            {
+                /* param is 'n' or empty: disable */
+                if ( (in == NULL) || !strcmp(in, "n") )
+                {
+                    DBG_LOG("PKF_N");
+                    eFusePKfLock = 0;
+                    ret = 0;
+                }
+                /* param is 'y': enable */
+                else if ( !strcmp(in, "y") )
+                {
+                    DBG_LOG("PKF_Y");
+                    eFusePKfLock = 1;
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case EFUSE_TYPE_DUK_LOCK:
+            {
+                /* param is 'n' or empty: disable */
+                if ( (in == NULL) || !strcmp(in, "n") )
+                {
+                    DBG_LOG("DUK_N");
+                    eFuseDUKLock = 0;
+                    ret = 0;
+                }
+                /* param is 'y': enable */
+                else if ( !strcmp(in, "y") )
+                {
+                    DBG_LOG("DUK_Y");
+                    eFuseDUKLock = 1;
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case EFUSE_TYPE_UKEY:
+			{
+                if ( in == NULL )
+                {
+                    ret = 0;
+                    break;
+                }
+                ret = keyStringTohexArray(type, in);
+                if ( ret < 0 )
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+        case EFUSE_TYPE_PKF:
+            {
+                if ( in == NULL )
+                {
+                    ret = 0;
+                    break;
+                }
+                ret = keyStringTohexArray(type, in);
+                if ( ret < 0 )
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+			
+		case EFUSE_WRITE_PKF:
+			{
+				/* param is 'n' or empty: disable */
+                if ( (in == NULL) || !strcmp(in, "n") )
+                {
+                    DBG_LOG("PKF_WRITE_N");
+                    eFusePKfWrite = 0;
+                    ret = 0;
+                }
+                /* param is 'y': enable */
+                else if ( !strcmp(in, "y") )
+                {
+                    DBG_LOG("PKF_WRITE_Y");
+                    eFusePKfWrite = 1;
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+			}
+			break;
+    }
+
+    if ( ret != 0 )
+    {
+        DBG_ERR("error!!!");
+        DBG_ERR("type: 0x%04X, in: %s", type, in);
+        return ret;
+    }
+
+    return ret;
+}
+
+int ImageSet::parseOption(eOPTIONTYPE type, const char* in)
+{
+    int ret = -1;
+
+    if ( (type < OPTION_FLASH_WINDOW) || (type >= OPTION_TYPE_MAX) || (in == NULL) )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    switch ( type )
+    {
+        case OPTION_FLASH_WINDOW:
+            {
+                int value = atoi(in);
+                if ( (value >= 1) && (value <= (int)FLASH_WINDOW_MAX) )
+                {
+                    flashWindowSize = value;
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case OPTION_UPLOADER_BAUDRATE:
+            {
+                int value = atoi(in);
+                /* 0 keeps -b, anything else must be a rate the port can be set to */
+                if ( (value == 0) || SerialComm::IsSupportedBaudrate(value) )
+                {
+                    uploaderBaudrate = value;
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case OPTION_GPIO_DEBOUNCE:
+            {
+                int value = atoi(in);
+                if ( (value >= 0) && (value <= 1000) )
+                {
+                    gpioDebounceMs = value;
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case OPTION_GPIO_TIMEOUT:
+            {
+                int value = atoi(in);
+                if ( value >= 0 )
+                {
+                    gpioTimeoutMs = (value == 0) ? -1 : (value * 1000);
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case OPTION_SELECT_SETTLE:
+        case OPTION_RESET_SETUP:
+        case OPTION_RESET_PULSE:
+        case OPTION_RESULT_HOLD:
+        case OPTION_ROM_PROBE:
+            {
+                int* delay[] = {
+                    &timing.selectSettleMs,
+                    &timing.resetSetupMs,
+                    &timing.resetPulseMs,
+                    &timing.resultHoldMs,
+                    &timing.romProbeMs
+                };
+                int value = atoi(in);
+                if ( (value >= 0) && (value <= 10000) )
+                {
+                    *delay[type - OPTION_SELECT_SETTLE] = value;
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case OPTION_REWORK_SCAN:
+        case OPTION_FLASH_DELTA:
+        case OPTION_FLASH_COMPRESS:
+        case OPTION_FLASH_FILL:
+        case OPTION_SDB_STREAM:
+        case OPTION_HOT_RELOAD:
+            {
+                int* flag = &reworkScan;
+                if ( type == OPTION_FLASH_DELTA )
+                {
+                    flag = &flashDelta;
+                }
+                else
+                if ( type == OPTION_FLASH_COMPRESS )
+                {
+                    flag = &flashCompress;
+                }
+                else
+                if ( type == OPTION_FLASH_FILL )
+                {
+                    flag = &flashFill;
+                }
+                else
+                if ( type == OPTION_SDB_STREAM )
+                {
+                    flag = &sdbStream;
+                }
+                else
+                if ( type == OPTION_HOT_RELOAD )
+                {
+                    flag = &hotReload;
+                }
+
+                /* param is 'n' or empty: disable */
+                if ( !strcmp(in, "n") )
+                {
+                    *flag = 0;
+                    ret = 0;
+                }
+                /* param is 'y': enable */
+                else if ( !strcmp(in, "y") )
+                {
+                    *flag = 1;
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case OPTION_UART_CH1:
+        case OPTION_UART_CH2:
+        case OPTION_UART_CH3:
+        case OPTION_UART_CH4:
+            {
+                int ch = (type - OPTION_UART_CH1);
+                if ( socketDeviceName[ch] != NULL )
+                {
+                    delete[] socketDeviceName[ch];
+                    socketDeviceName[ch] = NULL;
+                }
+                socketDeviceName[ch] = new char[(strlen(in) + 1)] {0,};
+                strcpy(socketDeviceName[ch], in);
+                ret = 0;
+            }
+            break;
+
+        default:
+            {
+                DBG_ERR("error!!!");
+                ret = -1;
+            }
+            break;
+    }
+
+    if ( ret != 0 )
+    {
+        DBG_ERR("type: 0x%04X, in: %s", type, in);
+        return ret;
+    }
+
+    return ret;
+}
+
+int ImageSet::parseLine(const char* in)
+{
+    int ret = -1;
+    int inLen = 0;
+
+    if ( in == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    /* key value length check */
+    inLen = strlen(in);
+    if ( (inLen <= 0) || (inLen >= (CONFIG_LINE_BUFFER_SIZE-1)) )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    /* get key type and value, both shorter than the line */
+    char param[CONFIG_LINE_BUFFER_SIZE] = {0,};
+    char value[CONFIG_LINE_BUFFER_SIZE] = {0,};
+    sscanf(in, "%s %s", param, value);
+
+    /* value is empty */
+    if ( strlen(value) == 0 )
+    {
+        return 0;
+    }
+
+    /* key value length check */
+    if ( strlen(value) > 66 )
+    {
+        DBG_ERR("param(%4zu): %s", strlen(param), param);
+        DBG_ERR("value(%4zu): %s", strlen(value), value);
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    /* check value, set key */
+    for ( unsigned int i = 0; i < EFUSE_TYPE_MAX; i++ )
+    {
+        if ( strcmp(param, eFuseKeyParams[i]) == 0 )
+        {
+            ret = parseValue((eEFUSETYPE)i, value);
+            if ( ret < 0 )
+            {
+                DBG_ERR("error!!!");
+                return -1;
+            }
+            return 0;
+        }
+    }
+
+    /* check value, set option */
+    for ( unsigned int i = 0; i < OPTION_TYPE_MAX; i++ )
+    {
+        if ( strcmp(param, optionParams[i]) == 0 )
+        {
+            ret = parseOption((eOPTIONTYPE)i, value);
+            if ( ret < 0 )
+            {
+                DBG_ERR("error!!!");
+                return -1;
+            }
+            return 0;
+        }
+    }
+
+    /* invalid value */
+    DBG_ERR("error!!!");
+    return -1;
+}
+
+/* everything it opens is closed before it returns, on every path */
+int ImageSet::parseConfigFile(void)
+{
+    int ret = -1;
+
+    ret = access(configFileName, R_OK);
+    if ( ret != 0 )
+    {
+        DBG_ERR("configFileName: %s", configFileName);
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    FILE* confFile = NULL;
+    confFile = fopen(configFileName, "r");
+    if ( confFile == NULL )
+    {
+        DBG_ERR("%s, file(%s) open error", __FUNCTION__, configFileName);
+        return -1;
+    }
+
+    char line[CONFIG_LINE_BUFFER_SIZE] = {0,};
+    while ( fgets(line, CONFIG_LINE_BUFFER_SIZE, confFile) != NULL )
+    {
+        /* Skip Comment or Blank */
+        if ( line[0] == '#' || strlen(line) < 4 )
+        {
+            continue;
+        }
+        else
+        {
+            ret = parseLine(line);
+            if ( ret < 0 )
+            {
+                DBG_ERR("error!!!");
+                fclose(confFile);
+                return -1;
+            }
+        }
+    }
+
+    fclose(confFile);
+
+    return 0;
+}
+
+int ImageSet::openUploaderFile(void)
+{
+    int ret = -1;
+
+    /* check uploader file */
+    ret = access(uploaderFileName, R_OK);
+    if ( ret != 0 )
+    {
+        DBG_ERR("uploaderFileName: %s", uploaderFileName);
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    /* map uploader file, HOTRELOAD copies it: the watched file may be rewritten under the set */
+    uploaderBinary     = NULL;
+    uploaderBinarySize = 0;
+
+    ret = uploaderFile->Open(uploaderFileName, hotReload);
+    if ( ret < 0 || uploaderFile->GetSize() == 0 )
+    {
+        DBG_ERR("%s, file(%s) open error", __FUNCTION__, uploaderFileName);
+        return -1;
+    }
+
+    uploaderBinary     = uploaderFile->GetData();
+    uploaderBinarySize = uploaderFile->GetSize();
+
+    return 0;
+}
+
+int ImageSet::checkImgFilePrefix(const unsigned char* in)
+{
+    const unsigned char prefix[5] = {(unsigned char)'e', (unsigned char)'W', (unsigned char)'B', (unsigned char)'M', 0x66 };
+
+    for ( int i = 0; i < sizeof(prefix); i++ )
+    {
+        if ( in[i] != prefix[i] )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int ImageSet::readSizeFromImgFile(unsigned int in, unsigned int* out)
+{
+    if ( out == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    *out = (((in & 0xFF)       << 24)
+          | ((in & 0xFF00)     <<  8)
+          | ((in & 0xFF0000)   >>  8)
+          | ((in & 0xFF000000) >> 24));
+
+    return 0;
+}
+
+int ImageSet::checkAppCodeBinarySize(unsigned int in)
+{
+    int ret = -1;
+
+    if ( (appImageTotalSize <= 0) || ((secureBootEnabled != 1) && (secureBootEnabled != 0)) )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    ret = readSizeFromImgFile(in, &appCodeBinarySize);
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    if ( secureBootEnabled == 1 )
+    {
+        if ( appCodeBinarySize != appImageTotalSize - 0x4000 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+    }
+    else
+    {
+        if ( appCodeBinarySize != appImageTotalSize )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int ImageSet::checkSdbCodeBinarySize(unsigned int in)
+{
+    int ret = -1;
+
+    if ( (appImageTotalSize <= 0) || ((secureBootEnabled != 1) && (secureBootEnabled != 0)) )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    ret = readSizeFromImgFile(in, &sdbCodeBinarySize);
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    if ( secureBootEnabled == 1 )
+    {
+        if ( appCodeBinarySize != appImageTotalSize - 0x4000 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+    }
+    else
+    {
+        if ( appCodeBinarySize != appImageTotalSize )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int ImageSet::checkAppImageTotalSize(unsigned int in, unsigned int in2)
+{
+    int ret = -1;
+
+    if ( in2 <= 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    ret = readSizeFromImgFile(in, &appImageTotalSize);
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    if ( appImageTotalSize != (in2 - sizeof(FirmwareImageFileHeader_t)) )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    return 0;
+}
+
+int ImageSet::openAppImageFile(void)
+{
+    int ret = -1;
+
+    /* check app image file */
+    ret = access(appImageFileName, R_OK);
+    if ( ret != 0 )
+    {
+        DBG_ERR("appImageFileName: %s", appImageFileName);
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    /* pka, signature and app code are sub-spans of the mapping(of the copy, HOTRELOAD) */
+    pkaBinary           = NULL;
+    pkaBinarySize       = 0;
+    signatureBinary     = NULL;
+    signatureBinarySize = 0;
+    appCodeBinary       = NULL;
+    appCodeBinarySize   = 0;
+
+    ret = appImageFile->Open(appImageFileName, hotReload);
+    if ( ret < 0 )
+    {
+        DBG_ERR("%s, file(%s) open error", __FUNCTION__, appImageFileName);
+        return -1;
+    }
+
+    const unsigned char* appImageFileBinary     = appImageFile->GetData();
+    unsigned int         appImageFileBinarySize = appImageFile->GetSize();
+    if ( appImageFileBinarySize < sizeof(FirmwareImageFileHeader_t) )
+    {
+        appImageFile->Close();
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    const FirmwareImageFileHeader_t* appImageFileBinaryHeader = (const FirmwareImageFileHeader_t*)appImageFileBinary;
+
+    ret = checkImgFilePrefix(appImageFileBinaryHeader->prefix);
+    if ( ret < 0 )
+    {
+        appImageFile->Close();
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    secureBootEnabled = appImageFileBinaryHeader->sbEnEnabled;
+    if ( (secureBootEnabled != 0) && (secureBootEnabled != 1) )
+    {
+        appImageFile->Close();
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    ret = checkAppImageTotalSize(appImageFileBinaryHeader->totalSize, appImageFileBinarySize);
+    if ( ret < 0 )
+    {
+        appImageFile->Close();
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    ret = checkAppCodeBinarySize(appImageFileBinaryHeader->codeSize);
+    if ( ret < 0 )
+    {
+        appImageFile->Close();
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    unsigned int base = sizeof(FirmwareImageFileHeader_t);
+    if ( secureBootEnabled == 1 )
+    {
+        pkaBinarySize       = 0x2000;
+        signatureBinarySize = 0x2000;
+        pkaBinary           = appImageFileBinary + base;
+        signatureBinary     = appImageFileBinary + base + pkaBinarySize;
+    }
+    base += pkaBinarySize;
+    base += signatureBinarySize;
+    appCodeBinary = appImageFileBinary + base;
+    base += appCodeBinarySize;
+
+#ifdef __MP_DEBUG_BUILD__
+    DBG_LOG("[IMG FILE INFO]");
+    DBG_LOG("-PARAMS--------------+-VALUES--------------------------");
+    fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
+    fprintf(stdout, "              header | ");
+    for ( int i = 0; i < sizeof(appImageFileBinaryHeader->prefix); i++ )
+    {
+        fprintf(stdout, "%02X", appImageFileBinaryHeader->prefix[i]);
+    }
+	
+    fprintf(stdout, " %02X %08X %08X\n", appImageFileBinaryHeader->sbEnEnabled, appImageFileBinaryHeader->codeSize, appImageFileBinaryHeader->totalSize);
+    DBG_LOG("   secureBootEnabled | 0x%02X",      secureBootEnabled, secureBootEnabled);
+    DBG_LOG("   appCodeBinarySize | 0x%08X(%d)", appCodeBinarySize, appCodeBinarySize);
+    DBG_LOG("   appImageTotalSize | 0x%08X(%d)", appImageTotalSize, appImageTotalSize);
+    DBG_LOG("       pkaBinarySize | 0x%08X(%d)", pkaBinarySize, pkaBinarySize);
+    DBG_LOG(" signatureBinarySize | 0x%08X(%d)", signatureBinarySize, signatureBinarySize);
+    if ( appCodeBinarySize > 0 )
+    {
+        fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
+        fprintf(stdout, "       appCodeBinary | ");
+        for ( int i = 0; i < 16; i++ )
+        {
+            fprintf(stdout, "%02X", appCodeBinary[i]);
+        }
+        fprintf(stdout, "\n");
+    }
+    if ( pkaBinarySize > 0 )
+    {
+        fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
+        fprintf(stdout, "           pkaBinary | ");
+        for ( int i = 0; i < 16; i++ )
+        {
+            fprintf(stdout, "%02X", pkaBinary[i]);
+        }
+        fprintf(stdout, "\n");
+    }
+    if ( signatureBinarySize > 0 )
+    {
+        fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
+        fprintf(stdout, "     signatureBinary | ");
+        for ( int i = 0; i < 16; i++ )
+        {
+            fprintf(stdout, "%02X", signatureBinary[i]);
+        }
+        fprintf(stdout, "\n");
+    }
+    DBG_LOG("---------------------+----------------------------------\n");
+#endif
+
+    return 0;
+}
+
+int ImageSet::buildSectorTable(eIMAGEREGION region, const unsigned char* in, unsigned int inLen, unsigned int addr)
+{
+    int ret = -1;
+
+    if ( region < IMAGE_REGION_APP || region >= IMAGE_REGION_MAX || in == NULL || inLen <= 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    sectorTable_t* table = &sectorTable[region];
+    if ( table->header != NULL && table->mapped == 0 )
+    {
+        delete[] table->header;
+    }
+    if ( table->payload != NULL )
+    {
+        delete[] table->payload;
+    }
+    if ( table->packed != NULL )
+    {
+        delete[] table->packed;
+    }
+    if ( table->fill != NULL && table->mapped == 0 )
+    {
+        delete[] table->fill;
+    }
+
+    table->data    = in;
+    table->size    = inLen;
+    table->addr    = addr;
+    table->count   = ((inLen + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE);
+    table->crc     = CRC32::CalcCRC32(in, inLen);
+    table->header  = new cmdPacketHeader_t[table->count];
+    table->payload = new const unsigned char*[table->count];
+    table->packed  = NULL;
+    table->fill    = NULL;
+    table->erased  = 0;
+    table->mapped  = 0;
+
+    /* a compressed sector is always smaller than the raw one, inLen bounds them all */
+    unsigned int packedSize  = 0;
+    unsigned int packedCount = 0;
+    unsigned int fillCount   = 0;
+    unsigned int savedSize   = 0;
+    struct timespec from;
+    struct timespec to;
+    if ( flashCompress == 1 )
+    {
+        table->packed = new unsigned char[inLen];
+    }
+    if ( flashFill == 1 )
+    {
+        table->fill = new flashFill_t[table->count];
+        memset(table->fill, 0x00, table->count * sizeof(flashFill_t));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &from);
+
+    unsigned int base     = 0;
+    unsigned int sendSize = 0;
+    for ( unsigned int i = 0; i < table->count; i++ )
+    {
+        base = i * FLASH_SECTOR_SIZE;
+        if ( FLASH_SECTOR_SIZE > inLen - base )
+        {
+            sendSize = inLen - base;
+        }
+        else
+        {
+            sendSize = FLASH_SECTOR_SIZE;
+        }
+
+        ret = makeCmdHeader(PACKET_TYPE_FLASH, addr + base, in + base, sendSize, inLen, &table->header[i]);
+        if ( ret < 0 )
+        {
+            delete[] table->header;
+            delete[] table->payload;
+            if ( table->packed != NULL )
+            {
+                delete[] table->packed;
+            }
+            if ( table->fill != NULL )
+            {
+                delete[] table->fill;
+            }
+            memset(table, 0x00, sizeof(sectorTable_t));
+            DBG_ERR("error!!!");
+            return -1;
+        }
+        table->payload[i] = in + base;
+
+        /* one byte throughout: a fill packet instead of the data, the crc stays on the sector */
+        if ( (table->fill != NULL) && (memcmp(in + base, in + base + 1, sendSize - 1) == 0) )
+        {
+            table->fill[i].length    = (unsigned short)sendSize;
+            table->fill[i].value     = in[base];
+            table->header[i].type    = PACKET_TYPE_FLASH_FILL;
+            table->header[i].size[0] = sizeof(flashFill_t);
+            table->payload[i] = (const unsigned char*)&table->fill[i];
+            fillCount++;
+
+            if ( erasedSector(table, i) )
+            {
+                savedSize += sizeof(cmdPacketHeader_t) + sendSize;
+                table->erased++;
+            }
+            else
+            {
+                savedSize += sendSize - sizeof(flashFill_t);
+            }
+        }
+        else
+        /* compressed: same header, the crc stays on the raw sector, only the payload shrinks */
+        if ( table->packed != NULL )
+        {
+            ret = LZ4Block::Compress(in + base, sendSize, table->packed + packedSize, sendSize - 1);
+            if ( ret > 0 )
+            {
+                table->header[i].type    = PACKET_TYPE_FLASH_COMPRESSED;
+                table->header[i].size[0] = ret;
+                table->payload[i] = table->packed + packedSize;
+                packedSize += ret;
+                packedCount++;
+            }
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &to);
+
+    DBG_LOG("0x%08X: %d sector headers", addr, table->count);
+    if ( table->fill != NULL )
+    {
+        DBG_LOG("0x%08X: %d/%d sectors constant, %d erased not sent, %u bytes saved",
+                addr, fillCount, table->count, table->erased, savedSize);
+    }
+    if ( table->packed != NULL )
+    {
+        /* payload bytes on the wire against the image, and how fast the host compressed it */
+        unsigned int wireSize = 0;
+        for ( unsigned int i = 0; i < table->count; i++ )
+        {
+            if ( erasedSector(table, i) == 0 )
+            {
+                wireSize += table->header[i].size[0];
+            }
+        }
+
+        long us = diffUs(&from, &to);
+        DBG_LOG("0x%08X: %d/%d sectors compressed, %u -> %u bytes(%u%%), %ld us(%ld KB/s)",
+                addr, packedCount, table->count, inLen, wireSize, (unsigned int)((unsigned long long)wireSize * 100 / inLen),
+                us, (us > 0) ? (long)((unsigned long long)inLen * 1000000 / us / 1024) : 0);
+    }
+
+    return 0;
+}
+
+void ImageSet::freeSectorTable(void)
+{
+    for ( int i = IMAGE_REGION_APP; i < IMAGE_REGION_MAX; i++ )
+    {
+        if ( sectorTable[i].header != NULL && sectorTable[i].mapped == 0 )
+        {
+            delete[] sectorTable[i].header;
+        }
+        if ( sectorTable[i].payload != NULL )
+        {
+            delete[] sectorTable[i].payload;
+        }
+        if ( sectorTable[i].packed != NULL )
+        {
+            delete[] sectorTable[i].packed;
+        }
+        if ( sectorTable[i].fill != NULL && sectorTable[i].mapped == 0 )
+        {
+            delete[] sectorTable[i].fill;
+        }
+        memset(&sectorTable[i], 0x00, sizeof(sectorTable_t));
+    }
+}
+
+/* writes what Load() built from the inputs to planFileName, so the next start only maps it */
+int ImageSet::compilePlan(void)
+{
+    int ret = -1;
+    planHeader_t header;
+
+    memset(&header, 0x00, sizeof(header));
+
+    ret = plan->Create(planFileName);
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    /* the fixed inputs first, in the order Load() is given them */
+    if ( plan->AddInput(configFileName) < 0 || plan->AddInput(uploaderFileName) < 0
+      || plan->AddInput(appImageFileName) < 0 || plan->AddInput(sdbInfoFileName) < 0 )
+    {
+        plan->Abort();
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    header.uploaderHeader    = uploaderHeader;
+    header.uploaderOffset    = plan->Append(uploaderBinary, uploaderBinarySize);
+    header.uploaderSize      = uploaderBinarySize;
+    header.secureBootEnabled = secureBootEnabled;
+
+    for ( int r = IMAGE_REGION_APP; r < IMAGE_REGION_MAX; r++ )
+    {
+        const sectorTable_t* table  = &sectorTable[r];
+        planRegion_t*        region = &header.region[r];
+        if ( table->header == NULL )
+        {
+            continue;
+        }
+
+        region->addr         = table->addr;
+        region->size         = table->size;
+        region->count        = table->count;
+        region->crc          = table->crc;
+        region->erased       = table->erased;
+        region->dataOffset   = plan->Append(table->data, table->size);
+        region->headerOffset = plan->Append(table->header, table->count * sizeof(cmdPacketHeader_t));
+        if ( table->fill != NULL )
+        {
+            region->fillOffset = plan->Append(table->fill, table->count * sizeof(flashFill_t));
+        }
+
+        /* the LZ4 blocks sit back to back in packed, up to the end of the last one */
+        unsigned int packedSize   = 0;
+        unsigned int packedOffset = 0;
+        for ( unsigned int i = 0; i < table->count; i++ )
+        {
+            if ( table->header[i].type == PACKET_TYPE_FLASH_COMPRESSED )
+            {
+                packedSize = (unsigned int)(table->payload[i] - table->packed) + table->header[i].size[0];
+            }
+        }
+        if ( packedSize > 0 )
+        {
+            packedOffset = plan->Append(table->packed, packedSize);
+        }
+
+        unsigned int* payload = new unsigned int[table->count];
+        for ( unsigned int i = 0; i < table->count; i++ )
+        {
+            if ( table->header[i].type == PACKET_TYPE_FLASH_COMPRESSED )
+            {
+                payload[i] = packedOffset + (unsigned int)(table->payload[i] - table->packed);
+            }
+            else
+            if ( table->header[i].type == PACKET_TYPE_FLASH_FILL )
+            {
+                payload[i] = region->fillOffset + (unsigned int)(table->payload[i] - (const unsigned char*)table->fill);
+            }
+            else
+            {
+                payload[i] = region->dataOffset + (unsigned int)(table->payload[i] - table->data);
+            }
+        }
+        region->payloadOffset = plan->Append(payload, table->count * sizeof(unsigned int));
+        delete[] payload;
+    }
+
+    /* the SDB list of this set, each data file becomes an input of the plan as well */
+    planSdb_t sdb[PLAN_SDB_MAX];
+    char      section[128] = {0,};
+    ini_t*    sdbInfo = ini_load(sdbInfoFileName);
+    if ( sdbInfo == NULL )
+    {
+        plan->Abort();
+        DBG_ERR("sdbinfo is NULL");
+        return -1;
+    }
+
+    ret = 0;
+    for ( int i = 0; i < sdbEntryCount; i++ )
+    {
+        sprintf(section, "SDB_%d", i);
+        const char* data = ini_get(sdbInfo, section, "Data");
+
+        sdb[i] = sdbEntry[i];
+        sdb[i].dataOffset = (sdb[i].dataSize > 0) ? plan->Append(sdbData[i], sdb[i].dataSize) : 0;
+        if ( data == NULL || plan->AddInput(data) < 0 )
+        {
+            ret = -1;
+            break;
+        }
+    }
+    ini_free(sdbInfo);
+    if ( ret < 0 )
+    {
+        plan->Abort();
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    header.sdbCount  = sdbEntryCount;
+    header.sdbOffset = plan->Append(sdb, sdbEntryCount * sizeof(planSdb_t));
+
+    return plan->Commit(&header);
+}
+
+/* points the uploader, the sector tables and the SDB list into the loaded plan, every range checked first */
+int ImageSet::applyPlan(void)
+{
+    const planHeader_t* header = plan->GetHeader();
+
+    if ( header == NULL || plan->GetRange(header->uploaderOffset, header->uploaderSize) == NULL
+      || header->sdbCount > PLAN_SDB_MAX
+      || (header->sdbCount > 0 && plan->GetRange(header->sdbOffset, (unsigned long long)header->sdbCount * sizeof(planSdb_t)) == NULL) )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+    for ( int r = IMAGE_REGION_APP; r < IMAGE_REGION_MAX; r++ )
+    {
+        const planRegion_t* region = &header->region[r];
+        if ( region->count == 0 )
+        {
+            continue;
+        }
+        if ( plan->GetRange(region->dataOffset, region->size) == NULL
+          || plan->GetRange(region->headerOffset, (unsigned long long)region->count * sizeof(cmdPacketHeader_t)) == NULL
+          || plan->GetRange(region->payloadOffset, (unsigned long long)region->count * sizeof(unsigned int)) == NULL
+          || (region->fillOffset != 0 && plan->GetRange(region->fillOffset, (unsigned long long)region->count * sizeof(flashFill_t)) == NULL) )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+
+        /* what follows each header on the wire is size[0] bytes from its payload offset */
+        const cmdPacketHeader_t* regionHeader = (const cmdPacketHeader_t*)plan->GetRange(region->headerOffset, 0);
+        const unsigned int*      payload      = (const unsigned int*)plan->GetRange(region->payloadOffset, 0);
+        for ( unsigned int i = 0; i < region->count; i++ )
+        {
+            if ( plan->GetRange(payload[i], regionHeader[i].size[0]) == NULL )
+            {
+                DBG_ERR("plan region %d sector %u out of the plan", r, i);
+                return -1;
+            }
+        }
+    }
+    const planSdb_t* sdb = (const planSdb_t*)plan->GetRange(header->sdbOffset, 0);
+    for ( unsigned int i = 0; i < header->sdbCount; i++ )
+    {
+        if ( sdb[i].dataSize > 0 && plan->GetRange(sdb[i].dataOffset, sdb[i].dataSize) == NULL )
+        {
+            DBG_ERR("plan SDB_%u out of the plan", i);
+            return -1;
+        }
+    }
+
+    freeSectorTable();
+
+    uploaderHeader     = header->uploaderHeader;
+    uploaderBinary     = plan->GetRange(header->uploaderOffset, header->uploaderSize);
+    uploaderBinarySize = header->uploaderSize;
+    secureBootEnabled  = header->secureBootEnabled;
+
+    for ( int r = IMAGE_REGION_APP; r < IMAGE_REGION_MAX; r++ )
+    {
+        const planRegion_t* region = &header->region[r];
+        sectorTable_t*      table  = &sectorTable[r];
+        if ( region->count == 0 )
+        {
+            continue;
+        }
+
+        table->data    = plan->GetRange(region->dataOffset, region->size);
+        table->size    = region->size;
+        table->addr    = region->addr;
+        table->count   = region->count;
+        table->crc     = region->crc;
+        table->header  = (cmdPacketHeader_t*)plan->GetRange(region->headerOffset, (unsigned long long)region->count * sizeof(cmdPacketHeader_t));
+        table->fill    = (flashFill_t*)plan->GetRange(region->fillOffset, (unsigned long long)region->count * sizeof(flashFill_t));
+        table->erased  = region->erased;
+        table->mapped  = 1;
+        table->payload = new const unsigned char*[table->count];
+
+        const unsigned int* payload = (const unsigned int*)plan->GetRange(region->payloadOffset, (unsigned long long)region->count * sizeof(unsigned int));
+        for ( unsigned int i = 0; i < table->count; i++ )
+        {
+            table->payload[i] = plan->GetRange(payload[i], table->header[i].size[0]);
+        }
+    }
+
+    appCodeBinary       = sectorTable[IMAGE_REGION_APP].data;
+    appCodeBinarySize   = sectorTable[IMAGE_REGION_APP].size;
+    pkaBinary           = sectorTable[IMAGE_REGION_PKA].data;
+    pkaBinarySize       = sectorTable[IMAGE_REGION_PKA].size;
+    signatureBinary     = sectorTable[IMAGE_REGION_SIGNATURE].data;
+    signatureBinarySize = sectorTable[IMAGE_REGION_SIGNATURE].size;
+
+    freeSdbList();
+    sdbEntry      = (const planSdb_t*)plan->GetRange(header->sdbOffset, (unsigned long long)header->sdbCount * sizeof(planSdb_t));
+    sdbEntryCount = header->sdbCount;
+    for ( int i = 0; i < sdbEntryCount; i++ )
+    {
+        sdbData[i] = plan->GetRange(sdbEntry[i].dataOffset, sdbEntry[i].dataSize);
+    }
+
+    /* nothing points into the input files any more */
+    uploaderFile->Close();
+    appImageFile->Close();
+
+    return 0;
+}
+
+
+int ImageSet::makeCmdHeader(ePACKETTYPE type, unsigned int param, const unsigned char* in, unsigned int inSize, unsigned int optionSize, cmdPacketHeader_t* out)
+{
+    int ret = -1;
+
+    if ( out == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+    memset(out, 0x00, sizeof(cmdPacketHeader_t));
+
+    /* check type and size */
+    switch ( type )
+    {
+        case PACKET_TYPE_SRAM:
+            {
+                if ( (inSize != 0) && (optionSize != 0)
+                  && (inSize == optionSize + sizeof(UPLOADER_BINARY_PREFIX) + sizeof(uploaderBinarySize))
+                  && (optionSize == uploaderBinarySize) )
+                {
+                    out->crc = CRC32::CalcCRC32(in, optionSize);
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case PACKET_TYPE_EFUSE_WRITE:
+            {
+                if ( (inSize != 0) && (optionSize == 0) )
+                {
+                    out->crc = CRC32::CalcCRC32(in, inSize);
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case PACKET_TYPE_EFUSE_BATCH:
+            {
+                /* no entries is a plain read-all */
+                if ( (inSize <= EFUSE_BATCH_MAX_SIZE) && (optionSize == 0) )
+                {
+                    out->crc = (inSize != 0) ? CRC32::CalcCRC32(in, inSize) : 0;
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case PACKET_TYPE_CRC:
+            {
+                /* a flash range(optionSize) or an SDB info header */
+                if ( (inSize == 0) && (optionSize != 0) )
+                {
+                    ret = 0;
+                }
+                else
+                if ( (inSize == SDB_INFO_HEADER_SIZE) && (optionSize == 0) )
+                {
+                    out->crc = CRC32::CalcCRC32(in, inSize);
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case PACKET_TYPE_EFUSE_READ:
+        case PACKET_TYPE_BAUDRATE:
+        case PACKET_TYPE_PING:
+            {
+                if ( (inSize == 0) && (optionSize == 0) )
+                {
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case PACKET_TYPE_FLASH:
+        case PACKET_TYPE_SDB_CHUNK:
+            {
+                if ( (inSize != 0) && (optionSize != 0)
+                  && (inSize <= FLASH_SECTOR_SIZE) )
+                {
+                    out->crc = CRC32::CalcCRC32(in, inSize);
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+            
+        case PACKET_TYPE_SDB_OPEN:
+            {
+                if ( inSize == SDB_INFO_HEADER_SIZE )
+                {
+                    out->crc = CRC32::CalcCRC32(in, inSize);
+                    ret = 0;
+                }
+                else
+                {
+                    DBG_ERR("error!!!");
+                    ret = -1;
+                }
+            }
+            break;
+
+        case PACKET_TYPE_FLASH_SDB:
+            {
+                /* info and data are not one buffer, the crc of both is prebuilt per entry(planSdb_t.packetCrc) */
+                ret = 0;
+            }
+            break;
+
+        default:
+            {
+                DBG_ERR("error!!!");
+                ret = -1;
+            }
+            break;
+    }
+
+    if ( ret < 0 )
+    {
+        return -1;
+    }
+
+    /* make header */
+    out->sync = 0x57;
+    out->type = (unsigned char)(0xFF&type);
+    out->param = param;
+    if ( inSize != 0 )
+    {
+        out->size[0] = inSize;
+    }
+    if ( optionSize != 0 )
+    {
+        out->size[1] = optionSize;
+    }
+
+    return 0;
+}
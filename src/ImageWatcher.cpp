@@ -0,0 +1,222 @@
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/inotify.h>
+
+#include "ImageWatcher.h"
+
+#include "debug.h"
+
+static const unsigned int IMAGE_WATCH_EVENTS = (IN_CLOSE_WRITE | IN_MOVED_TO);
+
+static inline long elapsedMs(const struct timespec* from)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - from->tv_sec) * 1000L + (now.tv_nsec - from->tv_nsec) / 1000000L;
+}
+
+ImageWatcher::ImageWatcher(void)
+{
+    fd         = -1;
+    watchCount = 0;
+    memset(watch, 0x00, sizeof(watch));
+    pthread_mutex_init(&mutex, NULL);
+}
+
+ImageWatcher::~ImageWatcher(void)
+{
+    Close();
+    pthread_mutex_destroy(&mutex);
+}
+
+int ImageWatcher::Open(void)
+{
+    Close();
+
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if ( fd < 0 )
+    {
+        DBG_ERR("inotify error(%d)", errno);
+        return -1;
+    }
+
+    return 0;
+}
+
+int ImageWatcher::Close(void)
+{
+    pthread_mutex_lock(&mutex);
+    if ( fd >= 0 )
+    {
+        close(fd);
+        fd = -1;
+    }
+    watchCount = 0;
+    pthread_mutex_unlock(&mutex);
+
+    return 0;
+}
+
+int ImageWatcher::Watch(const char* const* paths, int count)
+{
+    int ret = 0;
+
+    if ( (count < 0) || (count > IMAGE_WATCH_MAX) || ((count > 0) && (paths == NULL)) )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    pthread_mutex_lock(&mutex);
+
+    if ( fd < 0 )
+    {
+        pthread_mutex_unlock(&mutex);
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    /* a directory watched twice gets the same wd, removing it once drops it */
+    for ( int i = 0; i < watchCount; i++ )
+    {
+        inotify_rm_watch(fd, watch[i].wd);
+    }
+    watchCount = 0;
+
+    for ( int i = 0; i < count; i++ )
+    {
+        char        dir[PATH_MAX] = {0,};
+        const char* name  = strrchr(paths[i], '/');
+
+        if ( name == NULL )
+        {
+            strcpy(dir, ".");
+            name = paths[i];
+        }
+        else
+        {
+            snprintf(dir, sizeof(dir), "%.*s", (name == paths[i]) ? 1 : (int)(name - paths[i]), paths[i]);
+            name++;
+        }
+
+        if ( strlen(name) > NAME_MAX )
+        {
+            DBG_ERR("%s: name too long", paths[i]);
+            ret = -1;
+            continue;
+        }
+
+        int wd = inotify_add_watch(fd, dir, IMAGE_WATCH_EVENTS);
+        if ( wd < 0 )
+        {
+            DBG_ERR("%s watch error(%d)", dir, errno);
+            ret = -1;
+            continue;
+        }
+
+        watch[watchCount].wd = wd;
+        strcpy(watch[watchCount].name, name);
+        watchCount++;
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    return ret;
+}
+
+/* 1: an event names a watched file */
+int ImageWatcher::readEvents(void)
+{
+    char    buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t readBytes = 0;
+    int     changed   = 0;
+
+    pthread_mutex_lock(&mutex);
+
+    while ( (readBytes = read(fd, buffer, sizeof(buffer))) > 0 )
+    {
+        for ( char* p = buffer; p < buffer + readBytes; )
+        {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+
+            for ( int i = 0; (i < watchCount) && (event->len > 0); i++ )
+            {
+                if ( (watch[i].wd == event->wd) && !strcmp(watch[i].name, event->name) )
+                {
+                    DBG_LOG("%s changed", event->name);
+                    changed = 1;
+                }
+            }
+
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    return changed;
+}
+
+/* a file being copied raises many events, the change is reported once it stopped for quietMs */
+int ImageWatcher::Wait(int quietMs, int timeoutMs)
+{
+    struct timespec from;
+    int             changed = 0;
+
+    if ( fd < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &from);
+
+    while ( 1 )
+    {
+        int waitMs = quietMs;
+        if ( changed == 0 )
+        {
+            waitMs = timeoutMs - (int)elapsedMs(&from);
+            if ( waitMs <= 0 )
+            {
+                return 0;
+            }
+        }
+
+        struct pollfd pfd;
+        pfd.fd     = fd;
+        pfd.events = POLLIN;
+
+        int ret = poll(&pfd, 1, waitMs);
+        if ( ret < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+            DBG_ERR("poll error(%d)", errno);
+            return -1;
+        }
+
+        if ( ret == 0 )
+        {
+            if ( changed != 0 )
+            {
+                return 1;
+            }
+            continue;
+        }
+
+        if ( readEvents() != 0 )
+        {
+            changed = 1;
+        }
+    }
+}
@@ -0,0 +1,229 @@
+#include <cstring>
+
+#include "LZ4Block.h"
+
+#include "debug.h"
+
+/*
+ * sequence: token(literal length << 4 | match length - 4), literal length over 14 continued
+ * in 255 steps, literals, 16 bit little endian offset, match length over 18 continued.
+ * the last sequence is literals only.
+ */
+static const unsigned int LZ4_MIN_MATCH     = (4);
+static const unsigned int LZ4_LAST_LITERALS = (5);      /* a block ends with at least this many literals */
+static const unsigned int LZ4_MF_LIMIT      = (12);     /* the last match starts at least this far from the end */
+static const unsigned int LZ4_MAX_OFFSET    = (65535);
+static const int          LZ4_HASH_BITS     = (12);
+static const int          LZ4_HASH_SIZE     = (1 << LZ4_HASH_BITS);
+
+static inline unsigned int read32(const unsigned char* p)
+{
+    unsigned int v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline unsigned int hash4(unsigned int v)
+{
+    return (v * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+
+/* bytes a length takes after its 4 bit token field */
+static inline unsigned int lengthBytes(unsigned int len)
+{
+    return (len < 15) ? 0 : (1 + (len - 15) / 255);
+}
+
+static unsigned char* putLength(unsigned char* p, unsigned int len)
+{
+    len -= 15;
+    while ( len >= 255 )
+    {
+        *p++ = 255;
+        len -= 255;
+    }
+    *p++ = (unsigned char)len;
+
+    return p;
+}
+
+/* matchLen 0: the closing literals only sequence. -1: out of space */
+static int putSequence(unsigned char* out, unsigned int outLen, unsigned int* op,
+                       const unsigned char* literal, unsigned int literalLen, unsigned int offset, unsigned int matchLen)
+{
+    unsigned int code = 0;
+    unsigned int need = 1 + lengthBytes(literalLen) + literalLen;
+    if ( matchLen != 0 )
+    {
+        code  = matchLen - LZ4_MIN_MATCH;
+        need += 2 + lengthBytes(code);
+    }
+    if ( *op + need > outLen )
+    {
+        return -1;
+    }
+
+    unsigned char* p     = out + *op;
+    unsigned char* token = p++;
+
+    *token = (unsigned char)(((literalLen < 15) ? literalLen : 15) << 4);
+    if ( literalLen >= 15 )
+    {
+        p = putLength(p, literalLen);
+    }
+    memcpy(p, literal, literalLen);
+    p += literalLen;
+
+    if ( matchLen != 0 )
+    {
+        *token |= (unsigned char)((code < 15) ? code : 15);
+        *p++ = (unsigned char)(offset & 0xFF);
+        *p++ = (unsigned char)(offset >> 8);
+        if ( code >= 15 )
+        {
+            p = putLength(p, code);
+        }
+    }
+
+    *op = (unsigned int)(p - out);
+
+    return 0;
+}
+
+/* greedy single probe hash match, sized for one flash sector per call */
+int LZ4Block::Compress(const unsigned char* in, unsigned int inLen, unsigned char* out, unsigned int outLen)
+{
+    if ( in == NULL || out == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    int          table[LZ4_HASH_SIZE];
+    unsigned int ip     = 0;
+    unsigned int anchor = 0;
+    unsigned int op     = 0;
+
+    for ( int i = 0; i < LZ4_HASH_SIZE; i++ )
+    {
+        table[i] = -1;
+    }
+
+    while ( ip + LZ4_MF_LIMIT <= inLen )
+    {
+        unsigned int seq = read32(in + ip);
+        unsigned int h   = hash4(seq);
+        int          ref = table[h];
+
+        table[h] = (int)ip;
+        if ( (ref < 0) || (ip - ref > LZ4_MAX_OFFSET) || (read32(in + ref) != seq) )
+        {
+            ip++;
+            continue;
+        }
+
+        unsigned int matchLen = LZ4_MIN_MATCH;
+        while ( (ip + matchLen < inLen - LZ4_LAST_LITERALS) && (in[ref + matchLen] == in[ip + matchLen]) )
+        {
+            matchLen++;
+        }
+
+        if ( putSequence(out, outLen, &op, in + anchor, ip - anchor, ip - ref, matchLen) < 0 )
+        {
+            return 0;
+        }
+
+        ip    += matchLen;
+        anchor = ip;
+    }
+
+    if ( putSequence(out, outLen, &op, in + anchor, inLen - anchor, 0, 0) < 0 )
+    {
+        return 0;
+    }
+
+    return (int)op;
+}
+
+int LZ4Block::Decompress(const unsigned char* in, unsigned int inLen, unsigned char* out, unsigned int outLen)
+{
+    unsigned int ip = 0;
+    unsigned int op = 0;
+    unsigned int b  = 0;
+
+    if ( in == NULL || out == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    while ( ip < inLen )
+    {
+        unsigned int token = in[ip++];
+
+        /* literals */
+        unsigned int len = (token >> 4);
+        if ( len == 15 )
+        {
+            do
+            {
+                if ( ip >= inLen )
+                {
+                    return -1;
+                }
+                b    = in[ip++];
+                len += b;
+            } while ( b == 255 );
+        }
+        if ( (len > inLen - ip) || (len > outLen - op) )
+        {
+            return -1;
+        }
+        memcpy(out + op, in + ip, len);
+        ip += len;
+        op += len;
+
+        /* the last sequence has no match */
+        if ( ip == inLen )
+        {
+            break;
+        }
+
+        /* match, may overlap what it copies */
+        if ( inLen - ip < 2 )
+        {
+            return -1;
+        }
+        unsigned int offset = in[ip] | (in[ip + 1] << 8);
+        ip += 2;
+        if ( offset == 0 || offset > op )
+        {
+            return -1;
+        }
+
+        len = (token & 0x0F);
+        if ( len == 15 )
+        {
+            do
+            {
+                if ( ip >= inLen )
+                {
+                    return -1;
+                }
+                b    = in[ip++];
+                len += b;
+            } while ( b == 255 );
+        }
+        len += LZ4_MIN_MATCH;
+        if ( len > outLen - op )
+        {
+            return -1;
+        }
+        for ( unsigned int i = 0; i < len; i++, op++ )
+        {
+            out[op] = out[op - offset];
+        }
+    }
+
+    return (int)op;
+}
@@ -0,0 +1,404 @@
+#include <cstdio>
+#include <cstring>
+
+#include <limits.h>
+
+#include "LatencyStats.h"
+
+#include "debug.h"
+
+static const char phaseNames[PHASE_MAX][24] = {
+    "uploader",
+    "baudrate",
+    "prescan",
+    "ukey",
+    "pkf",
+    "sdb",
+    "app",
+    "ukey_lock",
+    "pkf_lock",
+    "duk_lock",
+    "sb_en",
+    "boot_src",
+    "efuse_batch",
+    "device_total",
+    "operator_start",
+    "machine",
+    "operator_remove",
+    "delay"
+};
+
+static const double percentiles[] = { 0.50, 0.90, 0.99 };
+static const int    PERCENTILE_MAX = (sizeof(percentiles) / sizeof(percentiles[0]));
+
+LatencyStats::LatencyStats(void)
+{
+    memset(histogram, 0x00, sizeof(histogram));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_mutex_init(&statsMutex, NULL);
+}
+
+LatencyStats::~LatencyStats(void)
+{
+    pthread_mutex_destroy(&statsMutex);
+}
+
+const char* LatencyStats::GetPhaseName(ePHASE phase)
+{
+    if ( (phase < PHASE_UPLOADER) || (phase >= PHASE_MAX) )
+    {
+        return "unknown";
+    }
+
+    return phaseNames[phase];
+}
+
+ePHASE LatencyStats::GetFailedPhase(const deviceReport_t* report)
+{
+    if ( (report == NULL) || (report->result >= 0) )
+    {
+        return PHASE_MAX;
+    }
+
+    for ( int i = PHASE_UPLOADER; i < PHASE_DEVICE_TOTAL; i++ )
+    {
+        if ( (report->phaseUs[i] < 0) && (report->phaseUs[i] != LATENCY_PHASE_SKIPPED) )
+        {
+            return (ePHASE)i;
+        }
+    }
+
+    return PHASE_DEVICE_TOTAL;
+}
+
+int LatencyStats::getBucket(unsigned long us)
+{
+    if ( us < (unsigned long)(LATENCY_SUB_COUNT * 2) )
+    {
+        return (int)us;
+    }
+
+    int msb   = (int)(sizeof(unsigned long) * 8) - 1 - __builtin_clzl(us);
+    int shift = msb - LATENCY_SUB_BITS;
+    int index = LATENCY_SUB_COUNT * (shift + 1) + (int)(us >> shift) - LATENCY_SUB_COUNT;
+
+    return (index < LATENCY_BUCKET_MAX) ? index : (LATENCY_BUCKET_MAX - 1);
+}
+
+unsigned long LatencyStats::getBucketLow(int index)
+{
+    if ( index < (LATENCY_SUB_COUNT * 2) )
+    {
+        return (unsigned long)index;
+    }
+
+    int shift = (index / LATENCY_SUB_COUNT) - 1;
+    return (unsigned long)((index % LATENCY_SUB_COUNT) + LATENCY_SUB_COUNT) << shift;
+}
+
+unsigned long LatencyStats::getBucketHigh(int index)
+{
+    if ( index < (LATENCY_SUB_COUNT * 2) )
+    {
+        return (unsigned long)index;
+    }
+
+    int shift = (index / LATENCY_SUB_COUNT) - 1;
+    return getBucketLow(index) + (1UL << shift) - 1;
+}
+
+/* highest value equivalent to the bucket the percentile falls in, never above the max seen */
+unsigned long LatencyStats::getPercentile(const latencyHistogram_t* h, double percentile)
+{
+    unsigned int target = (unsigned int)(percentile * h->count + 0.5);
+    unsigned int seen   = 0;
+
+    if ( target < 1 )
+    {
+        target = 1;
+    }
+
+    for ( int i = 0; i < LATENCY_BUCKET_MAX; i++ )
+    {
+        seen += h->bucket[i];
+        if ( seen >= target )
+        {
+            unsigned long high = getBucketHigh(i);
+            return (high < h->maxUs) ? high : h->maxUs;
+        }
+    }
+
+    return h->maxUs;
+}
+
+void LatencyStats::record(int row, ePHASE phase, long us)
+{
+    if ( (row < 0) || (row >= LATENCY_ROW_MAX) || (phase < PHASE_UPLOADER) || (phase >= PHASE_MAX) || (us < 0) )
+    {
+        return;
+    }
+
+    latencyHistogram_t* h = &histogram[row][phase];
+
+    if ( (h->count == 0) || ((unsigned long)us < h->minUs) )
+    {
+        h->minUs = us;
+    }
+    if ( (unsigned long)us > h->maxUs )
+    {
+        h->maxUs = us;
+    }
+    h->sumUs += us;
+    h->bucket[getBucket(us)]++;
+    h->count++;
+}
+
+void LatencyStats::recordFailure(int row, ePHASE phase)
+{
+    if ( (row < 0) || (row >= LATENCY_ROW_MAX) || (phase < PHASE_UPLOADER) || (phase >= PHASE_MAX) )
+    {
+        return;
+    }
+
+    histogram[row][phase].failures++;
+}
+
+void LatencyStats::Record(int row, ePHASE phase, long us)
+{
+    pthread_mutex_lock(&statsMutex);
+    record(row, phase, us);
+    pthread_mutex_unlock(&statsMutex);
+}
+
+void LatencyStats::RecordFailure(int row, ePHASE phase)
+{
+    pthread_mutex_lock(&statsMutex);
+    recordFailure(row, phase);
+    pthread_mutex_unlock(&statsMutex);
+}
+
+/* completed phases go to the histograms, a failed device counts against the phase it stopped in */
+void LatencyStats::RecordReport(int row, const deviceReport_t* report)
+{
+    if ( (report == NULL) || (report->result > 0) )
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&statsMutex);
+    recordReport(row, report);
+    pthread_mutex_unlock(&statsMutex);
+}
+
+void LatencyStats::recordReport(int row, const deviceReport_t* report)
+{
+    ePHASE failed = GetFailedPhase(report);
+
+    for ( int i = PHASE_UPLOADER; i < PHASE_DEVICE_TOTAL; i++ )
+    {
+        if ( i == failed )
+        {
+            recordFailure(row, (ePHASE)i);
+            recordFailure(row, PHASE_DEVICE_TOTAL);
+            return;
+        }
+
+        if ( report->phaseUs[i] >= 0 )
+        {
+            record(row, (ePHASE)i, report->phaseUs[i]);
+        }
+        else
+        if ( (report->phaseUs[i] == LATENCY_PHASE_SKIPPED) && ((report->skipped & PHASE_BIT(i)) != 0) )
+        {
+            histogram[row][i].skips++;
+        }
+    }
+
+    if ( failed == PHASE_DEVICE_TOTAL )
+    {
+        recordFailure(row, PHASE_DEVICE_TOTAL);
+        return;
+    }
+
+    record(row, PHASE_DEVICE_TOTAL, report->phaseUs[PHASE_DEVICE_TOTAL]);
+}
+
+int LatencyStats::dumpCsv(FILE* out)
+{
+    fprintf(out, "socket,phase,count,failures,skipped,min_us,mean_us,p50_us,p90_us,p99_us,max_us\n");
+
+    for ( int row = 0; row < LATENCY_ROW_MAX; row++ )
+    {
+        for ( int phase = PHASE_UPLOADER; phase < PHASE_MAX; phase++ )
+        {
+            const latencyHistogram_t* h = &histogram[row][phase];
+            if ( (h->count == 0) && (h->failures == 0) && (h->skips == 0) )
+            {
+                continue;
+            }
+
+            if ( row == LATENCY_FIXTURE )
+            {
+                fprintf(out, "fixture,");
+            }
+            else
+            {
+                fprintf(out, "%d,", row + 1);
+            }
+            fprintf(out, "%s,%u,%u,%u", phaseNames[phase], h->count, h->failures, h->skips);
+
+            if ( h->count == 0 )
+            {
+                fprintf(out, ",,,,,,\n");
+                continue;
+            }
+
+            fprintf(out, ",%lu,%llu", h->minUs, h->sumUs / h->count);
+            for ( int i = 0; i < PERCENTILE_MAX; i++ )
+            {
+                fprintf(out, ",%lu", getPercentile(h, percentiles[i]));
+            }
+            fprintf(out, ",%lu\n", h->maxUs);
+        }
+    }
+
+    return 0;
+}
+
+/* the summary of dumpCsv() plus the non-empty buckets as [low_us, high_us, count] */
+int LatencyStats::dumpJson(FILE* out)
+{
+    struct timespec now;
+    int             first = 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    fprintf(out, "{\n  \"uptime_s\": %ld,\n  \"unit\": \"us\",\n  \"histograms\": [", (long)(now.tv_sec - start.tv_sec));
+
+    for ( int row = 0; row < LATENCY_ROW_MAX; row++ )
+    {
+        for ( int phase = PHASE_UPLOADER; phase < PHASE_MAX; phase++ )
+        {
+            const latencyHistogram_t* h = &histogram[row][phase];
+            if ( (h->count == 0) && (h->failures == 0) && (h->skips == 0) )
+            {
+                continue;
+            }
+
+            fprintf(out, "%s\n    {", (first != 0) ? "" : ",");
+            first = 0;
+
+            if ( row == LATENCY_FIXTURE )
+            {
+                fprintf(out, "\"socket\": \"fixture\", ");
+            }
+            else
+            {
+                fprintf(out, "\"socket\": %d, ", row + 1);
+            }
+            fprintf(out, "\"phase\": \"%s\", \"count\": %u, \"failures\": %u, \"skipped\": %u", phaseNames[phase], h->count, h->failures, h->skips);
+
+            if ( h->count > 0 )
+            {
+                fprintf(out, ", \"min\": %lu, \"mean\": %llu", h->minUs, h->sumUs / h->count);
+                for ( int i = 0; i < PERCENTILE_MAX; i++ )
+                {
+                    fprintf(out, ", \"p%d\": %lu", (int)(percentiles[i] * 100 + 0.5), getPercentile(h, percentiles[i]));
+                }
+                fprintf(out, ", \"max\": %lu", h->maxUs);
+            }
+
+            fprintf(out, ", \"buckets\": [");
+            int firstBucket = 1;
+            for ( int i = 0; i < LATENCY_BUCKET_MAX; i++ )
+            {
+                if ( h->bucket[i] == 0 )
+                {
+                    continue;
+                }
+                fprintf(out, "%s[%lu, %lu, %u]", (firstBucket != 0) ? "" : ", ", getBucketLow(i), getBucketHigh(i), h->bucket[i]);
+                firstBucket = 0;
+            }
+            fprintf(out, "]}");
+        }
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+
+    return 0;
+}
+
+/*
+ * written to a temp file and renamed, a reader never sees half a dump.
+ * a cycle recording meanwhile waits for the dump, which never sees half a report.
+ */
+int LatencyStats::Dump(const char* basePath)
+{
+    char  path[PATH_MAX];
+    char  tempPath[PATH_MAX];
+    FILE* out = NULL;
+    int   ret = 0;
+
+    if ( basePath == NULL || basePath[0] == '\0' )
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&statsMutex);
+
+    for ( int i = 0; i < 2; i++ )
+    {
+        int pathLen = snprintf(path, sizeof(path), "%s.%s", basePath, (i == 0) ? "csv" : "json");
+        int tempLen = snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+        if ( (pathLen >= (int)sizeof(path)) || (tempLen >= (int)sizeof(tempPath)) )
+        {
+            DBG_ERR("%s: path too long", basePath);
+            ret = -1;
+            break;
+        }
+
+        out = fopen(tempPath, "w");
+        if ( out == NULL )
+        {
+            DBG_ERR("%s open error", tempPath);
+            ret = -1;
+            continue;
+        }
+
+        if ( i == 0 )
+        {
+            dumpCsv(out);
+        }
+        else
+        {
+            dumpJson(out);
+        }
+
+        if ( fclose(out) != 0 || rename(tempPath, path) != 0 )
+        {
+            DBG_ERR("%s write error", path);
+            ret = -1;
+        }
+    }
+
+    pthread_mutex_unlock(&statsMutex);
+
+    return ret;
+}
+
+int LatencyStats::DumpJson(FILE* out)
+{
+    int ret = -1;
+
+    if ( out == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    pthread_mutex_lock(&statsMutex);
+    ret = dumpJson(out);
+    pthread_mutex_unlock(&statsMutex);
+
+    return ret;
+}
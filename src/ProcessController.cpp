@@ -3,75 +3,74 @@
 #include <cstring>
 
 #include <unistd.h>
+#include <time.h>
 
 #include "CRC32.h"
 #include "ProcessController.h"
 
 #include "debug.h"
-#define MINIINI_NO_STL
-#include "ini.h"
-
-#define CONFIG_LINE_BUFFER_SIZE    (1024)
-
-static const char eFuseKeyParams[EFUSE_TYPE_MAX][64] = {
-    "[BOOTSOURCE]",
-    "[SECUREBOOTENABLE]",
-    "[UKEYLOCK]",
-    "[PKFLOCK]",
-    "[DUKLOCK]",
-	"[PKFWRITE]",
-    "[UKEY]",
-    "[PKF]"
-};
 
-/* addresses and sizes */
-static const unsigned int SRAM_BASE_ADDR        = (0x20000000);
-static const unsigned int FLASH_BASE_ADDR       = (0x30000000);
-static const unsigned int PKA_BASE_ADDR         = (FLASH_BASE_ADDR + 0x10000);
-static const unsigned int PKA_FW_IV_ADDR        = (PKA_BASE_ADDR + 0x0000);
-static const unsigned int PKA_AKEY_ADDR         = (PKA_BASE_ADDR + 0x0400);
-static const unsigned int PKA_CURVE_PARAM_ADDR  = (PKA_BASE_ADDR + 0x0800);
-static const unsigned int PKA_CLP300_FW_ADDR    = (PKA_BASE_ADDR + 0x1000);
-static const unsigned int APP_BASE_ADDR         = (FLASH_BASE_ADDR + 0x20000);
-static const unsigned int APP_SIGNATURE_S_ADDR  = (APP_BASE_ADDR + 0x0000);
-static const unsigned int APP_SIGNATURE_R_ADDR  = (APP_BASE_ADDR + 0x0400);
-static const unsigned int APP_SIZE_ADDR         = (APP_BASE_ADDR + 0x0800);
-static const unsigned int APP_IMAGE_BASE_ADDR   = (APP_BASE_ADDR + 0x2000);
-static const unsigned int SDB_INFO_ADDR         = (FLASH_BASE_ADDR + 0x0300000);
-static const unsigned int FLASH_SECTOR_SIZE     = (0x1000);
-static const unsigned int FLASH_BLOCK_SIZE      = (0x10000);
-
-
-/* uploader binary prefix */
-static const unsigned char UPLOADER_BINARY_PREFIX[4] = {
-    (unsigned char)('e'),
-    (unsigned char)('W'),
-    (unsigned char)('B'),
-    (unsigned char)('M')
+/* fields of the eFuse batch, in the order the single field path burns them */
+static const eEFUSETYPE eFuseBatchTypes[] = {
+    EFUSE_TYPE_UKEY_LOCK,
+    EFUSE_TYPE_PKF_LOCK,
+    EFUSE_TYPE_DUK_LOCK,
+    EFUSE_SB_EN,
+    EFUSE_BOOT_SRC
 };
+static const int EFUSE_BATCH_TYPE_COUNT = (sizeof(eFuseBatchTypes) / sizeof(eFuseBatchTypes[0]));
+
+/* HOTRELOAD: a copy in progress settles this long before it is staged, the stop flag is seen this often */
+static const int RELOAD_QUIET_MS = (500);
+static const int RELOAD_POLL_MS  = (1000);
+
+static const int          SDB_SKIP_MAX          = (32);     /* SDB entries the pre-scan can skip */
+static const unsigned int FLASH_DELTA_SECTOR_MAX = (4096);  /* larger regions are always sent whole */
+
+/* response deadlines(ms), the wire time of the bytes just sent is added on top */
+static const int TX_TIMEOUT_MARGIN_MS       = (100);
+static const int ACK_TIMEOUT_MS             = (20);
+static const int UPLOADER_START_TIMEOUT_MS  = (2000);
+static const int EFUSE_WRITE_TIMEOUT_MS     = (200);
+static const int EFUSE_READ_TIMEOUT_MS      = (100);
+static const int FLASH_ERASE_TIMEOUT_MS     = (10000);  /* first sector: region erase + program */
+static const int FLASH_PROGRAM_TIMEOUT_MS   = (1000);
+static const int FLASH_SECTOR_ERASE_TIMEOUT_MS = (500);  /* delta: every sector erased on its own */
+static const int SDB_WRITE_TIMEOUT_MS       = (5000);
+static const int CRC_TIMEOUT_MS             = (1000);   /* device CRC of a region/SDB entry */
+static const int PING_RETRY_MAX             = (3);
+static const int SDB_CHUNK_RETRY_MAX        = (3);      /* NAKs of one SDB chunk before the device fails */
+
+
+static inline long diffMs(const struct timespec* from, const struct timespec* to)
+{
+    return (to->tv_sec - from->tv_sec) * 1000L + (to->tv_nsec - from->tv_nsec) / 1000000L;
+}
+
+static inline long diffUs(const struct timespec* from, const struct timespec* to)
+{
+    return (to->tv_sec - from->tv_sec) * 1000000L + (to->tv_nsec - from->tv_nsec) / 1000L;
+}
+
+/* closes the phase that started at mark, the next one starts now */
+static inline void markPhase(deviceReport_t* report, ePHASE phase, struct timespec* mark)
+{
+    struct timespec now;
 
-#pragma pack(push, 1)
-typedef struct _FirmwareImageFileHeader_t {
-    unsigned char  prefix[5];
-    unsigned char  sbEnEnabled;
-    unsigned int   codeSize;
-    unsigned int   totalSize;
-} FirmwareImageFileHeader_t;
-#pragma pack(pop)
-
-#pragma pack(push, 1)
-typedef struct SDBInfoFile_t{
-    unsigned char path[128];
-    unsigned int  option;
-    unsigned int  datasize;
-    unsigned char data[1];
-} SDBInfoFile_t;
-#pragma pack(pop)
-
-/* eFuse read length */
-static const unsigned int eFuseLength[EFUSE_TYPE_MAX] = {1, 1, 1, 1, 1, 1, 32, 32};
-
-ProcessController::ProcessController(const char* device, const int baudrate)
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    report->phaseUs[phase] = diffUs(mark, &now);
+    *mark = now;
+}
+
+/* a phase the pre-scan found already programmed, not timed */
+static inline void skipPhase(deviceReport_t* report, ePHASE phase, struct timespec* mark)
+{
+    report->phaseUs[phase] = LATENCY_PHASE_SKIPPED;
+    report->skipped |= PHASE_BIT(phase);
+    clock_gettime(CLOCK_MONOTONIC, mark);
+}
+
+ProcessController::ProcessController(const char* device, const int baudrate, const char* gpioBackend)
 {
     comm = NULL;
     gpio = NULL;
@@ -79,46 +78,75 @@ ProcessController::ProcessController(const char* device, const int baudrate)
     configFileName   = NULL;
     uploaderFileName = NULL;
     appImageFileName = NULL;
+    sdbInfoFileName  = NULL;
 
-    uploaderBinary = NULL;
-    uploaderBinarySize = 0;
-
-    secureBootEnabled = 0;
-
-    pkaBinary = NULL;
-    pkaBinarySize = 0;
-
-    signatureBinary = NULL;
-    signatureBinarySize = 0;
+    delayUs = 0;
+    memset(&readyEdge,  0x00, sizeof(readyEdge));
+    memset(&startEdge,  0x00, sizeof(startEdge));
+    memset(&doneTime,   0x00, sizeof(doneTime));
+    memset(&removeEdge, 0x00, sizeof(removeEdge));
 
-    sdbCodeBinary = NULL;
-    sdbCodePacket = NULL;
-    sdbCodeBinarySize = 0;
-    sdbCodePacketSize = 0;
-    appCodeBinary = NULL;
-    appCodeBinarySize = 0;
-    appImageTotalSize = 0;
-
-    eFuseBootSource = 0x00;
-    eFuseSecureBootEnable = 0;
-    eFuseUKeyLock = 0;
-    eFusePKfLock  = 0;
-    eFuseDUKLock  = 0;
-    memset(eFuseUKey, 0x00, sizeof(eFuseUKey));
-    memset(eFusePKf,  0x00, sizeof(eFusePKf));
+    this->baudrate   = baudrate;
+    parallelDownload = 0;
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
+    {
+        socketComm[i] = NULL;
+    }
 
     comm = new SerialComm(device, baudrate);
-    gpio = new GPIOControl();
+    gpio = new GPIOControl(gpioBackend);
+
+    statsFileName = NULL;
+    stats = new LatencyStats();
+    resetReport();
+
+    resultFileName = NULL;
+    resultLog = new ResultLog();
+    cycle = 0;
+
+    planFileName = NULL;
+    set          = NULL;
+    staged       = NULL;
+
+    watcher       = NULL;
+    reloadStarted = 0;
+    reloadStop    = 0;
+    generation    = 0;
+    pthread_mutex_init(&reloadMutex, NULL);
+    pthread_mutex_init(&loadMutex, NULL);
 }
 
 ProcessController::~ProcessController()
 {
+    /* a staging build in progress finishes first */
+    if ( reloadStarted != 0 )
+    {
+        reloadStop = 1;
+        reloadWorker.ThreadJoin();
+        reloadStarted = 0;
+    }
+
+    if ( watcher != NULL )
+    {
+        delete watcher;
+        watcher = NULL;
+    }
+
     if ( comm != NULL )
     {
         delete comm;
         comm = NULL;
     }
 
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
+    {
+        if ( socketComm[i] != NULL )
+        {
+            delete socketComm[i];
+            socketComm[i] = NULL;
+        }
+    }
+
     if ( configFileName != NULL )
     {
         delete[] configFileName;
@@ -137,45 +165,64 @@ ProcessController::~ProcessController()
         appImageFileName = NULL;
     }
 
-    if ( uploaderBinary != NULL && uploaderBinarySize != 0 )
+    if ( sdbInfoFileName != NULL )
     {
-        delete[] uploaderBinary;
-        uploaderBinary     = NULL;
-        uploaderBinarySize = 0;
+        delete[] sdbInfoFileName;
+        sdbInfoFileName = NULL;
     }
 
-    if ( pkaBinary != NULL && pkaBinarySize != 0 )
+    if ( staged != NULL )
     {
-        delete[] pkaBinary;
-        pkaBinary     = NULL;
-        pkaBinarySize = 0;
+        delete staged;
+        staged = NULL;
     }
 
-    if ( signatureBinary != NULL && signatureBinarySize != 0 )
+    if ( set != NULL )
     {
-        delete[] signatureBinary;
-        signatureBinary     = NULL;
-        signatureBinarySize = 0;
+        delete set;
+        set = NULL;
     }
 
-    if ( appCodeBinary != NULL && appCodeBinarySize != 0 )
+    if ( planFileName != NULL )
     {
-        delete[] appCodeBinary;
-        appCodeBinary     = NULL;
-        appCodeBinarySize = 0;
+        delete[] planFileName;
+        planFileName = NULL;
     }
-    
-    if ( sdbCodePacket != NULL && sdbCodePacketSize != 0 )
+
+    if ( stats != NULL )
+    {
+        DumpStats();
+        delete stats;
+        stats = NULL;
+    }
+
+    if ( statsFileName != NULL )
+    {
+        delete[] statsFileName;
+        statsFileName = NULL;
+    }
+
+    if ( resultLog != NULL )
     {
-        delete[] sdbCodePacket;
-        sdbCodePacket     = NULL;
-        sdbCodePacketSize = 0;
+        delete resultLog;
+        resultLog = NULL;
     }
+
+    if ( resultFileName != NULL )
+    {
+        delete[] resultFileName;
+        resultFileName = NULL;
+    }
+
+    pthread_mutex_destroy(&loadMutex);
+    pthread_mutex_destroy(&reloadMutex);
 }
 
+/* a name set again replaces the previous one, ProcessInit() picks it up */
 int ProcessController::SetName(eFILETYPE type, const char* in)
 {
     size_t inLen = 0;
+    char** name  = NULL;
 
     if ( in == NULL )
     {
@@ -194,32 +241,46 @@ int ProcessController::SetName(eFILETYPE type, const char* in)
     {
         case FILE_NAME_CONF:
             {
-                configFileName = new char[(inLen + 1)] {0,};
-                strncpy(configFileName, in, inLen);
+                name = &configFileName;
             }
             break;
 
         case FILE_NAME_UPLOADER:
             {
-                uploaderFileName = new char[(inLen + 1)] {0,};
-                strncpy(uploaderFileName, in, inLen);
+                name = &uploaderFileName;
             }
             break;
 
         case FILE_NAME_APPIMAGE:
             {
-                appImageFileName = new char[(inLen + 1)] {0,};
-                strncpy(appImageFileName, in, inLen);
+                name = &appImageFileName;
             }
             break;
             
         case FILE_NAME_SDBINFO:
             {
-                sdbInfoFileName = new char[(inLen + 1)] {0,};
-                strncpy(sdbInfoFileName, in, inLen);
+                name = &sdbInfoFileName;
             }
         break;
 
+        case FILE_NAME_STATS:
+            {
+                name = &statsFileName;
+            }
+            break;
+
+        case FILE_NAME_RESULT:
+            {
+                name = &resultFileName;
+            }
+            break;
+
+        case FILE_NAME_PLAN:
+            {
+                name = &planFileName;
+            }
+            break;
+
         default:
             {
                 DBG_ERR("error!!!");
@@ -227,1271 +288,1097 @@ int ProcessController::SetName(eFILETYPE type, const char* in)
             return -1;
     }
 
+    if ( *name != NULL )
+    {
+        delete[] *name;
+    }
+    *name = new char[(inLen + 1)] {0,};
+    memcpy(*name, in, inLen);
+
     return 0;
 }
 
-
-
-int ProcessController::parseSdb(int index)
+/* a set of its own from these files, NULL: it did not load. the caller holds loadMutex */
+ImageSet* ProcessController::loadSet(const char* conf, const char* uploader, const char* image, const char* sdbInfo)
 {
     int ret = -1;
-    int sdbinfoSize = 0;
-    char section[128] = {0,};
-    ini_t* sdb = ini_load(sdbInfoFileName);
-    if(sdb == NULL)
+
+    ImageSet* next = new ImageSet();
+
+    ret = next->SetName(FILE_NAME_CONF, conf);
+    if ( ret == 0 )
     {
-        DBG_ERR("sdbinfo is NULL");
-        return -1;
+        ret = next->SetName(FILE_NAME_UPLOADER, uploader);
     }
-    
-    sprintf(section, "SDB_%d", index);
-    const char* path = ini_get(sdb, section, "Path");
-    if ( path == NULL )
+    if ( ret == 0 )
     {
-        ini_free(sdb);
-        return 1;
+        ret = next->SetName(FILE_NAME_APPIMAGE, image);
     }
-    
-    const char* option = ini_get(sdb, section, "Option");
-    const char* data = ini_get(sdb, section, "Data");
-    FILE* appImageFile = NULL;
-    appImageFile = fopen(data, "r");
-    if ( appImageFile == NULL )
+    if ( ret == 0 )
     {
-        DBG_ERR("%s, file(%s) open error", __FUNCTION__);
-        return -1;
+        ret = next->SetName(FILE_NAME_SDBINFO, sdbInfo);
+    }
+    if ( ret == 0 && planFileName != NULL )
+    {
+        ret = next->SetName(FILE_NAME_PLAN, planFileName);
+    }
+    if ( ret == 0 )
+    {
+        ret = next->Load();
     }
-    
-    /* Get Uploader File Size */
-    int appImageSize = 0;
-    ret = fseek(appImageFile, 0, SEEK_END);
     if ( ret != 0 )
     {
-        if ( appImageFile != NULL )
-        {
-            fclose(appImageFile);
-            appImageFile = NULL;
-        }
-        DBG_ERR("error!!!");
-        return -1;
+        delete next;
+        return NULL;
     }
-    
-    appImageSize = ftell(appImageFile);
-    if ( appImageSize < 0 )
+
+    return next;
+}
+
+/*
+ * the only way a set goes live, between cycles: gpio and ports are set up for it, the
+ * pointer is swapped under reloadMutex and the set it replaced is freed after that.
+ */
+void ProcessController::swapSet(ImageSet* next)
+{
+    ImageSet* old = NULL;
+
+    gpio->SetDebounce(next->gpioDebounceMs);
+    gpio->SetTiming(&next->timing);
+
+    /* socket topology: every socket on its own UART, or all of them on the UART mux. a port is only
+       replaced when its device changed, the open session of an unchanged one carries over */
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
     {
-        if ( appImageFile != NULL )
+        const char* from = (set != NULL) ? set->socketDeviceName[i] : NULL;
+        const char* to   = next->socketDeviceName[i];
+
+        if ( (from == NULL && to == NULL) || (from != NULL && to != NULL && !strcmp(from, to)) )
         {
-            fclose(appImageFile);
-            appImageFile = NULL;
+            continue;
         }
-        DBG_ERR("error!!!");
-        return -1;
-    }
-    
-    rewind(appImageFile);
-    ret = ftell(appImageFile);
-    if ( ret != SEEK_SET )
-    {
-        if ( appImageFile != NULL )
+
+        if ( socketComm[i] != NULL )
         {
-            fclose(appImageFile);
-            appImageFile = NULL;
+            delete socketComm[i];
+            socketComm[i] = NULL;
+        }
+        if ( to != NULL )
+        {
+            socketComm[i] = new SerialComm(to, baudrate);
+            DBG_LOG("socket#%d: %s", i, to);
         }
-        DBG_ERR("error!!!");
-        return -1;
     }
-    unsigned int sdbDataSize = 0;
-    sdbDataSize = appImageSize;
-    unsigned char* sdbDataBuffer = NULL;
-    
-    sdbDataBuffer = new unsigned char[sdbDataSize] {0,};
-    
-    ret = fread(sdbDataBuffer, 1, sdbDataSize, appImageFile);
-    if ( ret != sdbDataSize )
+    parallelDownload = (next->socketDeviceName[SOCKET_CH1] != NULL) ? 1 : 0;
+
+    pthread_mutex_lock(&reloadMutex);
+    old = set;
+    set = next;
+    generation++;
+    pthread_mutex_unlock(&reloadMutex);
+
+    if ( old != NULL )
+    {
+        delete old;
+    }
+
+    DBG_LOG("image set generation %u in use", generation);
+
+    /* armed for the set that loaded, never for one that might not */
+    armWatcher();
+}
+
+int ProcessController::armWatcher(void)
+{
+    int ret = -1;
+
+    if ( set->hotReload == 0 )
+    {
+        return (watcher != NULL) ? watcher->Watch(NULL, 0) : 0;
+    }
+
+    if ( watcher == NULL )
     {
-        if ( sdbDataBuffer != NULL )
+        watcher = new ImageWatcher();
+        ret = watcher->Open();
+        if ( ret == 0 )
         {
-            delete[] sdbDataBuffer;
-            sdbDataBuffer = NULL;
-            sdbDataSize = 0;
+            ret = reloadWorker.ThreadStart(this, true);
         }
-        if ( appImageFile != NULL )
+        if ( ret < 0 )
         {
-            fclose(appImageFile);
-            appImageFile = NULL;
+            DBG_ERR("hot reload not available");
+            delete watcher;
+            watcher = NULL;
+            return -1;
         }
-        DBG_ERR("error!!!");
-        return -1;
+        reloadStarted = 1;
     }
-    
-    sdbCodePacketSize = ( sdbDataSize + 128 + 4 + 4 );
-    
-    if ( sdbCodePacket != NULL )
-        delete[] sdbCodePacket;
-    
-    sdbCodePacket = new unsigned char[sdbCodePacketSize] {0,};
-    
-    SDBInfoFile_t* sdbinfo = (SDBInfoFile_t*)sdbCodePacket;
-    
-    memcpy(sdbinfo->path, path, strlen(path));
-    sdbinfo->option = atoi(option);
-    sdbinfo->datasize = sdbDataSize;
-    memcpy(sdbinfo->data, sdbDataBuffer, sdbDataSize);
-    memcpy(sdbCodePacket, (unsigned char*)sdbinfo, sdbCodePacketSize);
-    
-    
-#ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[SDB Data]");
-    DBG_LOG("-PARAMS--------------+-VALUES-----");
-    if ( sdbinfo->datasize > 0 )
+
+    const char* paths[] = { set->configFileName, set->uploaderFileName, set->appImageFileName, set->sdbInfoFileName };
+    return watcher->Watch(paths, sizeof(paths) / sizeof(paths[0]));
+}
+
+void ReloadWorker::customThread(void* param)
+{
+    ProcessController* controller = (ProcessController*)param;
+
+    while ( controller->reloadStop == 0 )
     {
-        fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
-        fprintf(stdout, "   data              | ");
-        for ( int i = 0; i < 16; i++ )
+        if ( controller->watcher->Wait(RELOAD_QUIET_MS, RELOAD_POLL_MS) > 0 )
         {
-            fprintf(stdout, "%02X", sdbinfo->data[i]);
+            controller->stageReload();
         }
-        fprintf(stdout, "\n");
     }
-    DBG_LOG("   path              | %s", sdbCodePacket);
-    DBG_LOG("   option            | %d", sdbinfo->option);
-    DBG_LOG("   datasize          | %d", sdbinfo->datasize);
-    DBG_LOG("---------------------+------------");
-#endif
+}
 
-    if(sdbDataBuffer != NULL)
+/*
+ * the changed files are checked, CRCed and compiled into a set of their own while cycles
+ * keep running on the one in use, the next cycle only swaps the pointer.
+ */
+int ProcessController::stageReload(void)
+{
+    ImageSet* next = NULL;
+
+    /* held until staged is set, a recipe switched meanwhile would be undone by this set */
+    pthread_mutex_lock(&loadMutex);
+
+    next = loadSet(configFileName, uploaderFileName, appImageFileName, sdbInfoFileName);
+    if ( next == NULL )
     {
-        delete[] sdbDataBuffer;
-        sdbDataBuffer = NULL;
+        pthread_mutex_unlock(&loadMutex);
+        DBG_ERR("image set refused, the one in use stays");
+        return -1;
     }
-    
-    if ( appImageFile != NULL )
+
+    pthread_mutex_lock(&reloadMutex);
+    if ( staged != NULL )
     {
-        fclose(appImageFile);
-        appImageFile = NULL;
+        delete staged;
     }
-    
-    ini_free(sdb);
-    
+    staged = next;
+    DBG_LOG("image set staged, generation %u from the next cycle", generation + 1);
+    pthread_mutex_unlock(&reloadMutex);
+
+    pthread_mutex_unlock(&loadMutex);
+
     return 0;
 }
 
-void ProcessController::swapPkf(unsigned char* arr, int first, int second)
+/* between cycles: a staged set is swapped in, one still being staged waits for a later cycle */
+void ProcessController::applyReload(void)
 {
-	unsigned char temp;
+    ImageSet* next = NULL;
 
-	temp = arr[first];
-	arr[first] = arr[second];
-	arr[second] = temp;
+    pthread_mutex_lock(&reloadMutex);
+    next   = staged;
+    staged = NULL;
+    pthread_mutex_unlock(&reloadMutex);
+
+    if ( next != NULL )
+    {
+        swapSet(next);
+    }
 }
 
-int ProcessController::keyStringTohexArray(eEFUSETYPE type, const char* in)
+int ProcessController::sendUploaderFile(SerialComm* port)
 {
-    int ret = -1;
-    int inLen = 0;	
-	int removeCharLen = 0;
-	char endChar = 5;
-	char removeChar[65] = {0,};
-	
-	inLen = strlen(in);
-	if(inLen == 66)
-	{		
-		DBG_LOG("PKF Swap Mode");
-		endChar = in[inLen-1];
-		DBG_LOG("endChar: %c", endChar);
-		
-		memcpy(removeChar, in, 64);
-		removeCharLen = strlen(removeChar);		
-		if(removeCharLen != 64)
-		{
-			DBG_ERR("removecharLen: %d", removeCharLen);
-			DBG_ERR("removeChar: %s", removeChar);
-			return -1;
-		}
-	}
-	else
-	if(inLen == 64)
-	{
-		DBG_LOG("PKF None Swap Mode");
-		
-		removeCharLen = 64;
-		memcpy(removeChar, in, 64);
-	}
-	else
-	{
-		DBG_ERR("Error 111111");
-		return -1;
-	}
-	
-	
-    /* check type */
-    unsigned char* hexArray = NULL;
-    switch ( type )
-    {
-        case EFUSE_TYPE_UKEY:
-            {
-                hexArray = eFuseUKey;
-                ret = 0;
-            }
-            break;
+    /* send packet: uploader + prefix + size, gathered straight from the uploader binary */
+    unsigned int sendPacketSize = 0;
+    sendPacketSize = set->uploaderBinarySize + sizeof(UPLOADER_BINARY_PREFIX) + sizeof(set->uploaderBinarySize);
 
-        case EFUSE_TYPE_PKF:
-            {
-                hexArray = eFusePKf;
-                ret = 0;
-            }
-            break;
+    struct iovec sendPacket[3];
+    sendPacket[0].iov_base = (void*)set->uploaderBinary;
+    sendPacket[0].iov_len  = set->uploaderBinarySize;
+    sendPacket[1].iov_base = (void*)UPLOADER_BINARY_PREFIX;
+    sendPacket[1].iov_len  = sizeof(UPLOADER_BINARY_PREFIX);
+    sendPacket[2].iov_base = (void*)&set->uploaderBinarySize;
+    sendPacket[2].iov_len  = sizeof(set->uploaderBinarySize);
 
-        default:
-            {
-                DBG_ERR("error!!!");
-                ret = -1;
-            }
-            break;
-    }
-    if ( ret != 0 )
-    {
-        DBG_ERR("error!!!");
-        return -1;
-    }
+    /* SEND PACKET header, crc done at ProcessInit */
+    cmdPacketHeader_t sendPacketHeader = set->uploaderHeader;
+
+#ifdef __MP_DEBUG_BUILD__
+    DBG_LOG("[UART2SRAM packet]");
+    DBG_LOG("-PARAMS-----+-VALUES-----");
+    DBG_LOG("       sync | 0x%02X", sendPacketHeader.sync);
+    DBG_LOG("       type | 0x%02X", sendPacketHeader.type);
+    DBG_LOG("       addr | 0x%08X", sendPacketHeader.param);
+    DBG_LOG(" dwn length | 0x%08X", sendPacketHeader.size[0]);
+    DBG_LOG(" app length | 0x%08X", sendPacketHeader.size[1]);
+    DBG_LOG("        crc | 0x%08X", sendPacketHeader.crc);
+    DBG_LOG("------------+------------\n");
+#endif
+
+    int sentBytes = 0;
+    int readBytes = 0;
+    unsigned char responseBuffer[128] = {0,};
+    response_t* response = (response_t*)responseBuffer;
+
+    /*
+     * the ROM acks the header as soon as it runs after the reset. with romProbeMs the header is
+     * resent until it answers instead of relying on a fixed wait after the reset.
+     */
+    struct timespec probeStart;
+    struct timespec probeNow;
+    int             probes = 0;
 
-    /* convert: string(char array) => hex(unsigned char array) */
-    memset(hexArray, 0, 32);
-    for ( int i = 0; i < removeCharLen; i++ )
+    clock_gettime(CLOCK_MONOTONIC, &probeStart);
+    while ( 1 )
     {
-        /* a(10)~f(15) => A(10)~F(15)  */
-        if ( removeChar[i] >= 'a' && removeChar[i] <= 'f' )
+        /* send header */
+        sentBytes = port->Send((const unsigned char *)&sendPacketHeader, sizeof(cmdPacketHeader_t),
+                               port->GetTransferTimeMs(sizeof(cmdPacketHeader_t)) + TX_TIMEOUT_MARGIN_MS);
+        if ( sentBytes < 0 )
         {
-            removeChar[i] -= ('a' - 'A');
+            DBG_ERR("error!!!");
+            return -1;
         }
+        probes++;
 
-        /* case #1: A ~ F */
-        if ( removeChar[i] >= 'A' && removeChar[i] <= 'F' )
-        {
-            /* Even, 0xA0 ~ 0xF0 */
-            if ( i % 2 == 0 )
-            {
-                hexArray[i/2] = (removeChar[i]-('A'-0xA))<<4;
-            }
-            /* Odd, 0xA ~ 0xF */
-            else
-            {
-                hexArray[i/2] |= (removeChar[i]-('A'-0xA));
-            }
-        }
-        /* case #2: 0 ~ 9 */
-        else if( removeChar[i] >= '0' && removeChar[i] <= '9' )
+        /* receive response, a timeout is no answer yet while probing */
+        memset(responseBuffer, 0x00, sizeof(responseBuffer));
+        readBytes = port->Receive(responseBuffer, 4, port->GetTransferTimeMs(sizeof(cmdPacketHeader_t)) + ACK_TIMEOUT_MS);
+
+        clock_gettime(CLOCK_MONOTONIC, &probeNow);
+        if ( (readBytes > 0) || (diffMs(&probeStart, &probeNow) >= set->timing.romProbeMs) )
         {
-            /* Even, 0x00 ~ 0x90 */
-            if ( i % 2 == 0 )
-            {
-                hexArray[i/2] = (removeChar[i]-('0'-0))<<4;
-            }
-            /* Odd, 0x00 ~ 0x09 */
-            else
-            {
-                hexArray[i/2] |= (removeChar[i]-('0'-0));
-            }
+            break;
         }
-        /* invalid key string */
-        else
-        {
 
-            DBG_ERR("error!!!");
-            return -1;
-        }
+        /* a header the ROM caught half of is dropped by its packet timeout, so is ours */
+        port->Flush();
     }
-	
-	switch (endChar)
-	{
-		case '0':
-			swapPkf(hexArray, 3, 7);
-			swapPkf(hexArray, 16, 22);
-			swapPkf(hexArray, 25, 29);
-			break;
-		case '1':
-			swapPkf(hexArray, 4, 26);
-			swapPkf(hexArray, 6, 18);
-			swapPkf(hexArray, 12, 20);
-			break;
-		case '2':
-			swapPkf(hexArray, 5, 14);
-			swapPkf(hexArray, 11, 18);
-			swapPkf(hexArray, 3, 30);
-			break;
-		case '3':
-			swapPkf(hexArray, 2, 13);
-			swapPkf(hexArray, 7, 21);
-			swapPkf(hexArray, 15, 17);
-			break;
-		default:
-			break;
-	}
-	
-    return 0;
-}
 
-int ProcessController::parseValue(eEFUSETYPE type, const char* in)
-{
-    int ret = -1;
-
-    /* check key type */
-    if ( (type < EFUSE_BOOT_SRC) || (type >= EFUSE_TYPE_MAX) )
+    if ( readBytes < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    switch ( type )
+    if ( probes > 1 )
     {
-        case EFUSE_BOOT_SRC:
-            {
-                /* param is empty */
-                if ( in == NULL )
-                {
-                    eFuseBootSource = 0;
-                    ret = 0;
-                }
-
-                /* set boot source value */
-                const char bootSrcString[6][64] = {
-                    "ExternalPins",    /* 0b000, 0 */
-                    "SPIDirect1",      /* 0b100, 4 */
-                    "SPIDirect2",      /* 0b101, 5 */
-                    "SPIDirect3",      /* 0b110, 6 */
-                    "SRAM",            /* 0b111, 7 */
-                    "ROM"              /* 0b001, 0 */
-                };
-                const unsigned char bootSrcValue[6] = {0, 4, 5, 6, 7, 0};
-
-                /* check param, set boot source value */
-                for ( unsigned int i = 0; i < 6; i++ )
-                {
-                    if ( !strcmp(in, bootSrcString[i]) )
-                    {
-                        eFuseBootSource = (bootSrcValue[i]&0x07);
-                        ret = 0;
-                        break;
-                    }
-                }
-            }
-            break;
+        DBG_LOG("ROM ready after %d probes, %ld ms", probes, diffMs(&probeStart, &probeNow));
+    }
 
-        case EFUSE_SB_EN:
-            {
-                /* param is 'n' or empty: disable */
-                if ( (in == NULL) || !strcmp(in, "n") )
-                {
-                    eFuseSecureBootEnable = 0;
-                    ret = 0;
-                }
-                /* param is 'y': enable */
-                else if ( !strcmp(in, "y") )
-                {
-                    eFuseSecureBootEnable = 1;
-                    ret = 0;
-                }
-                else
-                {
-                    DBG_ERR("error!!!");
-                    ret = -1;
-                }
-            }
-            break;
-
-        case EFUSE_TYPE_UKEY_LOCK:
-            {
-                /* param is 'n' or empty: disable */
-                if ( (in == NULL) || !strcmp(in, "n") )
-                {
-                    DBG_LOG("UKEY_N");
-                    eFuseUKeyLock = 0;
-                    ret = 0;
-                }
-                /* param is 'y': enable */
-                else if ( !strcmp(in, "y") )
-                {
-                    DBG_LOG("UKEY_Y");
-                    eFuseUKeyLock = 1;
-                    ret = 0;
-                }
-                else
-                {
-                    DBG_ERR("error!!!");
-                    ret = -1;
-                }
-            }
-            break;
-
-        case EFUSE_TYPE_PKF_LOCK:
-            {
-                /* param is 'n' or empty: disable */
-                if ( (in == NULL) || !strcmp(in, "n") )
-                {
-                    DBG_LOG("PKF_N");
-                    eFusePKfLock = 0;
-                    ret = 0;
-                }
-                /* param is 'y': enable */
-                else if ( !strcmp(in, "y") )
-                {
-                    DBG_LOG("PKF_Y");
-                    eFusePKfLock = 1;
-                    ret = 0;
-                }
-                else
-                {
-                    DBG_ERR("error!!!");
-                    ret = -1;
-                }
-            }
-            break;
-
-        case EFUSE_TYPE_DUK_LOCK:
-            {
-                /* param is 'n' or empty: disable */
-                if ( (in == NULL) || !strcmp(in, "n") )
-                {
-                    DBG_LOG("DUK_N");
-                    eFuseDUKLock = 0;
-                    ret = 0;
-                }
-                /* param is 'y': enable */
-                else if ( !strcmp(in, "y") )
-                {
-                    DBG_LOG("DUK_Y");
-                    eFuseDUKLock = 1;
-                    ret = 0;
-                }
-                else
-                {
-                    DBG_ERR("error!!!");
-                    ret = -1;
-                }
-            }
-            break;
-
-        case EFUSE_TYPE_UKEY:
-			{
-                if ( in == NULL )
-                {
-                    ret = 0;
-                    break;
-                }
-                ret = keyStringTohexArray(type, in);
-                if ( ret < 0 )
-                {
-                    DBG_ERR("error!!!");
-                    ret = -1;
-                }
-            }
-        case EFUSE_TYPE_PKF:
-            {
-                if ( in == NULL )
-                {
-                    ret = 0;
-                    break;
-                }
-                ret = keyStringTohexArray(type, in);
-                if ( ret < 0 )
-                {
-                    DBG_ERR("error!!!");
-                    ret = -1;
-                }
-            }
-            break;
-			
-		case EFUSE_WRITE_PKF:
-			{
-				/* param is 'n' or empty: disable */
-                if ( (in == NULL) || !strcmp(in, "n") )
-                {
-                    DBG_LOG("PKF_WRITE_N");
-                    eFusePKfWrite = 0;
-                    ret = 0;
-                }
-                /* param is 'y': enable */
-                else if ( !strcmp(in, "y") )
-                {
-                    DBG_LOG("PKF_WRITE_Y");
-                    eFusePKfWrite = 1;
-                    ret = 0;
-                }
-                else
-                {
-                    DBG_ERR("error!!!");
-                    ret = -1;
-                }
-			}
-			break;
+    if ( readBytes == 0 || response->ack != true || response->nak != false )
+    {
+        DBG_ERR("error!!!");
+        DBG_ERR("readBytes %d", readBytes);
+        DBG_ERR("%02X %02X %02X %02X", responseBuffer[0], responseBuffer[1], responseBuffer[2], responseBuffer[3]);
+        return -1;
     }
 
-    if ( ret != 0 )
+    /* send uploader image */
+    sentBytes = port->SendV(sendPacket, 3, port->GetTransferTimeMs(sendPacketSize) + TX_TIMEOUT_MARGIN_MS);
+    if ( sentBytes < 0 )
     {
         DBG_ERR("error!!!");
-        DBG_ERR("type: 0x%04X, in: %s", type, in);
-        return ret;
+        return -1;
     }
 
-    return ret;
-}
-
-int ProcessController::parseLine(const char* in)
-{
-    int ret = -1;
-    int inLen = 0;
-
-    if ( in == NULL )
+    /* receive response */
+    memset(responseBuffer, 0x00, sizeof(responseBuffer));
+    readBytes = port->Receive(responseBuffer, 4, port->GetTransferTimeMs(sendPacketSize) + ACK_TIMEOUT_MS);
+    if ( readBytes < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* key value length check */
-    inLen = strlen(in);
-    if ( (inLen <= 0) || (inLen >= (CONFIG_LINE_BUFFER_SIZE-1)) )
+    if ( readBytes == 0 || response->ack != true || response->nak != false )
     {
         DBG_ERR("error!!!");
+        DBG_ERR("readBytes %d", readBytes);
+        DBG_ERR("%02X %02X %02X %02X", responseBuffer[0], responseBuffer[1], responseBuffer[2], responseBuffer[3]);
         return -1;
     }
 
-    /* get key type and value */
-    char* param = new char[(inLen+1)] {0,};
-    char* value = new char[(inLen+1)] {0,};
-    sscanf(in, "%s %s", param, value);
+    /* DONE header, same as the SEND PACKET header */
+    sendPacketHeader = set->uploaderHeader;
 
-    /* value is empty */
-    if ( strlen(value) == 0 )
+    /* send Done */
+    sentBytes = port->Send((const unsigned char *)&sendPacketHeader, sizeof(cmdPacketHeader_t),
+                           port->GetTransferTimeMs(sizeof(cmdPacketHeader_t)) + TX_TIMEOUT_MARGIN_MS);
+    if ( sentBytes < 0 )
     {
-        return 0;
+        DBG_ERR("error!!!");
+        return -1;
     }
 
-    /* key value length check */
-    if ( strlen(value) < 0 || strlen(value) > 66 )
+    /* receive start message */
+    memset(responseBuffer, 0x00, sizeof(responseBuffer));
+    readBytes = port->Receive(responseBuffer, UPLOADER_START_MESSAGE_SIZE, UPLOADER_START_TIMEOUT_MS);
+    if ( readBytes <= 0 )
     {
-        DBG_ERR("param(%4d): %s", strlen(param), param);
-        DBG_ERR("value(%4d): %s", strlen(value), value);
         DBG_ERR("error!!!");
         return -1;
     }
-
-    /* check value, set key */
-    for ( unsigned int i = 0; i < EFUSE_TYPE_MAX; i++ )
+#ifdef __MP_DEBUG_BUILD__
+    DBG_LOG("[Message from MS500]");
+    for ( int i = 0; i < readBytes; i++ )
     {
-        if ( strcmp((char*)param, eFuseKeyParams[i]) == 0 )
-        {
-            ret = parseValue((eEFUSETYPE)i, value);
-            if ( ret < 0 )
-            {
-                DBG_ERR("error!!!");
-                return -1;
-            }
-            return 0;
-        }
+        DBG_LOG("%02X ", responseBuffer[i]);
     }
+    fprintf(stdout, "\n");
+#endif /* __MP_DEBUG_BUILD__ */
 
-    /* invalid value */
-    DBG_ERR("error!!!");
-    return -1;
+    return 0;
 }
 
-int ProcessController::parseConfigFile(void)
+int ProcessController::sendPing(SerialComm* port)
 {
     int ret = -1;
 
-    ret = access(configFileName, R_OK);
-    if ( ret != 0 )
+    int sentBytes = 0;
+    int readBytes = 0;
+    unsigned char responseBuffer[128] = {0,};
+    response_t* response = (response_t*)responseBuffer;
+
+    cmdPacketHeader_t sendPacketHeader;
+
+    ret = set->makeCmdHeader(PACKET_TYPE_PING, 0, NULL, 0, 0, &sendPacketHeader);
+    if ( ret < 0 )
     {
-        DBG_ERR("configFileName: %s", configFileName);
         DBG_ERR("error!!!");
         return -1;
     }
 
-    FILE* confFile = NULL;
-    confFile = fopen(configFileName, "r");
-    if ( confFile == NULL )
+    /* send header */
+    sentBytes = port->Send((const unsigned char *)&sendPacketHeader, sizeof(cmdPacketHeader_t),
+                           port->GetTransferTimeMs(sizeof(cmdPacketHeader_t)) + TX_TIMEOUT_MARGIN_MS);
+    if ( sentBytes < 0 )
     {
-        DBG_ERR("%s, file(%s) open error", __FUNCTION__, confFile);
+        DBG_ERR("error!!!");
         return -1;
     }
 
-    char line[CONFIG_LINE_BUFFER_SIZE] = {0,};
-    while ( !feof(confFile) )
+    /* receive response */
+    memset(responseBuffer, 0x00, sizeof(responseBuffer));
+    readBytes = port->Receive(responseBuffer, 4, port->GetTransferTimeMs(sizeof(cmdPacketHeader_t)) + ACK_TIMEOUT_MS);
+    if ( readBytes < 0 )
     {
-        /* get line */
-        fgets(line, CONFIG_LINE_BUFFER_SIZE, confFile);
+        DBG_ERR("error!!!");
+        return -1;
+    }
 
-        /* Skip Comment or Blank */
-        if ( line[0] == '#' || strlen(line) < 4 )
-        {
-            continue;
-        }
-        else
-        {
-            ret = parseLine(line);
-            if ( ret < 0 )
-            {
-                DBG_ERR("error!!!");
-                return -1;
-            }
-        }
+    if ( readBytes == 0 || response->ack != true || response->nak != false )
+    {
+        DBG_ERR("error!!!");
+        DBG_ERR("%02X %02X %02X %02X", responseBuffer[0], responseBuffer[1], responseBuffer[2], responseBuffer[3]);
+        return -1;
     }
 
     return 0;
 }
 
-int ProcessController::openUploaderFile(void)
+/*
+ * baudrate escalation, once the uploader runs from SRAM:
+ *  1. PACKET_TYPE_BAUDRATE(param: new rate) is acked at the current rate, then the uploader switches
+ *  2. the host retunes its termios and pings at the new rate
+ *  3. no ping within BAUDRATE_FALLBACK_MS: the uploader goes back to the old rate, and so does the host
+ * a NAK(or no answer) means the uploader can't switch, the session stays at the current rate.
+ */
+int ProcessController::sendUploaderBaudrate(SerialComm* port)
 {
     int ret = -1;
 
-    /* check uploader file */
-    ret = access(uploaderFileName, R_OK);
-    if ( ret != 0 )
+    if ( (set->uploaderBaudrate <= 0) || (set->uploaderBaudrate == baudrate) )
     {
-        DBG_ERR("uploaderFileName: %s", uploaderFileName);
-        DBG_ERR("error!!!");
-        return -1;
+        return 0;
     }
 
-    /* Open Uploader File */
-    FILE* uploaderFile = NULL;
-    uploaderFile = fopen(uploaderFileName, "r");
-    if ( uploaderFile == NULL )
-    {
-        DBG_ERR("%s, file(%s) open error", __FUNCTION__);
-        return -1;
-    }
+    int sentBytes = 0;
+    int readBytes = 0;
+    unsigned char responseBuffer[128] = {0,};
+    response_t* response = (response_t*)responseBuffer;
 
-    /* Get Uploader File Size */
-    int uploaderSize = 0;
-    ret = fseek(uploaderFile, 0, SEEK_END);
-    if ( ret != 0 )
-    {
-        if ( uploaderFile != NULL )
-        {
-            fclose(uploaderFile);
-            uploaderFile = NULL;
-        }
-        DBG_ERR("error!!!");
-        return -1;
-    }
-    uploaderSize = ftell(uploaderFile);
-    if ( uploaderSize < 0 )
+    cmdPacketHeader_t sendPacketHeader;
+
+    ret = set->makeCmdHeader(PACKET_TYPE_BAUDRATE, set->uploaderBaudrate, NULL, 0, 0, &sendPacketHeader);
+    if ( ret < 0 )
     {
-        if ( uploaderFile != NULL )
-        {
-            fclose(uploaderFile);
-            uploaderFile = NULL;
-        }
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* Rewind the file pointer */
-    rewind(uploaderFile);
-    ret = ftell(uploaderFile);
-    if ( ret != SEEK_SET )
+#ifdef __MP_DEBUG_BUILD__
+    DBG_LOG("[Baudrate]");
+    DBG_LOG("-PARAMS-----+-VALUES-----");
+    DBG_LOG("       sync | 0x%02X", sendPacketHeader.sync);
+    DBG_LOG("       type | 0x%02X", sendPacketHeader.type);
+    DBG_LOG("   baudrate | %d -> %d", baudrate, sendPacketHeader.param);
+    DBG_LOG("------------+------------\n");
+#endif
+
+    /* send header */
+    sentBytes = port->Send((const unsigned char *)&sendPacketHeader, sizeof(cmdPacketHeader_t),
+                           port->GetTransferTimeMs(sizeof(cmdPacketHeader_t)) + TX_TIMEOUT_MARGIN_MS);
+    if ( sentBytes < 0 )
     {
-        if ( uploaderFile != NULL )
-        {
-            fclose(uploaderFile);
-            uploaderFile = NULL;
-        }
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* Memory allocate and read uploader */
-    if ( uploaderBinary != NULL )
+    /* receive response */
+    memset(responseBuffer, 0x00, sizeof(responseBuffer));
+    readBytes = port->Receive(responseBuffer, 4, port->GetTransferTimeMs(sizeof(cmdPacketHeader_t)) + ACK_TIMEOUT_MS);
+    if ( readBytes < 0 || response->ack != true || response->nak != false )
     {
-        delete[] uploaderBinary;
-        uploaderBinary = NULL;
-        uploaderBinarySize = 0;
+        DBG_LOG("baudrate %d refused, stay at %d", set->uploaderBaudrate, baudrate);
+        port->Flush();
+        return 0;
     }
 
-    uploaderBinarySize = uploaderSize;
-    uploaderBinary = new unsigned char[uploaderBinarySize] {0,};
-    if ( uploaderBinary == NULL )
+    /* retune and verify */
+    ret = port->SetBaudrate(set->uploaderBaudrate);
+    if ( ret == 0 )
     {
-        if ( uploaderFile != NULL )
+        for ( int i = 0; i < PING_RETRY_MAX; i++ )
         {
-            fclose(uploaderFile);
-            uploaderFile = NULL;
+            ret = sendPing(port);
+            if ( ret == 0 )
+            {
+                DBG_LOG("baudrate %d", set->uploaderBaudrate);
+                return 0;
+            }
+            port->Flush();
         }
-        DBG_ERR("error!!!");
-        return -1;
     }
 
-    /* read from file */
-    ret = fread(uploaderBinary, 1, uploaderBinarySize, uploaderFile);
-    if ( ret != uploaderBinarySize )
+    /* fall back: both sides return to the base rate */
+    DBG_ERR("baudrate %d ping error, fall back to %d", set->uploaderBaudrate, baudrate);
+    ret = port->SetBaudrate(baudrate);
+    if ( ret < 0 )
     {
-        if ( uploaderBinary != NULL )
-        {
-            delete[] uploaderBinary;
-            uploaderBinary = NULL;
-            uploaderBinarySize = 0;
-        }
-        if ( uploaderFile != NULL )
-        {
-            fclose(uploaderFile);
-            uploaderFile = NULL;
-        }
         DBG_ERR("error!!!");
         return -1;
     }
+    usleep(BAUDRATE_FALLBACK_MS*1000);
+    port->Flush();
 
-    fclose(uploaderFile);
-    uploaderFile = NULL;
-
-    return 0;
-}
-
-int ProcessController::checkImgFilePrefix(unsigned char* in)
-{
-    const unsigned char prefix[5] = {(unsigned char)'e', (unsigned char)'W', (unsigned char)'B', (unsigned char)'M', 0x66 };
-
-    for ( int i = 0; i < sizeof(prefix); i++ )
-    {
-        if ( in[i] != prefix[i] )
-        {
-            DBG_ERR("error!!!");
-            return -1;
-        }
-    }
-
-    return 0;
-}
-
-int ProcessController::readSizeFromImgFile(unsigned int in, unsigned int* out)
-{
-    if ( out == NULL )
+    ret = sendPing(port);
+    if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    *out = (((in & 0xFF)       << 24)
-          | ((in & 0xFF00)     <<  8)
-          | ((in & 0xFF0000)   >>  8)
-          | ((in & 0xFF000000) >> 24));
-
     return 0;
 }
 
-int ProcessController::checkAppCodeBinarySize(unsigned int in)
+/*
+ * delta flashing: the device CRC of every sector of the region, FLASH_CRC_SECTOR_MAX per query,
+ * against the prebuilt headers. dirty: a bit per sector that differs.
+ * 0: dirty filled, 1: no answer(uploader without CRC_TARGET_SECTORS).
+ */
+int ProcessController::diffSectors(SerialComm* port, const sectorTable_t* table, unsigned char* dirty, unsigned int* dirtyCount)
 {
     int ret = -1;
 
-    if ( (appImageTotalSize <= 0) || ((secureBootEnabled != 1) && (secureBootEnabled != 0)) )
-    {
-        DBG_ERR("error!!!");
-        return -1;
-    }
+    unsigned int crc[FLASH_CRC_SECTOR_MAX];
 
-    ret = readSizeFromImgFile(in, &appCodeBinarySize);
-    if ( ret < 0 )
-    {
-        DBG_ERR("error!!!");
-        return -1;
-    }
+    *dirtyCount = 0;
+    memset(dirty, 0x00, (table->count + 7) / 8);
 
-    if ( secureBootEnabled == 1 )
+    for ( unsigned int first = 0; first < table->count; first += FLASH_CRC_SECTOR_MAX )
     {
-        if ( appCodeBinarySize != appImageTotalSize - 0x4000 )
+        unsigned int count  = table->count - first;
+        unsigned int base   = first * FLASH_SECTOR_SIZE;
+        unsigned int length = table->size - base;
+        if ( count > FLASH_CRC_SECTOR_MAX )
         {
-            DBG_ERR("error!!!");
-            return -1;
+            count  = FLASH_CRC_SECTOR_MAX;
+            length = FLASH_CRC_SECTOR_MAX * FLASH_SECTOR_SIZE;
         }
-    }
-    else
-    {
-        if ( appCodeBinarySize != appImageTotalSize )
+
+        ret = sendCrcQuery(port, CRC_TARGET_SECTORS, table->addr + base, length, NULL, crc);
+        if ( ret != 0 )
         {
-            DBG_ERR("error!!!");
-            return -1;
+            return ret;
+        }
+
+        for ( unsigned int i = 0; i < count; i++ )
+        {
+            if ( crc[i] != table->header[first + i].crc )
+            {
+                dirty[(first + i) / 8] |= (1 << ((first + i) % 8));
+                (*dirtyCount)++;
+            }
         }
     }
 
     return 0;
 }
 
-int ProcessController::checkSdbCodeBinarySize(unsigned int in)
+int ProcessController::sendDataToFlash(SerialComm* port, const sectorTable_t* table)
 {
     int ret = -1;
 
-    if ( (appImageTotalSize <= 0) || ((secureBootEnabled != 1) && (secureBootEnabled != 0)) )
+    if ( table == NULL || table->header == NULL || table->count <= 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    ret = readSizeFromImgFile(in, &sdbCodeBinarySize);
-    if ( ret < 0 )
+    int sentBytes = 0;
+    int readBytes = 0;
+    unsigned char responseBuffer[128] = {0,};
+    response_t* response = (response_t*)responseBuffer;
+    if ( response == NULL )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    if ( secureBootEnabled == 1 )
+    unsigned int         addr      = table->addr;
+    unsigned int         base      = 0;
+    unsigned int         loopCount = table->count - table->erased;
+    unsigned int         sendSize  = 0;
+    unsigned int         sector    = 0;
+
+    cmdPacketHeader_t sendPacketHeader;
+
+    /*
+     * delta: only the sectors the device holds differently are sent, each erased on its own.
+     * when most of the region differs(a blank device) the region erase is cheaper, all go.
+     */
+    unsigned char dirty[FLASH_DELTA_SECTOR_MAX / 8];
+    unsigned int  dirtyCount = 0;
+    unsigned char flags = 0;
+    if ( (set->flashDelta == 1) && (table->count <= FLASH_DELTA_SECTOR_MAX) )
     {
-        if ( appCodeBinarySize != appImageTotalSize - 0x4000 )
+        ret = diffSectors(port, table, dirty, &dirtyCount);
+        if ( ret < 0 )
         {
             DBG_ERR("error!!!");
             return -1;
         }
-    }
-    else
-    {
-        if ( appCodeBinarySize != appImageTotalSize )
+        if ( (ret == 0) && (dirtyCount * 2 <= table->count) )
         {
-            DBG_ERR("error!!!");
-            return -1;
+            loopCount = dirtyCount;
+            flags     = FLASH_FLAG_SECTOR_ERASE;
         }
     }
 
-    return 0;
-}
+    /*
+     * sliding window: up to flashWindowSize sectors are sent before the oldest ack is awaited.
+     * the uploader acks in order and echoes reserved[0](sector tag), so each ack maps back to
+     * its sector address. window 1 is the plain stop-and-wait transfer.
+     */
+    unsigned int window = set->flashWindowSize;
+    if ( (window < 1) || (window > FLASH_WINDOW_MAX) )
+    {
+        window = 1;
+    }
 
-int ProcessController::checkAppImageTotalSize(unsigned int in, unsigned int in2)
-{
-    int ret = -1;
+    struct iovec    sendPacket[2];
+    unsigned long   writeCalls = port->GetWriteCalls();
+    struct timespec from;
+    struct timespec to;
 
-    if ( in2 <= 0 )
-    {
-        DBG_ERR("error!!!");
-        return -1;
-    }
+    clock_gettime(CLOCK_MONOTONIC, &from);
 
-    ret = readSizeFromImgFile(in, &appImageTotalSize);
-    if ( ret < 0 )
-    {
-        DBG_ERR("error!!!");
-        return -1;
-    }
+    unsigned int flightAddr[FLASH_WINDOW_MAX] = {0,};
+    unsigned int flightSize[FLASH_WINDOW_MAX] = {0,};
+    unsigned int flightBytes = 0;
+    unsigned int rawBytes    = 0;
+    unsigned int wireBytes   = 0;
+    unsigned int sent  = 0;
+    unsigned int acked = 0;
+    unsigned int slot  = 0;
 
-    if ( appImageTotalSize != (in2 - sizeof(FirmwareImageFileHeader_t)) )
+    while ( acked < loopCount )
     {
-        DBG_ERR("error!!!");
-        return -1;
+        /* fill the window */
+        while ( (sent < loopCount) && ((sent - acked) < window) )
+        {
+            /* delta: the sectors that match are passed over, otherwise the erased ones */
+            while ( (flags != 0) ? ((dirty[sector / 8] & (1 << (sector % 8))) == 0) : erasedSector(table, sector) )
+            {
+                sector++;
+            }
+
+            /* prebuilt header, only the sector tag and flags are per transfer */
+            sendPacketHeader = table->header[sector];
+            base     = sector * FLASH_SECTOR_SIZE;
+            sendSize = sendPacketHeader.size[0];
+            if ( window > 1 )
+            {
+                sendPacketHeader.reserved[0] = (unsigned char)(sent & 0xFF);
+            }
+            sendPacketHeader.reserved[1] = flags;
+
+#ifdef __MP_DEBUG_BUILD__
+            DBG_LOG("[SEND BLOCK#%d]", sent);
+            DBG_LOG("-PARAMS-----+-VALUES-----");
+            DBG_LOG("       sync | 0x%02X", sendPacketHeader.sync);
+            DBG_LOG("       type | 0x%02X", sendPacketHeader.type);
+            DBG_LOG("        tag | 0x%02X", sendPacketHeader.reserved[0]);
+            DBG_LOG("      flags | 0x%02X", sendPacketHeader.reserved[1]);
+            DBG_LOG("       addr | 0x%08X", sendPacketHeader.param);
+            DBG_LOG(" dwn length | 0x%08X", sendPacketHeader.size[0]);
+            DBG_LOG(" app length | 0x%08X", sendPacketHeader.size[1]);
+            DBG_LOG("        crc | 0x%08X", sendPacketHeader.crc);
+            DBG_LOG("------------+------------\n");
+#endif
+
+            /* send header + sector(raw, LZ4 or fill) */
+            sendPacket[0].iov_base = (void*)&sendPacketHeader;
+            sendPacket[0].iov_len  = sizeof(cmdPacketHeader_t);
+            sendPacket[1].iov_base = (void*)table->payload[sector];
+            sendPacket[1].iov_len  = sendSize;
+            sentBytes = port->SendV(sendPacket, 2, port->GetTransferTimeMs(flightBytes + sizeof(cmdPacketHeader_t) + sendSize) + TX_TIMEOUT_MARGIN_MS);
+            if ( sentBytes < 0 )
+            {
+                DBG_ERR("error!!!");
+                return -1;
+            }
+
+            slot = sent % FLASH_WINDOW_MAX;
+            flightAddr[slot] = addr + base;
+            flightSize[slot] = sizeof(cmdPacketHeader_t) + sendSize;
+            flightBytes += flightSize[slot];
+            rawBytes    += (table->size - base < FLASH_SECTOR_SIZE) ? (table->size - base) : FLASH_SECTOR_SIZE;
+            wireBytes   += sendSize;
+            sent++;
+            sector++;
+        }
+
+        /* receive response of the oldest sector, the first sector also erases the region */
+        int programTimeoutMs = (acked == 0) ? FLASH_ERASE_TIMEOUT_MS : FLASH_PROGRAM_TIMEOUT_MS;
+        if ( flags != 0 )
+        {
+            programTimeoutMs = FLASH_SECTOR_ERASE_TIMEOUT_MS + FLASH_PROGRAM_TIMEOUT_MS;
+        }
+        slot = acked % FLASH_WINDOW_MAX;
+        memset(responseBuffer, 0x00, sizeof(responseBuffer));
+        readBytes = port->Receive(responseBuffer, 4, port->GetTransferTimeMs(flightBytes) + programTimeoutMs);
+        if ( readBytes < 0 )
+        {
+            DBG_ERR("error!!!");
+            DBG_ERR("sector 0x%08X, no response", flightAddr[slot]);
+            return -1;
+        }
+
+        if ( readBytes == 0 || response->ack != true || response->nak != false
+          || ((window > 1) && (response->reserved[0] != (unsigned char)(acked & 0xFF))) )
+        {
+            DBG_ERR("error!!!");
+            DBG_ERR("sector 0x%08X, tag 0x%02X", flightAddr[slot], (acked & 0xFF));
+            DBG_ERR("readBytes %d", readBytes);
+            DBG_ERR("%02X %02X %02X %02X", responseBuffer[0], responseBuffer[1], responseBuffer[2], responseBuffer[3]);
+            return -1;
+        }
+
+        flightBytes -= flightSize[slot];
+        acked++;
     }
 
+    /* effective rate is image bytes programmed per second, above the link rate when compressed */
+    clock_gettime(CLOCK_MONOTONIC, &to);
+    long ms = diffMs(&from, &to);
+    DBG_LOG("0x%08X: %d/%d sectors, %u -> %u bytes, %ld ms(%ld KB/s), %lu write syscalls",
+            addr, loopCount, table->count, rawBytes, wireBytes, ms,
+            (ms > 0) ? (long)((unsigned long long)rawBytes * 1000 / ms / 1024) : 0, (port->GetWriteCalls() - writeCalls));
+
     return 0;
 }
 
-int ProcessController::openAppImageFile(void)
+/* crc: of info and data together, prebuilt with the SDB list */
+int ProcessController::sendSDBDataToFlash(SerialComm* port, const unsigned char* info, unsigned int infoLen, const unsigned char* in, unsigned int inLen, unsigned int crc)
 {
     int ret = -1;
 
-    /* check uploader file */
-    ret = access(appImageFileName, R_OK);
-    if ( ret != 0 )
+    if ( info == NULL || infoLen <= 0 || (in == NULL && inLen != 0) )
     {
-        DBG_ERR("appImageFileName: %s", appImageFileName);
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* Open Uploader File */
-    FILE* appImageFile = NULL;
-    appImageFile = fopen(appImageFileName, "r");
-    if ( appImageFile == NULL )
+    int sentBytes = 0;
+    int readBytes = 0;
+    unsigned char responseBuffer[128] = {0,};
+    response_t* response = (response_t*)responseBuffer;
+    if ( response == NULL )
     {
-        DBG_ERR("%s, file(%s) open error", __FUNCTION__);
+        DBG_ERR("error!!!");
         return -1;
     }
 
-    /* Get Uploader File Size */
-    int appImageSize = 0;
-    ret = fseek(appImageFile, 0, SEEK_END);
-    if ( ret != 0 )
+    unsigned int packetSize = infoLen + inLen;
+
+    cmdPacketHeader_t sendPacketHeader;
+
+    ret = set->makeCmdHeader(PACKET_TYPE_FLASH_SDB, 0, info, packetSize, packetSize, &sendPacketHeader);
+    if ( ret < 0 )
     {
-        if ( appImageFile != NULL )
-        {
-            fclose(appImageFile);
-            appImageFile = NULL;
-        }
         DBG_ERR("error!!!");
         return -1;
     }
-    appImageSize = ftell(appImageFile);
-    if ( appImageSize < 0 )
+    sendPacketHeader.crc = crc;
+
+#ifdef __MP_DEBUG_BUILD__
+    DBG_LOG("[SEND SDB]");
+    DBG_LOG("-PARAMS-----+-VALUES-----");
+    DBG_LOG("       sync | 0x%02X", sendPacketHeader.sync);
+    DBG_LOG("       type | 0x%02X", sendPacketHeader.type);
+    DBG_LOG("       addr | 0x%08X", sendPacketHeader.param);
+    DBG_LOG(" dwn length | 0x%08X", sendPacketHeader.size[0]);
+    DBG_LOG(" app length | 0x%08X", sendPacketHeader.size[1]);
+    DBG_LOG("        crc | 0x%08X", sendPacketHeader.crc);
+    DBG_LOG("------------+------------\n");
+#endif
+
+    /* send header + sdb info + mapped sdb data */
+    struct iovec sendPacket[3];
+    sendPacket[0].iov_base = (void*)&sendPacketHeader;
+    sendPacket[0].iov_len  = sizeof(cmdPacketHeader_t);
+    sendPacket[1].iov_base = (void*)info;
+    sendPacket[1].iov_len  = infoLen;
+    sendPacket[2].iov_base = (void*)in;
+    sendPacket[2].iov_len  = inLen;
+    sentBytes = port->SendV(sendPacket, (inLen > 0) ? 3 : 2, port->GetTransferTimeMs(sizeof(cmdPacketHeader_t) + packetSize) + TX_TIMEOUT_MARGIN_MS);
+    if ( sentBytes < 0 )
     {
-        if ( appImageFile != NULL )
-        {
-            fclose(appImageFile);
-            appImageFile = NULL;
-        }
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* Rewind the file pointer */
-    rewind(appImageFile);
-    ret = ftell(appImageFile);
-    if ( ret != SEEK_SET )
+    /* receive response */
+    memset(responseBuffer, 0x00, sizeof(responseBuffer));
+    readBytes = port->Receive(responseBuffer, 4, port->GetTransferTimeMs(sizeof(cmdPacketHeader_t) + packetSize) + SDB_WRITE_TIMEOUT_MS);
+    if ( readBytes < 0 )
     {
-        if ( appImageFile != NULL )
-        {
-            fclose(appImageFile);
-            appImageFile = NULL;
-        }
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* Memory allocate and read uploader */
-    unsigned int   appImageFileBinarySize = appImageSize;
-    unsigned char* appImageFileBinary = new unsigned char[appImageFileBinarySize] {0,};
-    if ( appImageFileBinary == NULL )
+    if ( readBytes == 0 || response->ack != true || response->nak != false )
     {
-        if ( appImageFile != NULL )
-        {
-            fclose(appImageFile);
-            appImageFile = NULL;
-        }
         DBG_ERR("error!!!");
+        DBG_ERR("readBytes %d", readBytes);
+        DBG_ERR("%02X %02X %02X %02X", responseBuffer[0], responseBuffer[1], responseBuffer[2], responseBuffer[3]);
         return -1;
     }
 
-    /* read from file */
-    ret = fread(appImageFileBinary, 1, appImageFileBinarySize, appImageFile);
-    if ( ret != appImageFileBinarySize )
+    return 0;
+}
+/*
+ * SDBSTREAM: the entry is opened with its info header, then the data follows in sector sized,
+ * crc checked chunks, windowed like the flash sectors. a NAKed chunk is sent again from there
+ * on(go-back-n), the uploader drops everything behind it until then.
+ */
+int ProcessController::streamSDBDataToFlash(SerialComm* port, const unsigned char* info, unsigned int infoLen, const unsigned char* in, unsigned int inLen)
+{
+    int ret = -1;
+
+    if ( info == NULL || infoLen != SDB_INFO_HEADER_SIZE || (in == NULL && inLen != 0) )
     {
-        if ( appImageFileBinary != NULL )
-        {
-            delete[] appImageFileBinary;
-            appImageFileBinary = NULL;
-            appImageFileBinarySize = 0;
-        }
-        if ( appImageFile != NULL )
-        {
-            fclose(appImageFile);
-            appImageFile = NULL;
-        }
         DBG_ERR("error!!!");
         return -1;
     }
 
-    FirmwareImageFileHeader_t* appImageFileBinaryHeader = (FirmwareImageFileHeader_t*)appImageFileBinary;
-    if ( appImageFileBinaryHeader == NULL )
+    int sentBytes = 0;
+    int readBytes = 0;
+    unsigned char responseBuffer[128] = {0,};
+    response_t* response = (response_t*)responseBuffer;
+
+    cmdPacketHeader_t sendPacketHeader;
+    struct iovec      sendPacket[2];
+
+    /* open the entry */
+    ret = set->makeCmdHeader(PACKET_TYPE_SDB_OPEN, 0, info, infoLen, inLen, &sendPacketHeader);
+    if ( ret < 0 )
     {
-        if ( appImageFileBinary != NULL )
-        {
-            delete[] appImageFileBinary;
-            appImageFileBinary = NULL;
-            appImageFileBinarySize = 0;
-        }
-        if ( appImageFile != NULL )
-        {
-            fclose(appImageFile);
-            appImageFile = NULL;
-        }
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* check .img prefix */
-    ret = checkImgFilePrefix(appImageFileBinaryHeader->prefix);
-    if ( ret < 0 )
+    sendPacket[0].iov_base = (void*)&sendPacketHeader;
+    sendPacket[0].iov_len  = sizeof(cmdPacketHeader_t);
+    sendPacket[1].iov_base = (void*)info;
+    sendPacket[1].iov_len  = infoLen;
+    sentBytes = port->SendV(sendPacket, 2, port->GetTransferTimeMs(sizeof(cmdPacketHeader_t) + infoLen) + TX_TIMEOUT_MARGIN_MS);
+    if ( sentBytes < 0 )
     {
-        if ( appImageFileBinary != NULL )
-        {
-            delete[] appImageFileBinary;
-            appImageFileBinary = NULL;
-            appImageFileBinarySize = 0;
-        }
-        if ( appImageFile != NULL )
-        {
-            fclose(appImageFile);
-            appImageFile = NULL;
-        }
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* check secure boot */
-    secureBootEnabled = appImageFileBinaryHeader->sbEnEnabled;
-    if ( (secureBootEnabled != 0) && (secureBootEnabled != 1) )
+    memset(responseBuffer, 0x00, sizeof(responseBuffer));
+    readBytes = port->Receive(responseBuffer, 4, port->GetTransferTimeMs(sizeof(cmdPacketHeader_t) + infoLen) + FLASH_PROGRAM_TIMEOUT_MS);
+    if ( readBytes <= 0 || response->ack != true || response->nak != false )
     {
-        if ( appImageFileBinary != NULL )
-        {
-            delete[] appImageFileBinary;
-            appImageFileBinary = NULL;
-            appImageFileBinarySize = 0;
-        }
-        if ( appImageFile != NULL )
-        {
-            fclose(appImageFile);
-            appImageFile = NULL;
-        }
         DBG_ERR("error!!!");
+        DBG_ERR("sdb open, readBytes %d", readBytes);
+        DBG_ERR("%02X %02X %02X %02X", responseBuffer[0], responseBuffer[1], responseBuffer[2], responseBuffer[3]);
         return -1;
     }
 
-    /* check app image total size (image size = image file size - header size) */
-    ret = checkAppImageTotalSize(appImageFileBinaryHeader->totalSize, appImageFileBinarySize);
-    if ( ret < 0 )
+    unsigned int window = set->flashWindowSize;
+    if ( (window < 1) || (window > FLASH_WINDOW_MAX) )
     {
-        if ( appImageFileBinary != NULL )
-        {
-            delete[] appImageFileBinary;
-            appImageFileBinary = NULL;
-            appImageFileBinarySize = 0;
-        }
-        if ( appImageFile != NULL )
-        {
-            fclose(appImageFile);
-            appImageFile = NULL;
-        }
-        DBG_ERR("error!!!");
-        return -1;
+        window = 1;
     }
 
-    /* check app code binary size */
-    ret = checkAppCodeBinarySize(appImageFileBinaryHeader->codeSize);
-    if ( ret < 0 )
+    struct timespec from;
+    struct timespec to;
+    clock_gettime(CLOCK_MONOTONIC, &from);
+
+    unsigned int count = (inLen + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+    unsigned int flightSize[FLASH_WINDOW_MAX] = {0,};
+    unsigned int flightBytes = 0;
+    unsigned int sent    = 0;
+    unsigned int acked   = 0;
+    unsigned int slot    = 0;
+    unsigned int resent  = 0;
+    int          retries = 0;       /* NAKs of the chunk at acked */
+
+    while ( acked < count )
     {
-        if ( appImageFileBinary != NULL )
-        {
-            delete[] appImageFileBinary;
-            appImageFileBinary = NULL;
-            appImageFileBinarySize = 0;
-        }
-        if ( appImageFile != NULL )
+        /* fill the window */
+        while ( (sent < count) && ((sent - acked) < window) )
         {
-            fclose(appImageFile);
-            appImageFile = NULL;
+            unsigned int base     = sent * FLASH_SECTOR_SIZE;
+            unsigned int sendSize = (inLen - base < FLASH_SECTOR_SIZE) ? (inLen - base) : FLASH_SECTOR_SIZE;
+
+            ret = set->makeCmdHeader(PACKET_TYPE_SDB_CHUNK, base, in + base, sendSize, inLen, &sendPacketHeader);
+            if ( ret < 0 )
+            {
+                DBG_ERR("error!!!");
+                return -1;
+            }
+            if ( window > 1 )
+            {
+                sendPacketHeader.reserved[0] = (unsigned char)(sent & 0xFF);
+            }
+
+            sendPacket[0].iov_base = (void*)&sendPacketHeader;
+            sendPacket[0].iov_len  = sizeof(cmdPacketHeader_t);
+            sendPacket[1].iov_base = (void*)(in + base);
+            sendPacket[1].iov_len  = sendSize;
+            sentBytes = port->SendV(sendPacket, 2, port->GetTransferTimeMs(flightBytes + sizeof(cmdPacketHeader_t) + sendSize) + TX_TIMEOUT_MARGIN_MS);
+            if ( sentBytes < 0 )
+            {
+                DBG_ERR("error!!!");
+                return -1;
+            }
+
+            slot = sent % FLASH_WINDOW_MAX;
+            flightSize[slot] = sizeof(cmdPacketHeader_t) + sendSize;
+            flightBytes += flightSize[slot];
+            sent++;
         }
-        DBG_ERR("error!!!");
-        return -1;
-    }
 
-    /* import pka, signature, code */
-    if ( appCodeBinary != NULL )
-    {
-        delete[] appCodeBinary;
-        appCodeBinary = NULL;
-    }
-    appCodeBinary = new unsigned char[appCodeBinarySize] {0,};
-    if ( appCodeBinary == NULL )
-    {
-        if ( appImageFileBinary != NULL )
+        /* receive response of the oldest chunk */
+        slot = acked % FLASH_WINDOW_MAX;
+        memset(responseBuffer, 0x00, sizeof(responseBuffer));
+        readBytes = port->Receive(responseBuffer, 4, port->GetTransferTimeMs(flightBytes) + FLASH_PROGRAM_TIMEOUT_MS);
+        if ( readBytes <= 0 || ((window > 1) && (response->reserved[0] != (unsigned char)(acked & 0xFF))) )
         {
-            delete[] appImageFileBinary;
-            appImageFileBinary = NULL;
-            appImageFileBinarySize = 0;
+            DBG_ERR("error!!!");
+            DBG_ERR("sdb chunk 0x%08X, tag 0x%02X, readBytes %d", acked * FLASH_SECTOR_SIZE, (acked & 0xFF), readBytes);
+            DBG_ERR("%02X %02X %02X %02X", responseBuffer[0], responseBuffer[1], responseBuffer[2], responseBuffer[3]);
+            return -1;
         }
-        if ( appImageFile != NULL )
+
+        if ( response->ack == true && response->nak == false )
         {
-            fclose(appImageFile);
-            appImageFile = NULL;
+            flightBytes -= flightSize[slot];
+            acked++;
+            retries = 0;
+            continue;
         }
-        DBG_ERR("error!!!");
-        return -1;
-    }
 
-    unsigned int base = sizeof(FirmwareImageFileHeader_t);
-    if ( secureBootEnabled == 1 )
-    {
-        if ( pkaBinary != NULL )
+        retries++;
+        if ( retries > SDB_CHUNK_RETRY_MAX )
         {
-            delete[] pkaBinary;
-            pkaBinary = NULL;
+            DBG_ERR("error!!!");
+            DBG_ERR("sdb chunk 0x%08X, %d NAKs", acked * FLASH_SECTOR_SIZE, retries);
+            return -1;
         }
-        pkaBinarySize = 0x2000;
-        pkaBinary = new unsigned char[pkaBinarySize]{0,};
+        DBG_LOG("sdb chunk 0x%08X NAK, sent again with %d behind it", acked * FLASH_SECTOR_SIZE, sent - acked - 1);
 
-        if ( signatureBinary != NULL )
+        /* the chunks behind it are NAKed as well, drain them and go back */
+        for ( unsigned int i = acked + 1; i < sent; i++ )
         {
-            delete[] signatureBinary;
-            signatureBinary = NULL;
+            readBytes = port->Receive(responseBuffer, 4, port->GetTransferTimeMs(flightBytes) + FLASH_PROGRAM_TIMEOUT_MS);
+            if ( readBytes <= 0 )
+            {
+                DBG_ERR("error!!!");
+                return -1;
+            }
         }
-        signatureBinarySize = 0x2000;
-        signatureBinary = new unsigned char[signatureBinarySize]{0,};
+        resent     += sent - acked;
+        flightBytes = 0;
+        sent        = acked;
     }
-    else
+
+    clock_gettime(CLOCK_MONOTONIC, &to);
+    long ms = diffMs(&from, &to);
+    DBG_LOG("sdb %s: %u chunks, %u bytes, %u resent, %ld ms(%ld KB/s)",
+            ((const SDBInfoFile_t*)info)->path, count, inLen, resent, ms,
+            (ms > 0) ? (long)((unsigned long long)inLen * 1000 / ms / 1024) : 0);
+
+    return 0;
+}
+
+/* skip: bit n set, SDB_n is already stored on the device(rework pre-scan) */
+int ProcessController::sendSdbInfo(SerialComm* port, unsigned int skip)
+{
+    int index = 0;
+    int ret = -1;
+    const unsigned char* sdbInfoHeader = NULL;
+    const unsigned char* sdbData = NULL;
+    unsigned int         sdbDataSize = 0;
+    unsigned int         sdbPacketCrc = 0;
+    
+    while ( 1 )
     {
-        if ( pkaBinary != NULL )
+        ret = set->getSdb(index, &sdbInfoHeader, &sdbData, &sdbDataSize, NULL, &sdbPacketCrc);
         {
-            delete[] pkaBinary;
-            pkaBinary = NULL;
+            if ( ret < 0 )
+            {
+                DBG_ERR("getSdb error");
+                return -1;
+            }
+            else
+            if ( ret == 1 )
+            {
+                return 0;
+            }
         }
-        pkaBinarySize = 0;
-        if ( signatureBinary != NULL )
+        
+        if ( (index < SDB_SKIP_MAX) && ((skip & (1U << index)) != 0) )
         {
-            delete[] signatureBinary;
-            signatureBinary = NULL;
+            DBG_LOG("SDB_%d already stored", index);
+            ret = 0;
         }
-        signatureBinary = 0;
-    }
-    memcpy(pkaBinary,       appImageFileBinary + base, pkaBinarySize);
-    base += pkaBinarySize;
-    memcpy(signatureBinary, appImageFileBinary + base, signatureBinarySize);
-    base += signatureBinarySize;
-    memcpy(appCodeBinary,   appImageFileBinary + base, appCodeBinarySize);
-    base += appCodeBinarySize;
-
-#ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[IMG FILE INFO]");
-    DBG_LOG("-PARAMS--------------+-VALUES--------------------------");
-    fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
-    fprintf(stdout, "              header | ");
-    for ( int i = 0; i < sizeof(appImageFileBinaryHeader->prefix); i++ )
-    {
-        fprintf(stdout, "%02X", appImageFileBinaryHeader->prefix[i]);
-    }
-	
-    fprintf(stdout, " %02X %08X %08X\n", appImageFileBinaryHeader->sbEnEnabled, appImageFileBinaryHeader->codeSize, appImageFileBinaryHeader->totalSize);
-    DBG_LOG("   secureBootEnabled | 0x%02X",      secureBootEnabled, secureBootEnabled);
-    DBG_LOG("   appCodeBinarySize | 0x%08X(%d)", appCodeBinarySize, appCodeBinarySize);
-    DBG_LOG("   appImageTotalSize | 0x%08X(%d)", appImageTotalSize, appImageTotalSize);
-    DBG_LOG("       pkaBinarySize | 0x%08X(%d)", pkaBinarySize, pkaBinarySize);
-    DBG_LOG(" signatureBinarySize | 0x%08X(%d)", signatureBinarySize, signatureBinarySize);
-    if ( appCodeBinarySize > 0 )
-    {
-        fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
-        fprintf(stdout, "       appCodeBinary | ");
-        for ( int i = 0; i < 16; i++ )
+        else
+        if ( set->sdbStream == 1 )
         {
-            fprintf(stdout, "%02X", appCodeBinary[i]);
+            ret = streamSDBDataToFlash(port, sdbInfoHeader, SDB_INFO_HEADER_SIZE, sdbData, sdbDataSize);
         }
-        fprintf(stdout, "\n");
-    }
-    if ( pkaBinarySize > 0 )
-    {
-        fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
-        fprintf(stdout, "           pkaBinary | ");
-        for ( int i = 0; i < 16; i++ )
+        else
         {
-            fprintf(stdout, "%02X", pkaBinary[i]);
+            ret = sendSDBDataToFlash(port, sdbInfoHeader, SDB_INFO_HEADER_SIZE, sdbData, sdbDataSize, sdbPacketCrc);
         }
-        fprintf(stdout, "\n");
-    }
-    if ( signatureBinarySize > 0 )
-    {
-        fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
-        fprintf(stdout, "     signatureBinary | ");
-        for ( int i = 0; i < 16; i++ )
+        index++;
+        
+        if ( ret < 0 )
         {
-            fprintf(stdout, "%02X", signatureBinary[i]);
+            DBG_ERR(".ini error");
+            return -1;
         }
-        fprintf(stdout, "\n");
     }
-    DBG_LOG("---------------------+----------------------------------\n");
-#endif
+    
+    return ret;
+}
+
+int ProcessController::sendAppImageFirmware(SerialComm* port)
+{
+    int ret = -1;
 
-    if ( appImageFileBinary != NULL )
+    /* Send App and Erase Flash */
+    ret = sendDataToFlash(port, &set->sectorTable[IMAGE_REGION_APP]);
+    if ( ret < 0 )
     {
-        delete[] appImageFileBinary;
-        appImageFileBinary = NULL;
-        appImageFileBinarySize = 0;
+        DBG_ERR("error!!!");
+        return -1;
     }
-    if ( appImageFile != NULL )
+
+    if ( set->secureBootEnabled == 1 )
     {
-        fclose(appImageFile);
-        appImageFile = NULL;
+        /* Send PKA */
+        ret = sendDataToFlash(port, &set->sectorTable[IMAGE_REGION_PKA]);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+
+        /* Send Signature */
+        ret = sendDataToFlash(port, &set->sectorTable[IMAGE_REGION_SIGNATURE]);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
     }
 
-    return 0;
+    return ret;
 }
 
-int ProcessController::makeCmdHeader(ePACKETTYPE type, unsigned int param, unsigned char* in, unsigned int inSize, unsigned int optionSize, cmdPacketHeader_t* out)
+/* configured value of an eFuse field, as stored in the device. -1: not writable */
+int ProcessController::getNVMValue(eEFUSETYPE type, unsigned char* out)
 {
     int ret = -1;
 
-    if ( out == NULL )
+    if ( type >= EFUSE_TYPE_MAX || type < 0 || out == NULL )
     {
         DBG_ERR("error!!!");
         return -1;
     }
-    memset(out, 0x00, sizeof(cmdPacketHeader_t));
 
-    /* check type and size */
     switch ( type )
     {
-        case PACKET_TYPE_SRAM:
+        case EFUSE_BOOT_SRC:
             {
-                if ( (inSize != 0) && (optionSize != 0)
-                  && (inSize == optionSize + sizeof(UPLOADER_BINARY_PREFIX) + sizeof(uploaderBinarySize))
-                  && (optionSize == uploaderBinarySize) )
-                {
-                    out->crc = CRC32::CalcCRC32(in, optionSize);
-                    ret = 0;
-                }
-                else
-                {
-                    DBG_ERR("error!!!");
-                    ret = -1;
-                }
+                memcpy(out, &set->eFuseBootSource, eFuseLength[type]);
+                ret = 0;
             }
             break;
 
-        case PACKET_TYPE_EFUSE_WRITE:
+        case EFUSE_SB_EN:
             {
-                if ( (inSize != 0) && (optionSize == 0) )
-                {
-                    out->crc = CRC32::CalcCRC32(in, inSize);
-                    ret = 0;
-                }
-                else
-                {
-                    DBG_ERR("error!!!");
-                    ret = -1;
-                }
+                memcpy(out, &set->eFuseSecureBootEnable, eFuseLength[type]);
+                ret = 0;
             }
             break;
 
-        case PACKET_TYPE_EFUSE_READ:
+        case EFUSE_TYPE_UKEY_LOCK:
             {
-                if ( (inSize == 0) && (optionSize == 0) )
-                {
-                    ret = 0;
-                }
-                else
-                {
-                    DBG_ERR("error!!!");
-                    ret = -1;
-                }
+                memcpy(out, &set->eFuseUKeyLock, eFuseLength[type]);
+                ret = 0;
             }
             break;
 
-        case PACKET_TYPE_FLASH:
+        case EFUSE_TYPE_PKF_LOCK:
             {
-                if ( (inSize != 0) && (optionSize != 0)
-                  && (inSize <= FLASH_SECTOR_SIZE) )
-                {
-                    out->crc = CRC32::CalcCRC32(in, inSize);
-                    ret = 0;
-                }
-                else
-                {
-                    DBG_ERR("error!!!");
-                    ret = -1;
-                }
+                memcpy(out, &set->eFusePKfLock, eFuseLength[type]);
+                ret = 0;
             }
             break;
-            
-        case PACKET_TYPE_FLASH_SDB:
+
+        case EFUSE_TYPE_DUK_LOCK:
+            {
+                memcpy(out, &set->eFuseDUKLock, eFuseLength[type]);
+                ret = 0;
+                
+            }
+            break;
+			
+		case EFUSE_WRITE_PKF:
+			break;
+			
+        case EFUSE_TYPE_UKEY:
             {
+                memcpy(out, set->eFuseUKey, eFuseLength[type]);
+                ret = 0;
+            }
+            break;
+
+        case EFUSE_TYPE_PKF:
+            {
+                memcpy(out, set->eFusePKf, eFuseLength[type]);
                 ret = 0;
-//                if ( (inSize != 0) && (optionSize != 0) 
-//					&& (inSize <= FLASH_SECTOR_SIZE) )
-//                {
-//                    out->crc = CRC32::CalcCRC32(in, inSize);
-//                    ret = 0;
-//                }
-//                else
-//                {
-//                    DBG_ERR("error!!!");
-//                    ret = -1;
-//                }
             }
             break;
 
         default:
             {
-                DBG_ERR("error!!!");
+                DBG_ERR("done");
                 ret = -1;
             }
             break;
@@ -1502,57 +1389,91 @@ int ProcessController::makeCmdHeader(ePACKETTYPE type, unsigned int param, unsig
         return -1;
     }
 
-    /* make header */
-    out->sync = 0x57;
-    out->type = (unsigned char)(0xFF&type);
-    out->param = param;
-    if ( inSize != 0 )
+    return eFuseLength[type];
+}
+
+/* the value in wire byte order. 0: all default(=0), nothing to write */
+int ProcessController::getNVMWriteData(eEFUSETYPE type, unsigned char* out)
+{
+    int length = getNVMValue(type, out);
+    if ( length < 0 )
+    {
+        return -1;
+    }
+
+    int ret = 0;
+    for ( int i = 0; i < length; i++ )
+    {
+        if ( out[i] != 0 )
+        {
+            ret = length;
+            break;
+        }
+    }
+    if ( ret == 0 )
     {
-        out->size[0] = inSize;
+        return 0;
     }
-    if ( optionSize != 0 )
+
+    /* swap the data */
+    for ( int i = 0; (i < (length/2)) && (length > 1); i++ )
     {
-        out->size[1] = optionSize;
+        if ( out[i] == out[length - i - 1] )
+        {
+            continue;
+        }
+        out[i] ^= out[length - i - 1];
+        out[length - i - 1] ^= out[i];
+        out[i] ^= out[length - i - 1];
     }
 
-    return 0;
+    return length;
 }
 
-int ProcessController::sendUploaderFile(void)
+int ProcessController::sendNVMWrite(SerialComm* port, eEFUSETYPE type)
 {
     int ret = -1;
 
-    /* make send packet */
-    unsigned int sendPacketSize = 0;
-    sendPacketSize = uploaderBinarySize + sizeof(UPLOADER_BINARY_PREFIX) + sizeof(uploaderBinarySize);
+    if ( type > EFUSE_TYPE_MAX || type < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
 
-    unsigned char* sendPacket = NULL;
-    sendPacket = new unsigned char[sendPacketSize] {0,};
-    if ( sendPacket == NULL )
+    int sentBytes = 0;
+    int readBytes = 0;
+    unsigned char responseBuffer[128] = {0,};
+    response_t* response = (response_t*)responseBuffer;
+    if ( response == NULL )
     {
         DBG_ERR("error!!!");
         return -1;
     }
-    memcpy(sendPacket, uploaderBinary, uploaderBinarySize);
-    memcpy(sendPacket + uploaderBinarySize, UPLOADER_BINARY_PREFIX, sizeof(UPLOADER_BINARY_PREFIX));
-    memcpy(sendPacket + uploaderBinarySize + sizeof(UPLOADER_BINARY_PREFIX), &uploaderBinarySize, sizeof(uploaderBinarySize));
 
-    /* make SEND PACKET header */
-    cmdPacketHeader_t sendPacketHeader = {0,};
-    ret = makeCmdHeader(PACKET_TYPE_SRAM, SRAM_BASE_ADDR, uploaderBinary, sendPacketSize, uploaderBinarySize, &sendPacketHeader);
-    if ( ret != 0 )
+    unsigned char writeData[32] = {0,};
+    int           writeLength = getNVMWriteData(type, writeData);
+    if ( writeLength < 0 )
+    {
+        return -1;
+    }
+
+    /* default check, if all data is default(=0), do nothing and return success */
+    if ( writeLength == 0 )
+    {
+        return 0;
+    }
+
+    cmdPacketHeader_t sendPacketHeader;
+
+    ret = set->makeCmdHeader(PACKET_TYPE_EFUSE_WRITE, type, writeData, writeLength, 0, &sendPacketHeader);
+    if ( ret < 0 )
     {
         DBG_ERR("error!!!");
-        if ( sendPacket != NULL )
-        {
-            delete[] sendPacket;
-            sendPacket = NULL;
-        }
         return -1;
     }
 
 #ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[UART2SRAM packet]");
+    DBG_LOG("[eFuse Write]");
     DBG_LOG("-PARAMS-----+-VALUES-----");
     DBG_LOG("       sync | 0x%02X", sendPacketHeader.sync);
     DBG_LOG("       type | 0x%02X", sendPacketHeader.type);
@@ -1560,38 +1481,34 @@ int ProcessController::sendUploaderFile(void)
     DBG_LOG(" dwn length | 0x%08X", sendPacketHeader.size[0]);
     DBG_LOG(" app length | 0x%08X", sendPacketHeader.size[1]);
     DBG_LOG("        crc | 0x%08X", sendPacketHeader.crc);
+    fprintf(stdout, "[Log %s#%d]        data | ", __FUNCTION__, __LINE__);
+    for ( int i = 0; i < writeLength; i++ )
+    {
+        fprintf(stdout, "%02X", writeData[i]);
+    }
+    fprintf(stdout, "\n");
     DBG_LOG("------------+------------\n");
 #endif
 
-    int sentBytes = 0;
-    int readBytes = 0;
-    unsigned char responseBuffer[128] = {0,};
-    response_t* response = (response_t*)responseBuffer;
-
-    /* send header */
-    sentBytes = comm->Send((const unsigned char *)&sendPacketHeader, sizeof(cmdPacketHeader_t));
+    /* send header + data */
+    struct iovec sendPacket[2];
+    sendPacket[0].iov_base = (void*)&sendPacketHeader;
+    sendPacket[0].iov_len  = sizeof(cmdPacketHeader_t);
+    sendPacket[1].iov_base = (void*)writeData;
+    sendPacket[1].iov_len  = writeLength;
+    sentBytes = port->SendV(sendPacket, 2, port->GetTransferTimeMs(sizeof(cmdPacketHeader_t) + writeLength) + TX_TIMEOUT_MARGIN_MS);
     if ( sentBytes < 0 )
     {
         DBG_ERR("error!!!");
-        if ( sendPacket != NULL )
-        {
-            delete[] sendPacket;
-            sendPacket = NULL;
-        }
         return -1;
     }
 
     /* receive response */
     memset(responseBuffer, 0x00, sizeof(responseBuffer));
-    readBytes = comm->Receive(responseBuffer, 4);
+    readBytes = port->Receive(responseBuffer, 4, port->GetTransferTimeMs(sizeof(cmdPacketHeader_t) + writeLength) + EFUSE_WRITE_TIMEOUT_MS);
     if ( readBytes < 0 )
     {
         DBG_ERR("error!!!");
-        if ( sendPacket != NULL )
-        {
-            delete[] sendPacket;
-            sendPacket = NULL;
-        }
         return -1;
     }
 
@@ -1600,115 +1517,90 @@ int ProcessController::sendUploaderFile(void)
         DBG_ERR("error!!!");
         DBG_ERR("readBytes %d", readBytes);
         DBG_ERR("%02X %02X %02X %02X", responseBuffer[0], responseBuffer[1], responseBuffer[2], responseBuffer[3]);
-        if ( sendPacket != NULL )
-        {
-            delete[] sendPacket;
-            sendPacket = NULL;
-        }
         return -1;
     }
 
-    /* send uploader image */
-    sentBytes = comm->Send(sendPacket, sendPacketSize);
-    if ( sentBytes < 0 )
-    {
-        DBG_ERR("error!!!");
-        if ( sendPacket != NULL )
-        {
-            delete[] sendPacket;
-            sendPacket = NULL;
-        }
-        return -1;
-    }
+    return 0;
+}
 
-    /* receive response */
-    memset(responseBuffer, 0x00, sizeof(responseBuffer));
-    readBytes = comm->Receive(responseBuffer, 4);
-    if ( readBytes < 0 )
+int ProcessController::sendNVMRead(SerialComm* port, eEFUSETYPE type, unsigned char* out, unsigned int* outLen)
+{
+    int ret = -1;
+
+    if ( type > EFUSE_TYPE_MAX || type < 0 || out == NULL || outLen == NULL )
     {
         DBG_ERR("error!!!");
-        if ( sendPacket != NULL )
-        {
-            delete[] sendPacket;
-            sendPacket = NULL;
-        }
         return -1;
     }
 
-    if ( readBytes == 0 || response->ack != true || response->nak != false )
+    int sentBytes = 0;
+    int readBytes = 0;
+    unsigned char responseBuffer[128] = {0,};
+    response_t* response = (response_t*)responseBuffer;
+    if ( response == NULL )
     {
         DBG_ERR("error!!!");
-        DBG_ERR("readBytes %d", readBytes);
-        DBG_ERR("%02X %02X %02X %02X", responseBuffer[0], responseBuffer[1], responseBuffer[2], responseBuffer[3]);
-        if ( sendPacket != NULL )
-        {
-            delete[] sendPacket;
-            sendPacket = NULL;
-        }
         return -1;
     }
 
-    /* make DONE header */
-    ret = makeCmdHeader(PACKET_TYPE_SRAM, SRAM_BASE_ADDR, uploaderBinary, sendPacketSize, uploaderBinarySize, &sendPacketHeader);
-    if ( ret != 0 )
+    unsigned int readLength = eFuseLength[type];
+
+    cmdPacketHeader_t sendPacketHeader;
+
+    ret = set->makeCmdHeader(PACKET_TYPE_EFUSE_READ, type, NULL, 0, 0, &sendPacketHeader);
+    if ( ret < 0 )
     {
         DBG_ERR("error!!!");
-        if ( sendPacket != NULL )
-        {
-            delete[] sendPacket;
-            sendPacket = NULL;
-        }
         return -1;
     }
 
-    /* send Done */
-    sentBytes = comm->Send((const unsigned char *)&sendPacketHeader, sizeof(cmdPacketHeader_t));
+#ifdef __MP_DEBUG_BUILD__
+    DBG_LOG("[eFuse Read Head]");
+    DBG_LOG("-PARAMS-----+-VALUES-----");
+    DBG_LOG("       sync | 0x%02X", sendPacketHeader.sync);
+    DBG_LOG("       type | 0x%02X", sendPacketHeader.type);
+    DBG_LOG("       addr | 0x%08X", sendPacketHeader.param);
+    DBG_LOG(" dwn length | 0x%08X", sendPacketHeader.size[0]);
+    DBG_LOG(" app length | 0x%08X", sendPacketHeader.size[1]);
+    DBG_LOG("        crc | 0x%08X", sendPacketHeader.crc);
+    DBG_LOG("------------+------------\n");
+#endif
+
+    /* send header */
+    sentBytes = port->Send((const unsigned char *)&sendPacketHeader, sizeof(cmdPacketHeader_t),
+                           port->GetTransferTimeMs(sizeof(cmdPacketHeader_t)) + TX_TIMEOUT_MARGIN_MS);
     if ( sentBytes < 0 )
     {
         DBG_ERR("error!!!");
-        if ( sendPacket != NULL )
-        {
-            delete[] sendPacket;
-            sendPacket = NULL;
-        }
         return -1;
     }
 
-    /* receive start message */
+    /* receive response */
     memset(responseBuffer, 0x00, sizeof(responseBuffer));
-    readBytes = comm->Receive(responseBuffer, 10);
-    if ( readBytes <= 0 )
+    readBytes = port->Receive(responseBuffer, readLength, port->GetTransferTimeMs(sizeof(cmdPacketHeader_t) + readLength) + EFUSE_READ_TIMEOUT_MS);
+    if ( readBytes < 0 )
     {
         DBG_ERR("error!!!");
-        if ( sendPacket != NULL )
-        {
-            delete[] sendPacket;
-            sendPacket = NULL;
-        }
         return -1;
     }
-#ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[Message from MS500]");
-    for ( int i = 0; i < readBytes; i++ )
-    {
-        DBG_LOG("%02X ", responseBuffer[i]);
-    }
-    fprintf(stdout, "\n");
-#endif /* __MP_DEBUG_BUILD__ */
-    if ( sendPacket != NULL )
-    {
-        delete[] sendPacket;
-        sendPacket = NULL;
-    }
+
+    /* swap and copy */
+    *outLen = readLength;
+	memcpy(out, responseBuffer, readLength);
 
     return 0;
 }
 
-int ProcessController::sendDataToFlash(const unsigned char* in, unsigned int inLen, unsigned int addr)
+/*
+ * writes the given fields in one PACKET_TYPE_EFUSE_BATCH and reads every field back in the
+ * same reply. default(=0) fields are left out of the list, like sendNVMWrite() skips them.
+ * 0: image[EFUSE_IMAGE_SIZE] filled, 1: the uploader has no batch packet(NAK or no answer).
+ */
+int ProcessController::sendNVMBatch(SerialComm* port, const eEFUSETYPE* types, int count, unsigned char* image)
 {
     int ret = -1;
 
-    if ( in == NULL || inLen <= 0 )
+    if ( types == NULL || count < 0 || count > EFUSE_TYPE_MAX || image == NULL )
     {
         DBG_ERR("error!!!");
         return -1;
@@ -1716,100 +1608,118 @@ int ProcessController::sendDataToFlash(const unsigned char* in, unsigned int inL
 
     int sentBytes = 0;
     int readBytes = 0;
-    unsigned char responseBuffer[128] = {0,};
+    unsigned char responseBuffer[EFUSE_IMAGE_SIZE + sizeof(unsigned int)] = {0,};
     response_t* response = (response_t*)responseBuffer;
-    if ( response == NULL )
+
+    /* TLV list */
+    unsigned char payload[EFUSE_BATCH_MAX_SIZE] = {0,};
+    unsigned int  payloadLength = 0;
+    unsigned int  entries = 0;
+    for ( int i = 0; i < count; i++ )
     {
-        DBG_ERR("error!!!");
-        return -1;
-    }
+        eFuseTlv_t* tlv = (eFuseTlv_t*)(payload + payloadLength);
+
+        ret = getNVMWriteData(types[i], payload + payloadLength + sizeof(eFuseTlv_t));
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+        if ( ret == 0 )
+        {
+            continue;
+        }
 
-    unsigned int base      = 0;
-    unsigned int loopCount = 0;
-    unsigned int sendSize  = 0;
+        tlv->type   = (unsigned char)types[i];
+        tlv->length = (unsigned char)ret;
+        payloadLength += sizeof(eFuseTlv_t) + ret;
+        entries++;
+    }
 
     cmdPacketHeader_t sendPacketHeader;
 
-    loopCount = ((inLen + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE);
-    if ( loopCount <= 0 )
+    ret = set->makeCmdHeader(PACKET_TYPE_EFUSE_BATCH, entries, payload, payloadLength, 0, &sendPacketHeader);
+    if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    for ( unsigned int i = 0; i < loopCount; i++ )
-    {
-        base = i * FLASH_SECTOR_SIZE;
-        if ( FLASH_SECTOR_SIZE > inLen - base )
-        {
-            sendSize = inLen - base;
-        }
-        else
-        {
-            sendSize = FLASH_SECTOR_SIZE;
-        }
-
-        ret = makeCmdHeader(PACKET_TYPE_FLASH, addr + base, (unsigned char*)(in + base), sendSize, inLen, &sendPacketHeader);
-        if ( ret < 0 )
-        {
-            DBG_ERR("error!!!");
-            return -1;
-        }
-
 #ifdef __MP_DEBUG_BUILD__
-        DBG_LOG("[SEND BLOCK#%d]", i);
-        DBG_LOG("-PARAMS-----+-VALUES-----");
-        DBG_LOG("       sync | 0x%02X", sendPacketHeader.sync);
-        DBG_LOG("       type | 0x%02X", sendPacketHeader.type);
-        DBG_LOG("       addr | 0x%08X", sendPacketHeader.param);
-        DBG_LOG(" dwn length | 0x%08X", sendPacketHeader.size[0]);
-        DBG_LOG(" app length | 0x%08X", sendPacketHeader.size[1]);
-        DBG_LOG("        crc | 0x%08X", sendPacketHeader.crc);
-        DBG_LOG("------------+------------\n");
+    DBG_LOG("[eFuse Batch]");
+    DBG_LOG("-PARAMS-----+-VALUES-----");
+    DBG_LOG("       sync | 0x%02X", sendPacketHeader.sync);
+    DBG_LOG("       type | 0x%02X", sendPacketHeader.type);
+    DBG_LOG("    entries | %d", sendPacketHeader.param);
+    DBG_LOG(" dwn length | 0x%08X", sendPacketHeader.size[0]);
+    DBG_LOG("        crc | 0x%08X", sendPacketHeader.crc);
+    fprintf(stdout, "[Log %s#%d]        data | ", __FUNCTION__, __LINE__);
+    for ( unsigned int i = 0; i < payloadLength; i++ )
+    {
+        fprintf(stdout, "%02X", payload[i]);
+    }
+    fprintf(stdout, "\n");
+    DBG_LOG("------------+------------\n");
 #endif
 
-        /* send header */
-        sentBytes = comm->Send((const unsigned char *)&sendPacketHeader, sizeof(cmdPacketHeader_t));
-        if ( sentBytes < 0 )
-        {
-            DBG_ERR("error!!!");
-            return -1;
-        }
+    /* send header + list */
+    struct iovec sendPacket[2];
+    sendPacket[0].iov_base = (void*)&sendPacketHeader;
+    sendPacket[0].iov_len  = sizeof(cmdPacketHeader_t);
+    sendPacket[1].iov_base = (void*)payload;
+    sendPacket[1].iov_len  = payloadLength;
+    sentBytes = port->SendV(sendPacket, (payloadLength != 0) ? 2 : 1,
+                            port->GetTransferTimeMs(sizeof(cmdPacketHeader_t) + payloadLength) + TX_TIMEOUT_MARGIN_MS);
+    if ( sentBytes < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
 
-        /* send uploader image */
-        sentBytes = comm->Send(in + base, sendSize);
-        if ( sentBytes < 0 )
-        {
-            DBG_ERR("error!!!");
-            return -1;
-        }
+    /* receive response, the ack comes once every entry is burnt */
+    memset(responseBuffer, 0x00, sizeof(responseBuffer));
+    readBytes = port->Receive(responseBuffer, 4, port->GetTransferTimeMs(sizeof(cmdPacketHeader_t) + payloadLength)
+                                                 + entries * EFUSE_WRITE_TIMEOUT_MS + EFUSE_READ_TIMEOUT_MS);
+    if ( readBytes < 0 || response->ack != true || response->nak != false )
+    {
+        DBG_LOG("eFuse batch refused, one field at a time");
+        port->Flush();
+        return 1;
+    }
 
-        /* receive response */
-        memset(responseBuffer, 0x00, sizeof(responseBuffer));
-        readBytes = comm->Receive(responseBuffer, 4);
-        if ( readBytes < 0 )
-        {
-            DBG_ERR("error!!!");
-            return -1;
-        }
+    /* receive image + crc */
+    memset(responseBuffer, 0x00, sizeof(responseBuffer));
+    readBytes = port->Receive(responseBuffer, sizeof(responseBuffer), port->GetTransferTimeMs(sizeof(responseBuffer)) + EFUSE_READ_TIMEOUT_MS);
+    if ( readBytes < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
 
-        if ( readBytes == 0 || response->ack != true || response->nak != false )
-        {
-            DBG_ERR("error!!!");
-            DBG_ERR("readBytes %d", readBytes);
-            DBG_ERR("%02X %02X %02X %02X", responseBuffer[0], responseBuffer[1], responseBuffer[2], responseBuffer[3]);
-            return -1;
-        }
+    unsigned int crc = 0;
+    memcpy(&crc, responseBuffer + EFUSE_IMAGE_SIZE, sizeof(crc));
+    if ( CRC32::CalcCRC32(responseBuffer, EFUSE_IMAGE_SIZE) != crc )
+    {
+        DBG_ERR("eFuse image crc error");
+        return -1;
     }
 
+    memcpy(image, responseBuffer, EFUSE_IMAGE_SIZE);
+
     return 0;
 }
 
-int ProcessController::sendSDBDataToFlash(const unsigned char* in, unsigned int inLen)
+/*
+ * CRC32 the device computes over a flash range or a stored SDB entry(info: its info header),
+ * CRC_TARGET_SECTORS: one per sector of the range into crc[].
+ * 0: crc set, 1: no answer(NAK, nothing stored or an uploader without the target).
+ */
+int ProcessController::sendCrcQuery(SerialComm* port, eCRCTARGET target, unsigned int addr, unsigned int length, const unsigned char* info, unsigned int* crc)
 {
     int ret = -1;
 
-    if ( in == NULL || inLen <= 0 )
+    unsigned int crcCount = (target == CRC_TARGET_SECTORS) ? ((length + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE) : 1;
+    if ( crc == NULL || (target == CRC_TARGET_SDB && info == NULL) || crcCount > FLASH_CRC_SECTOR_MAX )
     {
         DBG_ERR("error!!!");
         return -1;
@@ -1819,357 +1729,399 @@ int ProcessController::sendSDBDataToFlash(const unsigned char* in, unsigned int
     int readBytes = 0;
     unsigned char responseBuffer[128] = {0,};
     response_t* response = (response_t*)responseBuffer;
-    if ( response == NULL )
-    {
-        DBG_ERR("error!!!");
-        return -1;
-    }
-
-    unsigned int base      = 0;
-    unsigned int loopCount = 0;
-    unsigned int sendSize  = 0;
 
     cmdPacketHeader_t sendPacketHeader;
 
-    ret = makeCmdHeader(PACKET_TYPE_FLASH_SDB, 0, (unsigned char*)(in), inLen, inLen, &sendPacketHeader);
+    if ( target == CRC_TARGET_SDB )
+    {
+        ret = set->makeCmdHeader(PACKET_TYPE_CRC, 0, info, SDB_INFO_HEADER_SIZE, 0, &sendPacketHeader);
+    }
+    else
+    {
+        ret = set->makeCmdHeader(PACKET_TYPE_CRC, addr, NULL, 0, length, &sendPacketHeader);
+    }
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
+    sendPacketHeader.reserved[0] = (unsigned char)target;
 
-#ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[SEND SDB]");
-    DBG_LOG("-PARAMS-----+-VALUES-----");
-    DBG_LOG("       sync | 0x%02X", sendPacketHeader.sync);
-    DBG_LOG("       type | 0x%02X", sendPacketHeader.type);
-    DBG_LOG("       addr | 0x%08X", sendPacketHeader.param);
-    DBG_LOG(" dwn length | 0x%08X", sendPacketHeader.size[0]);
-    DBG_LOG(" app length | 0x%08X", sendPacketHeader.size[1]);
-    DBG_LOG("        crc | 0x%08X", sendPacketHeader.crc);
-    DBG_LOG("------------+------------\n");
-#endif
-
-        /* send header */
-        sentBytes = comm->Send((const unsigned char *)&sendPacketHeader, sizeof(cmdPacketHeader_t));
-        if ( sentBytes < 0 )
-        {
-            DBG_ERR("error!!!");
-            return -1;
-        }
-
-        /* send uploader image */
-        sentBytes = comm->Send(in, inLen);
-        if ( sentBytes < 0 )
-        {
-            DBG_ERR("error!!!");
-            return -1;
-        }
+    /* send header(+ sdb info) */
+    unsigned int   infoLen = (target == CRC_TARGET_SDB) ? SDB_INFO_HEADER_SIZE : 0;
+    struct iovec sendPacket[2];
+    sendPacket[0].iov_base = (void*)&sendPacketHeader;
+    sendPacket[0].iov_len  = sizeof(cmdPacketHeader_t);
+    sendPacket[1].iov_base = (void*)info;
+    sendPacket[1].iov_len  = infoLen;
+    sentBytes = port->SendV(sendPacket, (infoLen > 0) ? 2 : 1, port->GetTransferTimeMs(sizeof(cmdPacketHeader_t) + infoLen) + TX_TIMEOUT_MARGIN_MS);
+    if ( sentBytes < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
 
-        /* receive response */
-        memset(responseBuffer, 0x00, sizeof(responseBuffer));
-        readBytes = comm->Receive(responseBuffer, 4);
-        if ( readBytes < 0 )
-        {
-            DBG_ERR("error!!!");
-            return -1;
-        }
+    /* receive response */
+    memset(responseBuffer, 0x00, sizeof(responseBuffer));
+    readBytes = port->Receive(responseBuffer, 4, port->GetTransferTimeMs(sizeof(cmdPacketHeader_t) + infoLen) + CRC_TIMEOUT_MS);
+    if ( readBytes < 0 || response->ack != true || response->nak != false )
+    {
+        port->Flush();
+        return 1;
+    }
 
-        if ( readBytes == 0 || response->ack != true || response->nak != false )
-        {
-            DBG_ERR("error!!!");
-            DBG_ERR("readBytes %d", readBytes);
-            DBG_ERR("%02X %02X %02X %02X", responseBuffer[0], responseBuffer[1], responseBuffer[2], responseBuffer[3]);
-            return -1;
-        }
+    /* receive crc(s) */
+    readBytes = port->Receive((unsigned char*)crc, crcCount * sizeof(unsigned int), port->GetTransferTimeMs(crcCount * sizeof(unsigned int)) + ACK_TIMEOUT_MS);
+    if ( readBytes < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
 
     return 0;
 }
-int ProcessController::sendSdbInfo(void)
+
+/*
+ * rework pre-scan: reads the eFuses and the device CRCs of the app regions and SDB entries,
+ * then sets report->skipped for every step whose target state already matches. a query the
+ * device can't answer leaves its step to run as usual.
+ * sdbSkip: bit n set, SDB_n is stored(the SDB step runs for the rest).
+ */
+int ProcessController::scanDevice(SerialComm* port, deviceReport_t* report, unsigned int* sdbSkip)
 {
-    int index = 0;
     int ret = -1;
-    
-    while ( 1 )
+
+    unsigned char image[EFUSE_IMAGE_SIZE] = {0,};
+    unsigned char value[32] = {0,};
+    int           length = 0;
+    unsigned int  crc = 0;
+
+    *sdbSkip = 0;
+
+    /* eFuse state: a read-all batch, one read per field on older uploaders */
+    ret = sendNVMBatch(port, eFuseBatchTypes, 0, image);
+    if ( ret < 0 )
     {
-        ret = parseSdb(index++);
+        DBG_ERR("error!!!");
+        return -1;
+    }
+    if ( ret == 1 )
+    {
+        eEFUSETYPE readTypes[EFUSE_BATCH_TYPE_COUNT + 2] = { EFUSE_TYPE_UKEY, EFUSE_TYPE_PKF };
+        memcpy(&readTypes[2], eFuseBatchTypes, sizeof(eFuseBatchTypes));
+
+        for ( int i = 0; i < EFUSE_BATCH_TYPE_COUNT + 2; i++ )
         {
+            unsigned int readLength = 0;
+            ret = sendNVMRead(port, readTypes[i], image + eFuseImageOffset(readTypes[i]), &readLength);
             if ( ret < 0 )
             {
-                DBG_ERR("parseSdb error");
+                DBG_ERR("error!!!");
                 return -1;
             }
-            else
-            if ( ret == 1 )
-            {
-                return 0;
-            }
         }
-        
-        ret = sendSDBDataToFlash(sdbCodePacket, sdbCodePacketSize);
-        if ( sdbCodePacket != NULL )
+    }
+
+    length = getNVMValue(EFUSE_TYPE_UKEY, value);
+    if ( length > 0 && memcmp(image + eFuseImageOffset(EFUSE_TYPE_UKEY), value, length) == 0 )
+    {
+        report->skipped |= PHASE_BIT(PHASE_UKEY);
+    }
+
+    /* without PKFWRITE the step only reads the PKf back */
+    length = getNVMValue(EFUSE_TYPE_PKF, value);
+    if ( set->eFusePKfWrite == 0
+      || (length > 0 && memcmp(image + eFuseImageOffset(EFUSE_TYPE_PKF), value, length) == 0) )
+    {
+        report->skipped |= PHASE_BIT(PHASE_PKF);
+    }
+
+    /* the locks go in one batch, all of them must match */
+    ret = 0;
+    for ( int i = 0; i < EFUSE_BATCH_TYPE_COUNT; i++ )
+    {
+        length = getNVMValue(eFuseBatchTypes[i], value);
+        if ( length <= 0 || memcmp(image + eFuseImageOffset(eFuseBatchTypes[i]), value, length) != 0 )
+        {
+            ret = -1;
+            break;
+        }
+    }
+    if ( ret == 0 )
+    {
+        for ( int i = PHASE_UKEY_LOCK; i <= PHASE_EFUSE_BATCH; i++ )
         {
-            delete[] sdbCodePacket;
-            sdbCodePacket     = NULL;
-            sdbCodePacketSize = 0;
+            report->skipped |= PHASE_BIT(i);
         }
-        
+    }
+
+    /* app(+ PKA, signature) regions */
+    ret = 0;
+    for ( int i = IMAGE_REGION_APP; i < IMAGE_REGION_MAX; i++ )
+    {
+        const sectorTable_t* table = &set->sectorTable[i];
+        if ( table->header == NULL )
+        {
+            continue;
+        }
+
+        ret = sendCrcQuery(port, CRC_TARGET_FLASH, table->addr, table->size, NULL, &crc);
         if ( ret < 0 )
         {
-            DBG_ERR(".ini error");
+            DBG_ERR("error!!!");
             return -1;
         }
+        if ( ret == 1 || crc != table->crc )
+        {
+            ret = -1;
+            break;
+        }
     }
-    
-    return ret;
-}
-int ProcessController::sendAppImageFirmware(void)
-{
-    int ret = -1;
-
-    /* Send App and Erase Flash */
-    ret = sendDataToFlash(appCodeBinary, appCodeBinarySize, APP_IMAGE_BASE_ADDR);
-    if ( ret < 0 )
+    if ( ret == 0 )
     {
-        DBG_ERR("error!!!");
-        return -1;
+        report->skipped |= PHASE_BIT(PHASE_APP);
     }
 
-    if ( secureBootEnabled == 1 )
+    /* sdb entries */
+    const unsigned char* sdbInfoHeader = NULL;
+    const unsigned char* sdbData = NULL;
+    unsigned int         sdbDataSize = 0;
+    unsigned int         sdbCrc = 0;
+    int                  index = 0;
+    int                  stored = 0;
+    int                  listed = 0;   /* 1: every entry was queried */
+    while ( index < SDB_SKIP_MAX )
     {
-        /* Send PKA */
-        ret = sendDataToFlash(pkaBinary, pkaBinarySize, PKA_BASE_ADDR);
+        ret = set->getSdb(index, &sdbInfoHeader, &sdbData, &sdbDataSize, &sdbCrc);
         if ( ret < 0 )
         {
-            DBG_ERR("error!!!");
+            DBG_ERR("getSdb error");
             return -1;
         }
+        else
+        if ( ret == 1 )
+        {
+            listed = 1;
+            break;
+        }
 
-        /* Send Signature */
-        ret = sendDataToFlash(signatureBinary, signatureBinarySize, APP_BASE_ADDR);
+        ret = sendCrcQuery(port, CRC_TARGET_SDB, 0, 0, sdbInfoHeader, &crc);
+        if ( ret == 0 && crc == sdbCrc )
+        {
+            *sdbSkip |= (1U << index);
+            stored++;
+        }
         if ( ret < 0 )
         {
             DBG_ERR("error!!!");
             return -1;
         }
+        index++;
+    }
+    if ( listed == 1 && stored > 0 && stored == index )
+    {
+        report->skipped |= PHASE_BIT(PHASE_SDB);
+    }
+
+    char skipped[256] = {0,};
+    for ( int i = PHASE_UPLOADER; i < PHASE_DEVICE_TOTAL; i++ )
+    {
+        if ( (report->skipped & PHASE_BIT(i)) != 0 )
+        {
+            snprintf(skipped + strlen(skipped), sizeof(skipped) - strlen(skipped), " %s", LatencyStats::GetPhaseName((ePHASE)i));
+        }
     }
+    DBG_LOG("pre-scan: already programmed:%s, sdb 0x%08X", (skipped[0] != '\0') ? skipped : " none", *sdbSkip);
 
-    return ret;
+    return 0;
 }
 
-int ProcessController::sendNVMWrite(eEFUSETYPE type)
+int ProcessController::ProcessInit(void)
 {
     int ret = -1;
 
-    if ( type > EFUSE_TYPE_MAX || type < 0 )
+    ImageSet* next = NULL;
+
+    if ( gpio->GetBackendName() == NULL )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    int sentBytes = 0;
-    int readBytes = 0;
-    unsigned char responseBuffer[128] = {0,};
-    response_t* response = (response_t*)responseBuffer;
-    if ( response == NULL )
+#ifdef __MP_DEBUG_BUILD__
+    DBG_LOG("[%s]", __FUNCTION__);
+    DBG_LOG("        GPIO Backend | %s", gpio->GetBackendName());
+    DBG_LOG("    Result File Name | %s", (resultFileName != NULL) ? resultFileName : "(none)");
+#endif
+
+    /* a unit whose result path is missing or read-only still flashes, it only keeps no record */
+    if ( resultFileName != NULL )
     {
-        DBG_ERR("error!!!");
-        return -1;
+        ret = resultLog->Open(resultFileName);
+        if ( ret != 0 )
+        {
+            DBG_ERR("result log %s: not writable, running without it", resultFileName);
+        }
     }
 
-    unsigned int   writeLength = eFuseLength[type];
-    unsigned char* writeData = new unsigned char[writeLength] {0,};
-    if ( writeData == NULL )
+    pthread_mutex_lock(&loadMutex);
+    next = loadSet(configFileName, uploaderFileName, appImageFileName, sdbInfoFileName);
+    pthread_mutex_unlock(&loadMutex);
+    if ( next == NULL )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    ret = -1;
-    switch ( type )
-    {
-        case EFUSE_BOOT_SRC:
-            {
-                memcpy(writeData, &eFuseBootSource, writeLength);
-                ret = 0;
-            }
-            break;
-
-        case EFUSE_SB_EN:
-            {
-                memcpy(writeData, &eFuseSecureBootEnable, writeLength);
-                ret = 0;
-            }
-            break;
-
-        case EFUSE_TYPE_UKEY_LOCK:
-            {
-                memcpy(writeData, &eFuseUKeyLock, writeLength);
-                ret = 0;
-            }
-            break;
-
-        case EFUSE_TYPE_PKF_LOCK:
-            {
-                memcpy(writeData, &eFusePKfLock, writeLength);
-                ret = 0;
-            }
-            break;
+    swapSet(next);
 
-        case EFUSE_TYPE_DUK_LOCK:
-            {
-                memcpy(writeData, &eFuseDUKLock, writeLength);
-                ret = 0;
-                
-            }
-            break;
-			
-		case EFUSE_WRITE_PKF:
-			break;
-			
-        case EFUSE_TYPE_UKEY:
-            {
-                memcpy(writeData, eFuseUKey, writeLength);
-                ret = 0;
-            }
-            break;
+    return 0;
+}
 
-        case EFUSE_TYPE_PKF:
-            {
-                memcpy(writeData, eFusePKf, writeLength);
-                ret = 0;
-            }
-            break;
+int ProcessController::sendUKey(SerialComm* port)
+{
+    int ret = -1;
 
-        default:
-            {
-                DBG_ERR("done");
-                ret = -1;
-            }
-            break;
-    }
+    unsigned int  eFuseLen = 0;
+    unsigned char eFuseBuffer[128] = {0,};
 
+    /* eFuse the UKey */
+    ret = sendNVMWrite(port, EFUSE_TYPE_UKEY);
     if ( ret < 0 )
     {
+        DBG_ERR("error!!!");
         return -1;
     }
 
-    /* default check, if all data is default(=0), do nothing and return success */
-    ret = 1;
-    
-    for ( int i = 0; i < writeLength; i++ )
-    {
-        if ( writeData[i] != 0 )
-        {
-            ret = 0;
-            break;
-        }
-    }
-    if ( ret == 1 )
+    /* read the UKey */
+    eFuseLen = 0;
+    memset(eFuseBuffer, 0x00, sizeof(eFuseBuffer));
+    ret = sendNVMRead(port, EFUSE_TYPE_UKEY, eFuseBuffer, &eFuseLen);
+    if ( ret < 0 )
     {
-        return 0;
+        DBG_ERR("error!!!");
+        return -1;
     }
 
-    /* swap the writeData */
-    for ( int i = 0; (i < (writeLength/2)) && (writeLength > 1); i++ )
+    /* check a value */
+    ret = 0;
+#ifdef __MP_DEBUG_BUILD__
+    DBG_LOG("[UKey]");
+    DBG_LOG("-PARAMS-+-VALUES-----------------------------------------------------------");
+    fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
+    fprintf(stdout, "   data | ");
+#endif
+    for ( int i = 0; i < eFuseLen; i++ )
     {
-        if ( writeData[i] == writeData[writeLength - i - 1] )
+#ifdef __MP_DEBUG_BUILD__
+        fprintf(stdout, "%02X", eFuseBuffer[i]);
+#endif
+        if ( eFuseBuffer[i] != set->eFuseUKey[i] )
         {
-            continue;
+            ret = -1;
         }
-        writeData[i] ^= writeData[writeLength - i - 1];
-        writeData[writeLength - i - 1] ^= writeData[i];
-        writeData[i] ^= writeData[writeLength - i - 1];
     }
-
-    cmdPacketHeader_t sendPacketHeader;
-
-    ret = makeCmdHeader(PACKET_TYPE_EFUSE_WRITE, type, writeData, writeLength, 0, &sendPacketHeader);
+#ifdef __MP_DEBUG_BUILD__
+    fprintf(stdout, "\n");
+    DBG_LOG("--------+------------------------------------------------------------------\n");
+#endif
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-#ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[eFuse Write]");
-    DBG_LOG("-PARAMS-----+-VALUES-----");
-    DBG_LOG("       sync | 0x%02X", sendPacketHeader.sync);
-    DBG_LOG("       type | 0x%02X", sendPacketHeader.type);
-    DBG_LOG("       addr | 0x%08X", sendPacketHeader.param);
-    DBG_LOG(" dwn length | 0x%08X", sendPacketHeader.size[0]);
-    DBG_LOG(" app length | 0x%08X", sendPacketHeader.size[1]);
-    DBG_LOG("        crc | 0x%08X", sendPacketHeader.crc);
-    fprintf(stdout, "[Log %s#%d]        data | ", __FUNCTION__, __LINE__);
-    for ( int i = 0; i < writeLength; i++ )
-    {
-        fprintf(stdout, "%02X", writeData[i]);
-    }
-    fprintf(stdout, "\n");
-    DBG_LOG("------------+------------\n");
-#endif
+    return 0;
+}
 
-    /* send header */
-    sentBytes = comm->Send((const unsigned char *)&sendPacketHeader, sizeof(cmdPacketHeader_t));
-    if ( sentBytes < 0 )
-    {
-        DBG_ERR("error!!!");
-        return -1;
-    }
+int ProcessController::sendPKf(SerialComm* port)
+{
+    int ret = -1;
 
-    /* send data */
-    sentBytes = comm->Send(writeData, writeLength);
-    if ( sentBytes < 0 )
+    unsigned int  eFuseLen = 0;
+    unsigned char eFuseBuffer[128] = {0,};
+
+	if(set->eFusePKfWrite == 1)
+	{
+		/* eFuse the PKf */
+		ret = sendNVMWrite(port, EFUSE_TYPE_PKF);
+		DBG_LOG("[PKf WRITE]");
+		if ( ret < 0 )
+		{
+			DBG_ERR("error!!!");
+			return -1;
+		}
+	}
+	
+    /* read the PKf */
+    eFuseLen = 0;
+    memset(eFuseBuffer, 0x00, sizeof(eFuseBuffer));
+    ret = sendNVMRead(port, EFUSE_TYPE_PKF, eFuseBuffer, &eFuseLen);
+    if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* receive response */
-    memset(responseBuffer, 0x00, sizeof(responseBuffer));
-    readBytes = comm->Receive(responseBuffer, 4);
-    if ( readBytes < 0 )
+    /* check a value */
+    ret = 0;
+#ifdef __MP_DEBUG_BUILD__
+    DBG_LOG("[PKf]");
+
+	if(set->eFusePKfWrite == 0)
+	DBG_LOG("[PKf Write Skip]");
+	
+    DBG_LOG("-PARAMS-+-VALUES-----------------------------------------------------------");
+    fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
+    fprintf(stdout, "    data | ");
+#endif
+    for ( int i = 0; i < eFuseLen; i++ )
     {
-        DBG_ERR("error!!!");
-        return -1;
+#ifdef __MP_DEBUG_BUILD__
+        fprintf(stdout, "%02X", eFuseBuffer[i]);
+#endif
+		/*PKF Write Skip*/
+		if(set->eFusePKfWrite == 1)
+		{
+			if ( eFuseBuffer[i] != set->eFusePKf[i] )
+			{
+				ret = -1;
+			}
+		}
     }
-
-    if ( readBytes == 0 || response->ack != true || response->nak != false )
+#ifdef __MP_DEBUG_BUILD__
+    fprintf(stdout, "\n");
+    DBG_LOG("--------+------------------------------------------------------------------\n");
+#endif
+    if ( ret < 0 )
     {
         DBG_ERR("error!!!");
-        DBG_ERR("readBytes %d", readBytes);
-        DBG_ERR("%02X %02X %02X %02X", responseBuffer[0], responseBuffer[1], responseBuffer[2], responseBuffer[3]);
         return -1;
     }
 
     return 0;
 }
 
-int ProcessController::sendNVMRead(eEFUSETYPE type, unsigned char* out, unsigned int* outLen)
+/* one write + read back round trip per field, for uploaders without PACKET_TYPE_EFUSE_BATCH */
+int ProcessController::sendNVMLocks(SerialComm* port, deviceReport_t* report, struct timespec* mark)
 {
     int ret = -1;
 
-    if ( type > EFUSE_TYPE_MAX || type < 0 || out == NULL || outLen == NULL )
-    {
-        DBG_ERR("error!!!");
-        return -1;
-    }
+    unsigned int  eFuseLen = 0;
+    unsigned char eFuseBuffer[128] = {0,};
 
-    int sentBytes = 0;
-    int readBytes = 0;
-    unsigned char responseBuffer[128] = {0,};
-    response_t* response = (response_t*)responseBuffer;
-    if ( response == NULL )
+    /* eFuse the UKey Lock */
+    ret = sendNVMWrite(port, EFUSE_TYPE_UKEY_LOCK);
+    if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    unsigned int readLength = eFuseLength[type];
-
-    cmdPacketHeader_t sendPacketHeader;
-
-    ret = makeCmdHeader(PACKET_TYPE_EFUSE_READ, type, NULL, 0, 0, &sendPacketHeader);
+    /* read the UKey Lock */
+    eFuseLen = 0;
+    memset(eFuseBuffer, 0x00, sizeof(eFuseBuffer));
+    ret = sendNVMRead(port, EFUSE_TYPE_UKEY_LOCK, eFuseBuffer, &eFuseLen);
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
@@ -2177,554 +2129,890 @@ int ProcessController::sendNVMRead(eEFUSETYPE type, unsigned char* out, unsigned
     }
 
 #ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[eFuse Read Head]");
-    DBG_LOG("-PARAMS-----+-VALUES-----");
-    DBG_LOG("       sync | 0x%02X", sendPacketHeader.sync);
-    DBG_LOG("       type | 0x%02X", sendPacketHeader.type);
-    DBG_LOG("       addr | 0x%08X", sendPacketHeader.param);
-    DBG_LOG(" dwn length | 0x%08X", sendPacketHeader.size[0]);
-    DBG_LOG(" app length | 0x%08X", sendPacketHeader.size[1]);
-    DBG_LOG("        crc | 0x%08X", sendPacketHeader.crc);
-    DBG_LOG("------------+------------\n");
+    DBG_LOG("[UKey Lock]");
+    DBG_LOG("-PARAMS-+-VALUES-");
+    DBG_LOG("   data | ");
+#endif
+#ifdef __MP_DEBUG_BUILD__
+    DBG_LOG("%02X", eFuseBuffer[0]);
+    DBG_LOG("--------+--------\n");
 #endif
 
-    /* send header */
-    sentBytes = comm->Send((const unsigned char *)&sendPacketHeader, sizeof(cmdPacketHeader_t));
-    if ( sentBytes < 0 )
+    /* check a value */
+    if ( eFuseBuffer[0] != set->eFuseUKeyLock )
     {
         DBG_ERR("error!!!");
         return -1;
     }
+    markPhase(report, PHASE_UKEY_LOCK, mark);
 
-    /* receive response */
-    memset(responseBuffer, 0x00, sizeof(responseBuffer));
-    readBytes = comm->Receive(responseBuffer, readLength);
-    if ( readBytes < 0 )
+    /* eFuse the PKf Lock */
+    ret = sendNVMWrite(port, EFUSE_TYPE_PKF_LOCK);
+    if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* swap and copy */
-    *outLen = readLength;
-	memcpy(out, responseBuffer, readLength);
-
-    return 0;
-}
-
-int ProcessController::ProcessInit(void)
-{
-    int ret = -1;
-
-    ret = parseConfigFile();
-    if ( ret != 0 )
+    /* read the PKf Lock */
+    eFuseLen = 0;
+    memset(eFuseBuffer, 0x00, sizeof(eFuseBuffer));
+    ret = sendNVMRead(port, EFUSE_TYPE_PKF_LOCK, eFuseBuffer, &eFuseLen);
+    if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
 #ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[%s]", __FUNCTION__);
-    DBG_LOG("-PARAMS--------------+-VALUES-----------------------------------------------------------");
-    DBG_LOG("    Config File Name | %s", configFileName);
-    DBG_LOG("  Uploader File Name | %s", uploaderFileName);
-    DBG_LOG(" App Image File Name | %s", appImageFileName);
-    DBG_LOG(" sdbinfo   File Name | %s", sdbInfoFileName);
-    DBG_LOG("         Boot Source | 0x%02X", eFuseBootSource);
-    DBG_LOG("  Secure Boot Enable | %d", eFuseSecureBootEnable);
-    DBG_LOG("           UKey Lock | %d", eFuseUKeyLock);
-    DBG_LOG("            PKf Lock | %d", eFusePKfLock);
-    DBG_LOG("            DUK Lock | %d", eFuseDUKLock);
-	DBG_LOG("            PKF Skip | %d", eFusePKfWrite);
-    fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
-    fprintf(stdout, "                UKey | ");
-    for ( int i = 0; i < sizeof(eFuseUKey); i++ )
-    {
-        fprintf(stdout, "%02X", eFuseUKey[i]);
-    }
-    fprintf(stdout, "\n");
+    DBG_LOG("[PKf Lock]");
+    DBG_LOG("-PARAMS-+-VALUES-");
     fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
-    fprintf(stdout, "                 PKf | ");
-    for ( int i = 0; i < sizeof(eFusePKf); i++ )
+    fprintf(stdout, "    data | ");
+    for ( int i = 0; i < eFuseLen; i++ )
     {
-        fprintf(stdout, "%02X", eFusePKf[i]);
+        fprintf(stdout, "%02X", eFuseBuffer[i]);
     }
     fprintf(stdout, "\n");
-    DBG_LOG("---------------------+------------------------------------------------------------------\n");
+    DBG_LOG("--------+--------\n");
 #endif
 
-    ret = openUploaderFile();
-    if ( ret != 0 )
+    /* check a value */
+    if ( eFuseBuffer[0] != set->eFusePKfLock )
     {
         DBG_ERR("error!!!");
         return -1;
     }
+    markPhase(report, PHASE_PKF_LOCK, mark);
 
-    ret = openAppImageFile();
-    if ( ret != 0 )
+    /* eFuse the DUK Lock */
+    ret = sendNVMWrite(port, EFUSE_TYPE_DUK_LOCK);
+    if ( ret < 0 )
     {
-        DBG_ERR("appImageFileName: %s", appImageFileName);
         DBG_ERR("error!!!");
         return -1;
     }
-    return 0;
-}
 
-int ProcessController::downloadProcess(eSOCKETCHANNEL ch)
-{
-    int ret = -1;
+    /* read the DUK Lock */
+    eFuseLen = 0;
+    memset(eFuseBuffer, 0x00, sizeof(eFuseBuffer));
+    ret = sendNVMRead(port, EFUSE_TYPE_DUK_LOCK, eFuseBuffer, &eFuseLen);
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
 
-    unsigned int  eFuseLen = 0;
-    unsigned char eFuseBuffer[128] = {0,};
+#ifdef __MP_DEBUG_BUILD__
+    DBG_LOG("[DUK Lock]");
+    DBG_LOG("-PARAMS-+-VALUES-");
+    fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
+    fprintf(stdout, "   data | ");
+    for ( int i = 0; i < eFuseLen; i++ )
+    {
+        fprintf(stdout, "%02X", eFuseBuffer[i]);
+    }
+    fprintf(stdout, "\n");
+    DBG_LOG("--------+--------\n");
+#endif
 
-    /* Upload the uploader firmware to SRAM */
-    ret = sendUploaderFile();
-    if ( ret < 0 )
+    /* check a value */
+    if ( eFuseBuffer[0] != set->eFuseDUKLock )
     {
+        DBG_LOG("eFuseBuffer:  %02X", eFuseBuffer[0]);
+        DBG_LOG("eFuseDUKLock: %02X", set->eFuseDUKLock);
         DBG_ERR("error!!!");
         return -1;
     }
+    markPhase(report, PHASE_DUK_LOCK, mark);
 
-    /* eFuse the UKey */
-    ret = sendNVMWrite(EFUSE_TYPE_UKEY);
+    /* eFuse the Secure boot enable */
+    ret = sendNVMWrite(port, EFUSE_SB_EN);
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* read the UKey */
+    /* read the Secure boot enable */
     eFuseLen = 0;
     memset(eFuseBuffer, 0x00, sizeof(eFuseBuffer));
-    ret = sendNVMRead(EFUSE_TYPE_UKEY, eFuseBuffer, &eFuseLen);
+    ret = sendNVMRead(port, EFUSE_SB_EN, eFuseBuffer, &eFuseLen);
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* check a value */
-    ret = 0;
 #ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[UKey]");
-    DBG_LOG("-PARAMS-+-VALUES-----------------------------------------------------------");
+    DBG_LOG("[Secure Boot Enable]");
+    DBG_LOG("-PARAMS-+-VALUES-");
     fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
     fprintf(stdout, "   data | ");
-#endif
     for ( int i = 0; i < eFuseLen; i++ )
     {
-#ifdef __MP_DEBUG_BUILD__
         fprintf(stdout, "%02X", eFuseBuffer[i]);
-#endif
-        if ( eFuseBuffer[i] != eFuseUKey[i] )
-        {
-            ret = -1;
-        }
     }
-#ifdef __MP_DEBUG_BUILD__
     fprintf(stdout, "\n");
-    DBG_LOG("--------+------------------------------------------------------------------\n");
+    DBG_LOG("--------+--------\n");
 #endif
+
+    /* check a value */
+    if ( eFuseBuffer[0] != set->eFuseSecureBootEnable )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+    markPhase(report, PHASE_SB_EN, mark);
+
+    /* eFuse the Boot source */
+    ret = sendNVMWrite(port, EFUSE_BOOT_SRC);
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
-	
-	if(eFusePKfWrite == 1)
-	{
-		/* eFuse the PKf */
-		ret = sendNVMWrite(EFUSE_TYPE_PKF);
-		DBG_LOG("[PKf WRITE]");
-		if ( ret < 0 )
-		{
-			DBG_ERR("error!!!");
-			return -1;
-		}
-	}
-	
-    /* read the PKf */
+
+    /* read the Boot source */
     eFuseLen = 0;
     memset(eFuseBuffer, 0x00, sizeof(eFuseBuffer));
-    ret = sendNVMRead(EFUSE_TYPE_PKF, eFuseBuffer, &eFuseLen);
+    ret = sendNVMRead(port, EFUSE_BOOT_SRC, eFuseBuffer, &eFuseLen);
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* check a value */
-    ret = 0;
 #ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[PKf]");
-
-	if(eFusePKfWrite == 0)
-	DBG_LOG("[PKf Write Skip]");
-	
-    DBG_LOG("-PARAMS-+-VALUES-----------------------------------------------------------");
+    DBG_LOG("[Boot Source]");
+    DBG_LOG("-PARAMS-+-VALUES-");
     fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
-    fprintf(stdout, "    data | ");
-#endif
+    fprintf(stdout, "   data | ");
     for ( int i = 0; i < eFuseLen; i++ )
     {
-#ifdef __MP_DEBUG_BUILD__
         fprintf(stdout, "%02X", eFuseBuffer[i]);
-#endif
-		/*PKF Write Skip*/
-		if(eFusePKfWrite == 1)
-		{
-			if ( eFuseBuffer[i] != eFusePKf[i] )
-			{
-				ret = -1;
-			}
-		}
     }
-#ifdef __MP_DEBUG_BUILD__
     fprintf(stdout, "\n");
-    DBG_LOG("--------+------------------------------------------------------------------\n");
+    DBG_LOG("--------+--------\n");
 #endif
-    if ( ret < 0 )
+
+    /* check a value */
+    if ( eFuseBuffer[0] != set->eFuseBootSource )
     {
         DBG_ERR("error!!!");
         return -1;
     }
+    markPhase(report, PHASE_BOOT_SRC, mark);
 
-    /* Upload the sdbInfo data to sdb */
-    ret = sendSdbInfo();
+    return 0;
+}
+
+/* one device: wall clock and uart bytes around downloadDevice() for the result log */
+int ProcessController::downloadProcess(eSOCKETCHANNEL ch, SerialComm* port)
+{
+    int ret = -1;
+
+    deviceReport_t* report = &this->report[ch];
+    unsigned long   txBytes = port->GetTxBytes();
+    unsigned long   rxBytes = port->GetRxBytes();
+
+    report->generation = generation;
+    clock_gettime(CLOCK_REALTIME, &report->start);
+    ret = downloadDevice(ch, port);
+    clock_gettime(CLOCK_REALTIME, &report->end);
+
+    report->txBytes = port->GetTxBytes() - txBytes;
+    report->rxBytes = port->GetRxBytes() - rxBytes;
+
+    return ret;
+}
+
+int ProcessController::downloadDevice(eSOCKETCHANNEL ch, SerialComm* port)
+{
+    int ret = -1;
+
+    unsigned int  eFuseLen = 0;
+    unsigned char eFuseBuffer[128] = {0,};
+    unsigned int  sdbSkip = 0;
+
+    deviceReport_t* report = &this->report[ch];
+    struct timespec begin;
+    struct timespec mark;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    mark = begin;
+
+    /* the ROM bootloader always talks at the base rate */
+    ret = port->SetBaudrate(baudrate);
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
-    
-    /* Upload the app firmware to flash */
-    ret = sendAppImageFirmware();
+
+    /* Upload the uploader firmware to SRAM */
+    ret = sendUploaderFile(port);
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
+    markPhase(report, PHASE_UPLOADER, &mark);
 
-    /* eFuse the UKey Lock */
-    ret = sendNVMWrite(EFUSE_TYPE_UKEY_LOCK);
+    /* switch the uploader to a faster rate for the transfers */
+    ret = sendUploaderBaudrate(port);
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
+    markPhase(report, PHASE_BAUDRATE, &mark);
 
-    /* read the UKey Lock */
-    eFuseLen = 0;
-    memset(eFuseBuffer, 0x00, sizeof(eFuseBuffer));
-    ret = sendNVMRead(EFUSE_TYPE_UKEY_LOCK, eFuseBuffer, &eFuseLen);
-    if ( ret < 0 )
+    /* rework units: what the device already holds is left alone */
+    if ( set->reworkScan == 1 )
     {
-        DBG_ERR("error!!!");
-        return -1;
+        ret = scanDevice(port, report, &sdbSkip);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+        markPhase(report, PHASE_PRESCAN, &mark);
+    }
+    else
+    {
+        report->phaseUs[PHASE_PRESCAN] = LATENCY_PHASE_SKIPPED;
+    }
+
+    /* eFuse the UKey */
+    if ( (report->skipped & PHASE_BIT(PHASE_UKEY)) != 0 )
+    {
+        skipPhase(report, PHASE_UKEY, &mark);
+    }
+    else
+    {
+        ret = sendUKey(port);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+        markPhase(report, PHASE_UKEY, &mark);
+    }
+
+    /* eFuse the PKf */
+    if ( (report->skipped & PHASE_BIT(PHASE_PKF)) != 0 )
+    {
+        skipPhase(report, PHASE_PKF, &mark);
+    }
+    else
+    {
+        ret = sendPKf(port);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+        markPhase(report, PHASE_PKF, &mark);
+    }
+
+    /* Upload the sdbInfo data to sdb */
+    if ( (report->skipped & PHASE_BIT(PHASE_SDB)) != 0 )
+    {
+        skipPhase(report, PHASE_SDB, &mark);
+    }
+    else
+    {
+        ret = sendSdbInfo(port, sdbSkip);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+        markPhase(report, PHASE_SDB, &mark);
+    }
+
+    /* Upload the app firmware to flash */
+    if ( (report->skipped & PHASE_BIT(PHASE_APP)) != 0 )
+    {
+        skipPhase(report, PHASE_APP, &mark);
     }
+    else
+    {
+        ret = sendAppImageFirmware(port);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+        markPhase(report, PHASE_APP, &mark);
+    }
+
+    /* eFuse the locks, secure boot enable and boot source, read back in one pass */
+    if ( (report->skipped & PHASE_BIT(PHASE_EFUSE_BATCH)) != 0 )
+    {
+        for ( int i = PHASE_UKEY_LOCK; i <= PHASE_EFUSE_BATCH; i++ )
+        {
+            skipPhase(report, (ePHASE)i, &mark);
+        }
+    }
+    else
+    {
+        /* the batch stands for UKEY_LOCK ~ BOOT_SRC, a device that fails in it failed in efuse_batch */
+        for ( int i = PHASE_UKEY_LOCK; i <= PHASE_BOOT_SRC; i++ )
+        {
+            report->phaseUs[i] = LATENCY_PHASE_SKIPPED;
+        }
+
+        unsigned char eFuseImage[EFUSE_IMAGE_SIZE] = {0,};
+        ret = sendNVMBatch(port, eFuseBatchTypes, EFUSE_BATCH_TYPE_COUNT, eFuseImage);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
 
+        if ( ret == 0 )
+        {
 #ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[UKey Lock]");
-    DBG_LOG("-PARAMS-+-VALUES-");
-    DBG_LOG("   data | ");
+            DBG_LOG("[eFuse Image]");
+            DBG_LOG("-PARAMS-----+-VALUES-");
+#endif
+            for ( int i = 0; i < EFUSE_BATCH_TYPE_COUNT; i++ )
+            {
+                eEFUSETYPE type = eFuseBatchTypes[i];
+
+                memset(eFuseBuffer, 0x00, sizeof(eFuseBuffer));
+                eFuseLen = getNVMValue(type, eFuseBuffer);
+
+#ifdef __MP_DEBUG_BUILD__
+                DBG_LOG(" %10s | %02X", eFuseKeyParams[type], eFuseImage[eFuseImageOffset(type)]);
 #endif
+                /* check a value */
+                if ( memcmp(eFuseImage + eFuseImageOffset(type), eFuseBuffer, eFuseLen) != 0 )
+                {
+                    DBG_ERR("%s: %02X, expected %02X", eFuseKeyParams[type], eFuseImage[eFuseImageOffset(type)], eFuseBuffer[0]);
+                    return -1;
+                }
+            }
 #ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("%02X", eFuseBuffer[0]);
-    DBG_LOG("--------+--------\n");
+            DBG_LOG("------------+--------\n");
 #endif
+            markPhase(report, PHASE_EFUSE_BATCH, &mark);
+        }
+        else
+        {
+            /* uploader without the batch packet, the fields go one by one */
+            for ( int i = PHASE_UKEY_LOCK; i <= PHASE_BOOT_SRC; i++ )
+            {
+                report->phaseUs[i] = -1;
+            }
+            ret = sendNVMLocks(port, report, &mark);
+            if ( ret < 0 )
+            {
+                DBG_ERR("error!!!");
+                return -1;
+            }
+            report->phaseUs[PHASE_EFUSE_BATCH] = LATENCY_PHASE_SKIPPED;
+        }
+    }
 
-    /* check a value */
-    if ( eFuseBuffer[0] != eFuseUKeyLock )
+    report->phaseUs[PHASE_DEVICE_TOTAL] = diffUs(&begin, &mark);
+
+    return 0;
+}
+
+int ProcessController::downloadSerial(void)
+{
+    int ret = -1;
+
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
     {
-        DBG_ERR("error!!!");
-        return -1;
+        /* the session stays open across cycles, this only reopens after an I/O error */
+        DBG_LOG("UART Open");
+        ret = comm->Open();
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+
+        DBG_LOG("Select Socket#%d", i);
+        ret = gpio->SelectSocket((eSOCKETCHANNEL)i);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+
+        DBG_LOG("EnableUARTSW...");
+        ret = gpio->EnableUARTSW();
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+
+        DBG_LOG("Reset Socket#%d", i);
+        ret = gpio->ResetSocket();
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+
+        DBG_LOG("UART Flush");
+        comm->Flush();
+
+        DBG_LOG("Start Download Process");
+        ret = downloadProcess((eSOCKETCHANNEL)i, comm);
+        report[i].result = (ret < 0) ? -1 : 0;
+        stats->RecordReport(i, &report[i]);
+        resultLog->Write(cycle, i, &report[i]);
+        settle(set->timing.resultHoldMs);
+        if ( ret < 0 )
+        {
+            DBG_LOG("LED: R");
+            ret = gpio->SetResultLED(LED_R);
+            if ( ret < 0 )
+            {
+                DBG_ERR("error!!!");
+                return -1;
+            }
+            DBG_ERR("error!!!");
+        }
+        else
+        {
+            DBG_LOG("LED: G");
+            ret = gpio->SetResultLED(LED_G);
+            if ( ret < 0 )
+            {
+                DBG_ERR("error!!!");
+                return -1;
+            }
+        }
+
+        DBG_LOG("DisableUARTSW...");
+        ret = gpio->DisableUARTSW();
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
     }
 
-    /* eFuse the PKf Lock */
-    ret = sendNVMWrite(EFUSE_TYPE_PKF_LOCK);
+    return 0;
+}
+
+void DownloadWorker::customThread(void* param)
+{
+    downloadJob_t* job = (downloadJob_t*)param;
+
+    job->result = job->controller->downloadProcess(job->ch, job->port);
+}
+
+int ProcessController::downloadParallel(void)
+{
+    int ret = -1;
+
+    DownloadWorker worker[SOCKET_MAX];
+    downloadJob_t  job[SOCKET_MAX];
+    int            started[SOCKET_MAX] = {0,};
+
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
+    {
+        job[i].controller = this;
+        job[i].ch         = (eSOCKETCHANNEL)i;
+        job[i].port       = socketComm[i];
+        job[i].result     = -1;
+
+        ret = gpio->ClearResultLED((eSOCKETCHANNEL)i);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+    }
+
+    DBG_LOG("EnableUARTSW...");
+    ret = gpio->EnableUARTSW();
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* read the PKf Lock */
-    eFuseLen = 0;
-    memset(eFuseBuffer, 0x00, sizeof(eFuseBuffer));
-    ret = sendNVMRead(EFUSE_TYPE_PKF_LOCK, eFuseBuffer, &eFuseLen);
-    if ( ret < 0 )
+    /* GPIO stays on this thread, the workers only talk to their own UART */
+    struct timespec cycleStart;
+    clock_gettime(CLOCK_REALTIME, &cycleStart);
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
+    {
+        DBG_LOG("UART#%d Open", i);
+        ret = socketComm[i]->Open();
+        if ( ret < 0 )
+        {
+            DBG_ERR("socket#%d, %s open error", i, set->socketDeviceName[i]);
+            continue;
+        }
+
+        DBG_LOG("Reset Socket#%d", i);
+        ret = gpio->ResetSocket((eSOCKETCHANNEL)i);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            break;
+        }
+
+        socketComm[i]->Flush();
+
+        DBG_LOG("Start Download Process#%d", i);
+        ret = worker[i].ThreadStart(&job[i], true);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            continue;
+        }
+        started[i] = 1;
+    }
+
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
+    {
+        if ( started[i] == 1 )
+        {
+            worker[i].ThreadJoin();
+        }
+    }
+    /* a socket that never started failed before the uploader, it is logged like any other device */
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
     {
-        DBG_ERR("error!!!");
-        return -1;
+        if ( started[i] == 0 )
+        {
+            report[i].generation = generation;
+            report[i].start      = cycleStart;
+            report[i].end        = cycleStart;
+        }
+        report[i].result = (job[i].result < 0) ? -1 : 0;
+        stats->RecordReport(i, &report[i]);
+        resultLog->Write(cycle, i, &report[i]);
     }
+    settle(set->timing.resultHoldMs);
 
-#ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[PKf Lock]");
-    DBG_LOG("-PARAMS-+-VALUES-");
-    fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
-    fprintf(stdout, "    data | ");
-    for ( int i = 0; i < eFuseLen; i++ )
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
     {
-        fprintf(stdout, "%02X", eFuseBuffer[i]);
+        DBG_LOG("Socket#%d LED: %s", i, (job[i].result < 0) ? "R" : "G");
+        ret = gpio->SetResultLED((eSOCKETCHANNEL)i, (job[i].result < 0) ? LED_R : LED_G);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
     }
-    fprintf(stdout, "\n");
-    DBG_LOG("--------+--------\n");
-#endif
 
-    /* check a value */
-    if ( eFuseBuffer[0] != eFusePKfLock )
+    DBG_LOG("DisableUARTSW...");
+    ret = gpio->DisableUARTSW();
+    if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* eFuse the DUK Lock */
-    ret = sendNVMWrite(EFUSE_TYPE_DUK_LOCK);
+    return 0;
+}
+
+/* CYCLE_TRIGGER_COMMAND: the caller already knows the sockets are loaded, no power/start switch waits */
+int ProcessController::ProcessStart(eCYCLETRIGGER trigger)
+{
+    int ret = -1;
+
+#ifdef __TEST10000__
+    trigger = CYCLE_TRIGGER_COMMAND;
+#endif /* __TEST10000__ */
+
+    delayUs = 0;
+    gpio->TakeDelayUs();
+
+    DBG_LOG("GPIO Init...");
+    ret = gpio->gpioInit();
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-    /* read the DUK Lock */
-    eFuseLen = 0;
-    memset(eFuseBuffer, 0x00, sizeof(eFuseBuffer));
-    ret = sendNVMRead(EFUSE_TYPE_DUK_LOCK, eFuseBuffer, &eFuseLen);
+    DBG_LOG("Reset All Socket");
+    ret = gpio->ResetAllSocket();
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-#ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[DUK Lock]");
-    DBG_LOG("-PARAMS-+-VALUES-");
-    fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
-    fprintf(stdout, "   data | ");
-    for ( int i = 0; i < eFuseLen; i++ )
+    if ( trigger == CYCLE_TRIGGER_FIXTURE )
     {
-        fprintf(stdout, "%02X", eFuseBuffer[i]);
-    }
-    fprintf(stdout, "\n");
-    DBG_LOG("--------+--------\n");
-#endif
+        DBG_LOG("Wait Socket Power On...");
+        ret = gpio->WaitDownloadReadySet(set->gpioTimeoutMs, &readyEdge);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+        else
+        if ( ret > 0 )
+        {
+            DBG_LOG("no socket power, restart");
+            return 0;
+        }
 
-    /* check a value */
-    if ( eFuseBuffer[0] != eFuseDUKLock )
+        DBG_LOG("Wait DL Start SW...");
+        ret = gpio->WaitDownloadStart(set->gpioTimeoutMs, &startEdge);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+        else
+        if ( ret > 0 )
+        {
+            DBG_LOG("no start switch, restart");
+            return 0;
+        }
+    }
+    else
     {
-        DBG_LOG("eFuseBuffer:  %02X", eFuseBuffer[0]);
-        DBG_LOG("eFuseDUKLock: %02X", eFuseDUKLock);
-        DBG_ERR("error!!!");
-        return -1;
+        clock_gettime(CLOCK_MONOTONIC, &readyEdge);
+        startEdge = readyEdge;
     }
 
-    /* eFuse the Secure boot enable */
-    ret = sendNVMWrite(EFUSE_SB_EN);
-    if ( ret < 0 )
+    /* the images of a cycle are fixed from here on, a set that did not load never got this far */
+    applyReload();
+
+    cycle++;
+    resetReport();
+
+    if ( parallelDownload == 1 )
     {
-        DBG_ERR("error!!!");
-        return -1;
+        ret = downloadParallel();
+    }
+    else
+    {
+        ret = downloadSerial();
     }
-
-    /* read the Secure boot enable */
-    eFuseLen = 0;
-    memset(eFuseBuffer, 0x00, sizeof(eFuseBuffer));
-    ret = sendNVMRead(EFUSE_SB_EN, eFuseBuffer, &eFuseLen);
     if ( ret < 0 )
     {
         DBG_ERR("error!!!");
         return -1;
     }
+    clock_gettime(CLOCK_MONOTONIC, &doneTime);
 
-#ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[Secure Boot Enable]");
-    DBG_LOG("-PARAMS-+-VALUES-");
-    fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
-    fprintf(stdout, "   data | ");
-    for ( int i = 0; i < eFuseLen; i++ )
+    if ( trigger == CYCLE_TRIGGER_FIXTURE )
     {
-        fprintf(stdout, "%02X", eFuseBuffer[i]);
+        DBG_LOG("Wait Socket Power Off...");
+        ret = gpio->WaitDownloadReadyReset(set->gpioTimeoutMs, &removeEdge);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error!!!");
+            return -1;
+        }
+        else
+        if ( ret > 0 )
+        {
+            DBG_LOG("socket power still on, restart");
+            clock_gettime(CLOCK_MONOTONIC, &removeEdge);
+        }
     }
-    fprintf(stdout, "\n");
-    DBG_LOG("--------+--------\n");
-#endif
-
-    /* check a value */
-    if ( eFuseBuffer[0] != eFuseSecureBootEnable )
+    else
     {
-        DBG_ERR("error!!!");
-        return -1;
+        removeEdge = doneTime;
     }
 
-    /* eFuse the Boot source */
-    ret = sendNVMWrite(EFUSE_BOOT_SRC);
-    if ( ret < 0 )
+    /* reset all + per socket select/reset/result hold */
+    delayUs += gpio->TakeDelayUs();
+
+    DBG_LOG("cycle: operator %ld ms(start %ld, remove %ld), machine %ld ms, deliberate delay %ld ms",
+            diffMs(&readyEdge, &startEdge) + diffMs(&doneTime, &removeEdge),
+            diffMs(&readyEdge, &startEdge), diffMs(&doneTime, &removeEdge),
+            diffMs(&startEdge, &doneTime), delayUs / 1000);
+
+    stats->Record(LATENCY_FIXTURE, PHASE_OPERATOR_START,  diffUs(&readyEdge, &startEdge));
+    stats->Record(LATENCY_FIXTURE, PHASE_MACHINE,         diffUs(&startEdge, &doneTime));
+    stats->Record(LATENCY_FIXTURE, PHASE_OPERATOR_REMOVE, diffUs(&doneTime, &removeEdge));
+    stats->Record(LATENCY_FIXTURE, PHASE_DELAY,           delayUs);
+    resultLog->Flush();
+
+#ifdef __MP_DEBUG_BUILD__
+    gpio->DumpTimeline(stdout);
+#endif
+
+    return 0;
+}
+
+void ProcessController::settle(int ms)
+{
+    struct timespec from;
+    struct timespec to;
+
+    if ( ms <= 0 )
     {
-        DBG_ERR("error!!!");
-        return -1;
+        return;
     }
 
-    /* read the Boot source */
-    eFuseLen = 0;
-    memset(eFuseBuffer, 0x00, sizeof(eFuseBuffer));
-    ret = sendNVMRead(EFUSE_BOOT_SRC, eFuseBuffer, &eFuseLen);
-    if ( ret < 0 )
+    clock_gettime(CLOCK_MONOTONIC, &from);
+    usleep(ms * 1000);
+    clock_gettime(CLOCK_MONOTONIC, &to);
+
+    delayUs += diffUs(&from, &to);
+}
+
+void ProcessController::resetReport(void)
+{
+    for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
     {
-        DBG_ERR("error!!!");
-        return -1;
+        report[i].result  = 1;
+        report[i].skipped = 0;
+        report[i].txBytes = 0;
+        report[i].rxBytes = 0;
+        report[i].generation = 0;
+        memset(&report[i].start, 0x00, sizeof(report[i].start));
+        memset(&report[i].end,   0x00, sizeof(report[i].end));
+        for ( int j = PHASE_UPLOADER; j < PHASE_MAX; j++ )
+        {
+            report[i].phaseUs[j] = -1;
+        }
     }
+}
 
-#ifdef __MP_DEBUG_BUILD__
-    DBG_LOG("[Boot Source]");
-    DBG_LOG("-PARAMS-+-VALUES-");
-    fprintf(stdout, "[Log %s#%d] ", __FUNCTION__, __LINE__);
-    fprintf(stdout, "   data | ");
-    for ( int i = 0; i < eFuseLen; i++ )
+int ProcessController::DumpStats(void)
+{
+    if ( resultLog != NULL )
     {
-        fprintf(stdout, "%02X", eFuseBuffer[i]);
+        resultLog->Flush();
     }
-    fprintf(stdout, "\n");
-    DBG_LOG("--------+--------\n");
-#endif
 
-    /* check a value */
-    if ( eFuseBuffer[0] != eFuseBootSource )
+    if ( stats == NULL || statsFileName == NULL )
     {
-        DBG_ERR("error!!!");
-        return -1;
+        return 0;
     }
+
+    return stats->Dump(statsFileName);
 }
 
-int ProcessController::ProcessStart(void)
+/* the recipe in use stays until the new one loaded into a set of its own, a refused one changes nothing */
+int ProcessController::SwitchRecipe(const char* conf, const char* uploader, const char* image, const char* sdbInfo)
 {
-    int ret = -1;
+    ImageSet* next = NULL;
 
-    DBG_LOG("GPIO Init...");
-    ret = gpio->gpioInit();
-    if ( ret < 0 )
-    {
-        DBG_ERR("error!!!");
-        return -1;
-    }
+    const char* in[]  = { conf, uploader, image, sdbInfo };
+    const int   count = sizeof(in) / sizeof(in[0]);
 
-    DBG_LOG("Reset All Socket");
-    ret = gpio->ResetAllSocket();
-    if ( ret < 0 )
+    for ( int i = 0; i < count; i++ )
     {
-        DBG_ERR("error!!!");
-        return -1;
+        if ( in[i] != NULL && in[i][0] == '\0' )
+        {
+            DBG_ERR("error!!!");
+            return 1;
+        }
     }
 
-#ifndef __TEST10000__
-    DBG_LOG("Wait Socket Power On...");
-    ret = gpio->WaitDownloadReadySet();
-    if ( ret < 0 )
+    pthread_mutex_lock(&loadMutex);
+
+    next = loadSet((conf != NULL) ? conf : configFileName, (uploader != NULL) ? uploader : uploaderFileName,
+                   (image != NULL) ? image : appImageFileName, (sdbInfo != NULL) ? sdbInfo : sdbInfoFileName);
+    if ( next == NULL )
     {
-        DBG_ERR("error!!!");
-        return -1;
+        pthread_mutex_unlock(&loadMutex);
+        DBG_ERR("recipe refused, generation %u stays", generation);
+        return (set != NULL) ? 1 : -1;
     }
 
-    DBG_LOG("Wait DL Start SW...");
-    ret = gpio->WaitDownloadStart();
-    if ( ret < 0 )
+    /* the staged set, if any, was built from the old names */
+    pthread_mutex_lock(&reloadMutex);
+    if ( staged != NULL )
     {
-        DBG_ERR("error!!!");
-        return -1;
+        delete staged;
+        staged = NULL;
     }
-#endif /* __TEST10000__ */
+    pthread_mutex_unlock(&reloadMutex);
 
-    DBG_LOG("UART Open");
-    ret = comm->Open();
-    if ( ret < 0 )
+    SetName(FILE_NAME_CONF,     next->configFileName);
+    SetName(FILE_NAME_UPLOADER, next->uploaderFileName);
+    SetName(FILE_NAME_APPIMAGE, next->appImageFileName);
+    SetName(FILE_NAME_SDBINFO,  next->sdbInfoFileName);
+
+    pthread_mutex_unlock(&loadMutex);
+
+    DBG_LOG("recipe %s %s %s %s", next->configFileName, next->uploaderFileName, next->appImageFileName, next->sdbInfoFileName);
+    swapSet(next);
+
+    return 0;
+}
+
+/*
+ * one line per socket: wait, run <phase> <ms>, ok <ms> or fail <phase> <ms>, then the uart bytes.
+ * read while the workers write report[], unlocked, it may lag one phase. the set is locked,
+ * the cycle may swap it meanwhile.
+ */
+int ProcessController::WriteStatus(FILE* out)
+{
+    struct timespec now;
+
+    if ( out == NULL )
     {
         DBG_ERR("error!!!");
         return -1;
     }
 
-#ifdef __TEST10000__
-    int downloadResult = SOCKET_MAX;
-#endif /* __TEST10000__ */
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    fprintf(out, "cycle %lu\n", cycle);
+    pthread_mutex_lock(&reloadMutex);
+    fprintf(out, "recipe conf=%s uploader=%s image=%s sdbinfo=%s generation %u%s\n",
+            set->configFileName, set->uploaderFileName, set->appImageFileName, set->sdbInfoFileName,
+            generation, (staged != NULL) ? " reload pending" : "");
+    pthread_mutex_unlock(&reloadMutex);
 
     for ( int i = SOCKET_CH1; i < SOCKET_MAX; i++ )
     {
-        DBG_LOG("Select Socket#%d", i);
-        ret = gpio->SelectSocket((eSOCKETCHANNEL)i);
-        if ( ret < 0 )
-        {
-            DBG_ERR("error!!!");
-            return -1;
-        }
-
-        DBG_LOG("EnableUARTSW...");
-        ret = gpio->EnableUARTSW();
-        if ( ret < 0 )
-        {
-            DBG_ERR("error!!!");
-            return -1;
-        }
+        const deviceReport_t* r = &report[i];
 
-        DBG_LOG("Reset Socket#%d", i);
-        ret = gpio->ResetSocket();
-        if ( ret < 0 )
+        if ( r->start.tv_sec == 0 )
         {
-            DBG_ERR("error!!!");
-            return -1;
+            fprintf(out, "socket %d wait\n", i + 1);
+            continue;
         }
 
-        DBG_LOG("UART Flush");
-        comm->Flush();
-
-        DBG_LOG("Start Download Process");
-        ret = downloadProcess((eSOCKETCHANNEL)i);
-        sleep( 3 );
-        if ( ret < 0 )
+        if ( r->result > 0 )
         {
-            DBG_LOG("LED: R");
-            ret = gpio->SetResultLED(LED_R);
-            if ( ret < 0 )
+            int phase = PHASE_UPLOADER;
+            while ( (phase < PHASE_DEVICE_TOTAL) && (r->phaseUs[phase] != -1) )
             {
-                DBG_ERR("error!!!");
-                return -1;
+                phase++;
             }
-            DBG_ERR("error!!!");
+            fprintf(out, "socket %d run %s %ld\n", i + 1, LatencyStats::GetPhaseName((ePHASE)phase), diffMs(&r->start, &now));
+            continue;
         }
-        else
+
+        if ( r->result == 0 )
         {
-            DBG_LOG("LED: G");
-            ret = gpio->SetResultLED(LED_G);
-            if ( ret < 0 )
-            {
-                DBG_ERR("error!!!");
-                return -1;
-            }
+            fprintf(out, "socket %d ok %ld", i + 1, diffMs(&r->start, &r->end));
         }
-
-        DBG_LOG("DisableUARTSW...");
-        ret = gpio->DisableUARTSW();
-        if ( ret < 0 )
+        else
         {
-            DBG_ERR("error!!!");
-            return -1;
+            fprintf(out, "socket %d fail %s %ld", i + 1, LatencyStats::GetPhaseName(LatencyStats::GetFailedPhase(r)), diffMs(&r->start, &r->end));
         }
+        fprintf(out, " tx %lu rx %lu\n", r->txBytes, r->rxBytes);
     }
 
-    DBG_LOG("UART close");
-    ret = comm->Close();
-    if ( ret < 0 )
-    {
-        DBG_ERR("error!!!");
-        return -1;
-    }
+    return 0;
+}
 
-#ifndef __TEST10000__
-    DBG_LOG("Wait Socket Power Off...");
-    ret = gpio->WaitDownloadReadyReset();
-    if ( ret < 0 )
+int ProcessController::WriteMetrics(FILE* out)
+{
+    if ( stats == NULL )
     {
         DBG_ERR("error!!!");
         return -1;
     }
-#endif /* __TEST10000__ */
 
-    return 0;
-}
\ No newline at end of file
+    return stats->DumpJson(out);
+}
+
@@ -0,0 +1,160 @@
+#include <cstdio>
+#include <cstring>
+
+#include <time.h>
+
+#include "ResultLog.h"
+
+#include "debug.h"
+
+ResultLog::ResultLog(void)
+{
+    file = NULL;
+    pthread_mutex_init(&mutex, NULL);
+}
+
+ResultLog::~ResultLog(void)
+{
+    Close();
+    pthread_mutex_destroy(&mutex);
+}
+
+int ResultLog::Open(const char* path)
+{
+    if ( path == NULL || path[0] == '\0' )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    Close();
+
+    pthread_mutex_lock(&mutex);
+
+    file = fopen(path, "a");
+    if ( file == NULL )
+    {
+        pthread_mutex_unlock(&mutex);
+        DBG_ERR("%s open error", path);
+        return -1;
+    }
+    setvbuf(file, NULL, _IOFBF, RESULT_LOG_BUFFER_SIZE);
+
+    /* append mode starts at the end, position 0 is a new file */
+    fseek(file, 0, SEEK_END);
+    if ( ftell(file) == 0 )
+    {
+        fprintf(file, "cycle,socket,start,end,result,failed_phase,tx_bytes,rx_bytes,skipped");
+        for ( int i = PHASE_UPLOADER; i <= PHASE_DEVICE_TOTAL; i++ )
+        {
+            fprintf(file, ",%s_us", LatencyStats::GetPhaseName((ePHASE)i));
+        }
+        fprintf(file, ",image_generation\n");
+        fflush(file);
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    return 0;
+}
+
+int ResultLog::Close(void)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&mutex);
+    if ( file != NULL )
+    {
+        ret = (fclose(file) == 0) ? 0 : -1;
+        file = NULL;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    return ret;
+}
+
+/* local time, ms resolution */
+void ResultLog::writeTime(const struct timespec* ts)
+{
+    struct tm local;
+    time_t    sec = ts->tv_sec;
+
+    localtime_r(&sec, &local);
+    fprintf(file, ",%04d-%02d-%02dT%02d:%02d:%02d.%03ld",
+            local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+            local.tm_hour, local.tm_min, local.tm_sec, ts->tv_nsec / 1000000L);
+}
+
+/* phases not reached or not on the path are left empty, the skipped column names the pre-scan skips */
+int ResultLog::Write(unsigned long cycle, int socket, const deviceReport_t* report)
+{
+    if ( report == NULL )
+    {
+        DBG_ERR("error!!!");
+        return -1;
+    }
+
+    pthread_mutex_lock(&mutex);
+
+    if ( file == NULL )
+    {
+        pthread_mutex_unlock(&mutex);
+        return 0;
+    }
+
+    ePHASE failed = LatencyStats::GetFailedPhase(report);
+
+    fprintf(file, "%lu,%d", cycle, socket + 1);
+    writeTime(&report->start);
+    writeTime(&report->end);
+    fprintf(file, ",%s,%s,%lu,%lu,",
+            (report->result < 0) ? "fail" : "ok",
+            (failed < PHASE_MAX) ? LatencyStats::GetPhaseName(failed) : "",
+            report->txBytes, report->rxBytes);
+
+    int first = 1;
+    for ( int i = PHASE_UPLOADER; i < PHASE_DEVICE_TOTAL; i++ )
+    {
+        if ( (report->skipped & PHASE_BIT(i)) != 0 )
+        {
+            fprintf(file, "%s%s", (first != 0) ? "" : "|", LatencyStats::GetPhaseName((ePHASE)i));
+            first = 0;
+        }
+    }
+
+    for ( int i = PHASE_UPLOADER; i <= PHASE_DEVICE_TOTAL; i++ )
+    {
+        if ( report->phaseUs[i] >= 0 )
+        {
+            fprintf(file, ",%ld", report->phaseUs[i]);
+        }
+        else
+        {
+            fprintf(file, ",");
+        }
+    }
+    fprintf(file, ",%u\n", report->generation);
+
+    pthread_mutex_unlock(&mutex);
+
+    return 0;
+}
+
+int ResultLog::Flush(void)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&mutex);
+    if ( file != NULL )
+    {
+        ret = (fflush(file) == 0) ? 0 : -1;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    if ( ret < 0 )
+    {
+        DBG_ERR("error!!!");
+    }
+
+    return ret;
+}
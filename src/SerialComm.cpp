@@ -7,6 +7,9 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <termios.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
 
 #include <sys/ioctl.h>
 #include <sys/types.h>
@@ -15,7 +18,7 @@
 #include "debug.h"
 #include "SerialComm.h"
 
-SerialComm::SerialComm(const char* inDevice, const int inBaudrate): fd(-1), baudrate(inBaudrate)
+SerialComm::SerialComm(const char* inDevice, const int inBaudrate): fd(-1), baudrate(inBaudrate), stale(0), writeCalls(0), readCalls(0), txBytes(0), rxBytes(0)
 {
     device = new char[strlen(inDevice)+1]{0,};
     strcpy(device, inDevice);
@@ -23,8 +26,45 @@ SerialComm::SerialComm(const char* inDevice, const int inBaudrate): fd(-1), baud
 
 SerialComm::~SerialComm(void)
 {
-    Flush();
-    Close();
+    if ( fd >= 0 )
+    {
+        Flush();
+        Close();
+    }
+}
+
+/* absolute CLOCK_MONOTONIC deadline, timeoutMs < 0: no deadline */
+static inline void setDeadline(struct timespec* deadline, int timeoutMs)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    if ( timeoutMs < 0 )
+    {
+        return;
+    }
+    deadline->tv_sec  += (timeoutMs / 1000);
+    deadline->tv_nsec += (timeoutMs % 1000) * 1000000L;
+    if ( deadline->tv_nsec >= 1000000000L )
+    {
+        deadline->tv_sec  += 1;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+/* remaining time(ms) to the deadline, 0 when it is passed */
+static inline int remainingMs(const struct timespec* deadline)
+{
+    struct timespec now;
+    long long diff = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    diff = (long long)(deadline->tv_sec - now.tv_sec) * 1000
+         + (deadline->tv_nsec - now.tv_nsec + 999999L) / 1000000L;
+    if ( diff <= 0 )
+    {
+        return 0;
+    }
+
+    return (int)diff;
 }
 
 static inline speed_t baudrate2speed(int baudrate)
@@ -99,26 +139,10 @@ static inline speed_t baudrate2speed(int baudrate)
     }
 }
 
-int SerialComm::Open(void)
+int SerialComm::configure(void)
 {
     int ret = 0;
 
-    fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY | O_NONBLOCK);
-    if ( fd < 0 )
-    {
-        DBG_ERR("error");
-        ret = -1;
-        return ret;
-    }
-
-    ret = fcntl(fd, F_SETFL, O_RDWR);
-    if ( ret < 0 )
-    {
-        DBG_ERR("error");
-        ret = -1;
-        return ret;
-    }
-
     struct termios tio;
     tcgetattr(fd, &tio);
 
@@ -156,7 +180,7 @@ int SerialComm::Open(void)
     tio.c_oflag &= ~OPOST ;
 
     tio.c_cc[VMIN]  = 0;
-    tio.c_cc[VTIME] = 100;  /* timeout: c_cc[VTIME] * 0.1 sec */
+    tio.c_cc[VTIME] = 0;    /* no termios timeout, see waitReady() */
 
     ret = tcsetattr(fd, TCSANOW, &tio);
     if ( ret < 0 )
@@ -166,40 +190,81 @@ int SerialComm::Open(void)
         return ret;
     }
 
-    int status = 0;
-    ret = ioctl(fd, TIOCMGET, &status);
-    if ( ret < 0 )
+    ret = 0;
+    return ret;
+}
+
+int SerialComm::Open(void)
+{
+    int ret = 0;
+
+    /* long-lived session: only reopen after an I/O error or a config change */
+    if ( fd >= 0 && stale == 0 )
     {
-        DBG_ERR("error");
-        ret = -1;
+        ret = 0;
         return ret;
     }
 
-    status |= TIOCM_DTR;
-    status |= TIOCM_RTS;
+    if ( fd >= 0 )
+    {
+        DBG_LOG("%s reopen", device);
+        Close();
+    }
 
-    usleep(10*1000);
+    /* keep O_NONBLOCK, Send/Receive wait with poll() against their own deadline */
+    fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY | O_NONBLOCK);
+    if ( fd < 0 )
+    {
+        DBG_ERR("error");
+        ret = -1;
+        return ret;
+    }
 
-    ret = ioctl(fd, TIOCMSET, &status);
+    ret = configure();
     if ( ret < 0 )
     {
         DBG_ERR("error");
+        Close();
         ret = -1;
         return ret;
     }
 
+    /* a pty(emulator) has no modem lines, ENOTTY/EINVAL there is not an error */
+    int status = 0;
+    ret = ioctl(fd, TIOCMGET, &status);
+    if ( ret < 0 && errno != ENOTTY && errno != EINVAL )
+    {
+        DBG_ERR("error");
+        Close();
+        ret = -1;
+        return ret;
+    }
 
-    usleep(10*1000);
+    if ( ret == 0 )
+    {
+        status |= TIOCM_DTR;
+        status |= TIOCM_RTS;
+
+        ret = ioctl(fd, TIOCMSET, &status);
+        if ( ret < 0 )
+        {
+            DBG_ERR("error");
+            Close();
+            ret = -1;
+            return ret;
+        }
+    }
 
     ret = tcflush(fd, TCIOFLUSH);
     if ( ret < 0 )
     {
         DBG_ERR("error");
+        Close();
         ret = -1;
         return ret;
     }
 
-    usleep(10*1000);
+    stale = 0;
 
     ret = 0;
     return ret;
@@ -210,6 +275,7 @@ int SerialComm::Close(void)
     int ret = 0;
 
     ret = close(fd);
+    fd = -1;
     if ( ret < 0 )
     {
         DBG_ERR("error");
@@ -217,8 +283,6 @@ int SerialComm::Close(void)
         return ret;
     }
 
-    usleep(10*1000);
-    
     ret = 0;
     return ret;
 }
@@ -231,50 +295,178 @@ int SerialComm::Flush(void)
     if ( ret != 0 )
     {
         DBG_ERR("error");
+        stale = 1;
         ret = -1;
         return ret;
     }
-    
-    usleep(10*1000);
 
     ret = 0;
     return ret;
 }
 
-int SerialComm::Send(const unsigned char* in, unsigned int inLen)
+/* 1: the termios speed table has the rate, SetBaudrate() would take it */
+int SerialComm::IsSupportedBaudrate(const int inBaudrate)
+{
+    return (baudrate2speed(inBaudrate) != 0) ? 1 : 0;
+}
+
+int SerialComm::SetBaudrate(const int inBaudrate)
+{
+    if ( baudrate2speed(inBaudrate) == 0 )
+    {
+        DBG_ERR("error");
+        return -1;
+    }
+
+    if ( baudrate == inBaudrate )
+    {
+        return 0;
+    }
+    baudrate = inBaudrate;
+
+    /* closed: applied by the next Open() */
+    if ( fd < 0 )
+    {
+        return 0;
+    }
+
+    /* open: let queued bytes leave at the old rate, then retune the termios in place */
+    tcdrain(fd);
+    if ( configure() < 0 )
+    {
+        DBG_ERR("error");
+        stale = 1;
+        return -1;
+    }
+
+    return 0;
+}
+
+int SerialComm::waitReady(short events, int timeoutMs)
+{
+    int ret = 0;
+    struct pollfd pfd;
+
+    pfd.fd      = fd;
+    pfd.events  = events;
+    pfd.revents = 0;
+
+    do
+    {
+        ret = poll(&pfd, 1, timeoutMs);
+    } while ( ret < 0 && errno == EINTR );
+
+    if ( ret < 0 )
+    {
+        DBG_ERR("error");
+        stale = 1;
+        ret = -1;
+        return ret;
+    }
+
+    /* timeout */
+    if ( ret == 0 )
+    {
+        return 0;
+    }
+
+    if ( pfd.revents & (POLLERR | POLLHUP | POLLNVAL) )
+    {
+        DBG_ERR("error");
+        stale = 1;
+        ret = -1;
+        return ret;
+    }
+
+    return 1;
+}
+
+int SerialComm::Send(const unsigned char* in, unsigned int inLen, int timeoutMs)
+{
+    struct iovec iov;
+
+    iov.iov_base = (void*)in;
+    iov.iov_len  = inLen;
+
+    return SendV(&iov, 1, timeoutMs);
+}
+
+/* gather send, header + payload(+trailer) leave in one writev() without a gap on the wire */
+int SerialComm::SendV(const struct iovec* iov, int iovcnt, int timeoutMs)
 {
     int ret = 0;
     int writenBytes = 0;
+    int totalBytes = 0;
+    int first = 0;
+    struct iovec vec[SERIAL_IOV_MAX];
+    struct timespec deadline;
 
-    if ( fd < 0 )
+    if ( fd < 0 || iov == NULL || iovcnt <= 0 || iovcnt > SERIAL_IOV_MAX )
     {
         DBG_ERR("error");
         ret = -1;
         return ret;
     }
 
+    for ( int i = 0; i < iovcnt; i++ )
+    {
+        vec[i] = iov[i];
+        totalBytes += iov[i].iov_len;
+    }
+
+    setDeadline(&deadline, timeoutMs);
+
     writenBytes = 0;
-    do
+    while ( writenBytes < totalBytes )
     {
-        ret = write(fd, in + writenBytes, inLen - writenBytes);
+        writeCalls++;
+        ret = writev(fd, &vec[first], iovcnt - first);
+        if ( ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) )
+        {
+            /* tx buffer is full, wait until it drains or the deadline passes */
+            ret = waitReady(POLLOUT, (timeoutMs < 0) ? -1 : remainingMs(&deadline));
+            if ( ret <= 0 )
+            {
+                DBG_ERR("%s", (ret == 0) ? "timeout" : "error");
+                DBG_ERR("%s(%d/%d)\n", __FUNCTION__, writenBytes, totalBytes);
+                ret = -1;
+                return ret;
+            }
+            continue;
+        }
         if ( ret <= 0 )
         {
             DBG_ERR("error");
-            DBG_ERR("%s(%d/%d)\n", __FUNCTION__, writenBytes, inLen);
+            DBG_ERR("%s(%d/%d)\n", __FUNCTION__, writenBytes, totalBytes);
+            stale = 1;
             ret = -1;
             return ret;
         }
         writenBytes += ret;
-    } while ( writenBytes < inLen );
+        txBytes     += ret;
+
+        /* partial write, skip what already left */
+        while ( (first < iovcnt) && (ret >= (int)vec[first].iov_len) )
+        {
+            ret -= vec[first].iov_len;
+            first++;
+        }
+        if ( first < iovcnt )
+        {
+            vec[first].iov_base = (unsigned char*)vec[first].iov_base + ret;
+            vec[first].iov_len -= ret;
+        }
+    }
 //    fprintf(stdout, "%s done\n", __FUNCTION__);
 
     return writenBytes;
 }
 
-int SerialComm::Receive(unsigned char *out, unsigned int outLen)
+int SerialComm::Receive(unsigned char *out, unsigned int outLen, int timeoutMs)
 {
     int ret = 0;
-    int readBytes = 0;
+    unsigned int readBytes = 0;
+    struct timespec deadline;
 
     if ( fd < 0 )
     {
@@ -283,23 +475,42 @@ int SerialComm::Receive(unsigned char *out, unsigned int outLen)
         return ret;
     }
 
+    setDeadline(&deadline, timeoutMs);
+
     readBytes = 0;
 
     do
     {
+        readCalls++;
         ret = read(fd, out + readBytes, outLen - readBytes);
-        if ( ret <= 0 )
+        if ( ret > 0 )
+        {
+            readBytes += ret;
+            rxBytes   += ret;
+            continue;
+        }
+        if ( ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR )
         {
             DBG_ERR("error");
-            DBG_ERR("%s(%d/%d)\n", __FUNCTION__, readBytes, outLen);
+            DBG_ERR("%s(%u/%u)\n", __FUNCTION__, readBytes, outLen);
+            stale = 1;
+            ret = -1;
+            return ret;
+        }
+
+        /* nothing buffered yet, wait for more data or the deadline */
+        ret = waitReady(POLLIN, (timeoutMs < 0) ? -1 : remainingMs(&deadline));
+        if ( ret <= 0 )
+        {
+            DBG_ERR("%s", (ret == 0) ? "timeout" : "error");
+            DBG_ERR("%s(%u/%u)\n", __FUNCTION__, readBytes, outLen);
             ret = -1;
             return ret;
         }
-        readBytes += ret;
     } while ( readBytes < outLen );
 //    fprintf(stdout, "%s done\n", __FUNCTION__);
 
-    return readBytes;
+    return (int)readBytes;
 }
 
 int SerialComm::GetReceiveSize(void)
@@ -316,4 +527,35 @@ int SerialComm::GetReceiveSize(void)
     }
 
     return receiveSize;
-}
\ No newline at end of file
+}
+
+int SerialComm::GetTransferTimeMs(unsigned int len)
+{
+    if ( baudrate <= 0 )
+    {
+        return 0;
+    }
+
+    /* 8N1: 10 bits on the wire per byte, rounded up */
+    return (int)(((unsigned long long)len * 10 * 1000 + baudrate - 1) / baudrate);
+}
+
+unsigned long SerialComm::GetWriteCalls(void)
+{
+    return writeCalls;
+}
+
+unsigned long SerialComm::GetReadCalls(void)
+{
+    return readCalls;
+}
+
+unsigned long SerialComm::GetTxBytes(void)
+{
+    return txBytes;
+}
+
+unsigned long SerialComm::GetRxBytes(void)
+{
+    return rxBytes;
+}
@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "CRC32.h"
+
+/*
+ * every CRC32 kernel against the byte table loop, bit for bit: unaligned buffers of
+ * 0 ~ 64 bytes at every start offset, then multi-KB buffers, each with random seeds.
+ * the byte table itself is checked against the bitwise definition first.
+ */
+static const unsigned int ALIGN_MAX        = (16);
+static const unsigned int SHORT_LENGTH_MAX = (64);
+static const unsigned int LONG_LENGTH_MAX  = (64 * 1024);
+static const int          LONG_RUNS        = (2000);
+static const int          SEEDS_PER_LENGTH = (4);
+
+class CRC32Test
+{
+    public:
+        static int Run(void);
+
+    private:
+        typedef unsigned int (*calcFunc_t)(const unsigned char* p, unsigned int size, unsigned int crc);
+
+        static unsigned int random32(void);
+        static unsigned int calcBitwise(const unsigned char* p, unsigned int size, unsigned int crc);
+        static int checkKernel(const char* name, calcFunc_t calc, const unsigned char* buffer);
+};
+
+static unsigned int randomState = 0x2545F491U;
+
+unsigned int CRC32Test::random32(void)
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+/* the polynomial one bit at a time, shares nothing with the tables */
+unsigned int CRC32Test::calcBitwise(const unsigned char* p, unsigned int size, unsigned int crc)
+{
+    while ( size-- )
+    {
+        crc ^= *p++;
+        for ( int k = 0; k < 8; k++ )
+        {
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320U) : (crc >> 1);
+        }
+    }
+
+    return crc;
+}
+
+/* 0: calc agrees with the byte table loop everywhere */
+int CRC32Test::checkKernel(const char* name, calcFunc_t calc, const unsigned char* buffer)
+{
+    unsigned int checked = 0;
+
+    for ( unsigned int offset = 0; offset < ALIGN_MAX; offset++ )
+    {
+        for ( unsigned int size = 0; size <= SHORT_LENGTH_MAX; size++ )
+        {
+            for ( int s = 0; s < SEEDS_PER_LENGTH; s++ )
+            {
+                unsigned int seed = (s == 0) ? ~0U : random32();
+                unsigned int want = CRC32::calcRef(buffer + offset, size, seed);
+                unsigned int got  = calc(buffer + offset, size, seed);
+                if ( got != want )
+                {
+                    fprintf(stderr, "FAIL %s: offset %u, %u bytes, seed 0x%08X: 0x%08X, table 0x%08X\n", name, offset, size, seed, got, want);
+                    return -1;
+                }
+                checked++;
+            }
+        }
+    }
+
+    for ( int run = 0; run < LONG_RUNS; run++ )
+    {
+        unsigned int offset = random32() % ALIGN_MAX;
+        unsigned int size   = SHORT_LENGTH_MAX + random32() % (LONG_LENGTH_MAX - SHORT_LENGTH_MAX + 1);
+        unsigned int seed   = random32();
+        unsigned int want   = CRC32::calcRef(buffer + offset, size, seed);
+        unsigned int got    = calc(buffer + offset, size, seed);
+        if ( got != want )
+        {
+            fprintf(stderr, "FAIL %s: offset %u, %u bytes, seed 0x%08X: 0x%08X, table 0x%08X\n", name, offset, size, seed, got, want);
+            return -1;
+        }
+        checked++;
+    }
+
+    fprintf(stdout, "ok   %-12s %u buffers\n", name, checked);
+
+    return 0;
+}
+
+int CRC32Test::Run(void)
+{
+    int ret = 0;
+
+    unsigned char* buffer = new unsigned char[ALIGN_MAX + LONG_LENGTH_MAX];
+    for ( unsigned int i = 0; i < ALIGN_MAX + LONG_LENGTH_MAX; i++ )
+    {
+        buffer[i] = (unsigned char)random32();
+    }
+
+    /* the reference the kernels are held to */
+    static const unsigned char check[] = "123456789";
+    if ( CRC32::CalcCRC32Ref(check, 9) != 0xCBF43926U )
+    {
+        fprintf(stderr, "FAIL table: check value 0x%08X\n", CRC32::CalcCRC32Ref(check, 9));
+        ret = -1;
+    }
+    for ( unsigned int size = 0; ret == 0 && size <= SHORT_LENGTH_MAX; size++ )
+    {
+        unsigned int seed = random32();
+        if ( CRC32::calcRef(buffer, size, seed) != calcBitwise(buffer, size, seed) )
+        {
+            fprintf(stderr, "FAIL table: %u bytes, seed 0x%08X, not the bitwise crc\n", size, seed);
+            ret = -1;
+        }
+    }
+    if ( ret == 0 )
+    {
+        fprintf(stdout, "ok   %-12s check value, bitwise\n", "table");
+    }
+
+    if ( ret == 0 )
+    {
+        ret = checkKernel("slice-by-8", CRC32::calcSlice8, buffer);
+    }
+    if ( ret == 0 )
+    {
+        ret = checkKernel("slice-by-16", CRC32::calcSlice16, buffer);
+    }
+    if ( ret == 0 && CRC32::armSupported() )
+    {
+        ret = checkKernel("armv8 crc32", CRC32::calcArm, buffer);
+    }
+    else
+    if ( ret == 0 )
+    {
+        fprintf(stdout, "skip %-12s not supported by this cpu or build\n", "armv8 crc32");
+    }
+    if ( ret == 0 )
+    {
+        ret = checkKernel("dispatched", CRC32::kernel, buffer);
+    }
+
+    delete[] buffer;
+
+    return ret;
+}
+
+int main(void)
+{
+    fprintf(stdout, "crc32 kernel in use: %s\n", CRC32::GetKernelName());
+
+    if ( CRC32Test::Run() != 0 )
+    {
+        fprintf(stdout, "crc32 test FAILED\n");
+        return 1;
+    }
+
+    fprintf(stdout, "crc32 test passed\n");
+    return 0;
+}